@@ -0,0 +1,96 @@
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/utils/copy.h"
+#include "../src/utils/heap.h"
+
+// destination is ordinary cached memory, numbers for write-combined mappings will favour streaming more
+#define MIN_COPY_SIZE 64
+#define MAX_COPY_SIZE (64 * 1024 * 1024)
+#define BYTES_PER_MEASUREMENT (512 * 1024 * 1024)
+#define BUFFER_PADDING 128
+#define MISALIGNED_DEST_OFFSET 7
+
+static double measure_kernel(copy_kernel kernel, unsigned char *dest, const unsigned char *src, size_t size) {
+    size_t iterations = BYTES_PER_MEASUREMENT / size;
+    if (iterations < 4) {
+        iterations = 4;
+    }
+
+    kernel(dest, src, size);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < iterations; i++) {
+        kernel(dest, src, size);
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    double seconds = (double) (end - start) / (double) SDL_GetPerformanceFrequency();
+    return ((double) size * (double) iterations) / (seconds * 1e9);
+}
+
+static bool verify_kernel(copy_kernel kernel, unsigned char *dest, const unsigned char *src, size_t size) {
+    // misaligned destination exercises the head and tail paths
+    memset(dest, 0, size + MISALIGNED_DEST_OFFSET + 1);
+    kernel(dest + MISALIGNED_DEST_OFFSET, src + 3, size);
+    return memcmp(dest + MISALIGNED_DEST_OFFSET, src + 3, size) == 0 && dest[MISALIGNED_DEST_OFFSET - 1] == 0
+        && dest[size + MISALIGNED_DEST_OFFSET] == 0;
+}
+
+static void run_table(unsigned char *dest, const unsigned char *src, size_t dest_offset, int *rc) {
+    printf("destination offset %zu from a cache line\n", dest_offset);
+    printf("%12s", "size");
+    for (copy_kernel_type type = 0; type < COPY_KERNEL_TOTAL; type++) {
+        if (is_copy_kernel_supported(type)) {
+            printf(" %14s", get_copy_kernel_name(type));
+        }
+    }
+    printf("   (GB/s)\n");
+
+    for (size_t size = MIN_COPY_SIZE; size <= MAX_COPY_SIZE; size *= 2) {
+        printf("%12zu", size);
+        for (copy_kernel_type type = 0; type < COPY_KERNEL_TOTAL; type++) {
+            copy_kernel kernel = get_copy_kernel(type);
+            if (!kernel) {
+                continue;
+            }
+            if (!verify_kernel(kernel, dest, src, size)) {
+                printf(" %14s", "MISMATCH");
+                *rc = EXIT_FAILURE;
+                continue;
+            }
+            printf(" %14.2f", measure_kernel(kernel, dest + dest_offset, src, size));
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+int main(int argc, char *args[]) {
+    init_copy_kernels();
+
+    unsigned char *src = mem_alloc(MAX_COPY_SIZE + BUFFER_PADDING);
+    unsigned char *dest = mem_alloc(MAX_COPY_SIZE + BUFFER_PADDING);
+    if (!src || !dest) {
+        fprintf(stderr, "Unable to allocate benchmark buffers\n");
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < MAX_COPY_SIZE + BUFFER_PADDING; i++) {
+        src[i] = (unsigned char) (i * 31 + 7);
+    }
+
+    // measure from a line aligned destination, then from one the kernels have to align themselves
+    unsigned char *line_dest = dest + ((STREAM_COPY_LINE_SIZE - ((uintptr_t) dest & (STREAM_COPY_LINE_SIZE - 1)))
+        & (STREAM_COPY_LINE_SIZE - 1));
+
+    int rc = EXIT_SUCCESS;
+    run_table(line_dest, src, 0, &rc);
+    run_table(line_dest, src, MISALIGNED_DEST_OFFSET, &rc);
+
+    mem_free(src);
+    mem_free(dest);
+
+    return rc;
+}
@@ -0,0 +1,78 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/profiler/cpu_profiler.h"
+
+// every begin/end pair of an instrumented frame has to stay below this
+#define ZONE_BUDGET_NS 50.0
+#define ZONE_ITERATIONS 1000000
+#define ZONE_NAME_SIZE 16
+
+static char zone_names[CPU_PROFILER_MAX_ZONES][ZONE_NAME_SIZE];
+
+static double measure_zone() {
+    // warms up the thread registration and the lookup of the call site
+    begin_cpu_zone("bench_zone");
+    end_cpu_zone();
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < ZONE_ITERATIONS; i++) {
+        begin_cpu_zone("bench_zone");
+        end_cpu_zone();
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    double seconds = (double) (end - start) / (double) SDL_GetPerformanceFrequency();
+    return seconds * 1e9 / (double) ZONE_ITERATIONS;
+}
+
+static double measure_full_table_zone() {
+    begin_cpu_zone("bench_zone_full_table");
+    end_cpu_zone();
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < ZONE_ITERATIONS; i++) {
+        begin_cpu_zone("bench_zone_full_table");
+        end_cpu_zone();
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    double seconds = (double) (end - start) / (double) SDL_GetPerformanceFrequency();
+    return seconds * 1e9 / (double) ZONE_ITERATIONS;
+}
+
+static bool report(const char *name, double ns) {
+    bool within = ns <= ZONE_BUDGET_NS;
+    printf("%-24s %8.2f ns%s\n", name, ns, within ? "" : "   OVER BUDGET");
+    return within;
+}
+
+int main(int argc, char *args[]) {
+    if (!init_cpu_prof()) {
+        fprintf(stderr, "Unable to initialize the CPU profiler\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("per zone, budget %.0f ns\n", ZONE_BUDGET_NS);
+
+    int rc = EXIT_SUCCESS;
+    if (!report("recorded", measure_zone())) {
+        rc = EXIT_FAILURE;
+    }
+
+    // a call site registered after the table filled up is disabled and must not look itself up again
+    for (size_t i = 0; i < CPU_PROFILER_MAX_ZONES; i++) {
+        snprintf(zone_names[i], ZONE_NAME_SIZE, "filler_%zu", i);
+        register_cpu_zone(zone_names[i]);
+    }
+    if (!report("zone table full", measure_full_table_zone())) {
+        rc = EXIT_FAILURE;
+    }
+
+    cpu_prof.enabled = false;
+    report("profiler disabled", measure_zone());
+
+    destroy_cpu_prof();
+
+    return rc;
+}
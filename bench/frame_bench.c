@@ -0,0 +1,506 @@
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vulkan/vulkan.h>
+#include "../src/vulkan/context.h"
+#include "../src/vulkan/functions/functions.h"
+#include "../src/vulkan/memory/memory.h"
+#include "../src/vulkan/buffers/uniform_ring.h"
+#include "../src/vulkan/descriptors/descriptor_allocator.h"
+#include "../src/renderer/backend.h"
+#include "../src/renderer/config.h"
+#include "../src/renderer/render_state.h"
+#include "../src/renderer/render_queue.h"
+#include "../src/renderer/gpu_culling.h"
+#include "../src/renderer/gpu_profiler.h"
+#include "../src/renderer/pipeline_stats.h"
+#include "../src/renderer/dynamic_resolution.h"
+#include "../src/renderer/shaders/shader_manager.h"
+#include "../src/geom/geom.h"
+#include "../src/vertex_management/config.h"
+#include "../src/vertex_management/mesh_loader.h"
+#include "../src/vertex_management/vertex_manager.h"
+#include "../src/vmath/mat4.h"
+#include "../src/string/string.h"
+#include "../src/utils/heap.h"
+#include "../src/utils/copy.h"
+#include "../src/utils/file.h"
+
+// every scene is rendered headless for a fixed number of frames along the same camera path,
+// so two runs differ only by the code under test
+#define BENCH_WARMUP_FRAMES 32
+#define BENCH_FRAMES        512
+#define BENCH_DENSITIES     3
+#define BENCH_SPACING       3.0f
+
+typedef struct bench_density {
+    uint32_t width_segments;
+    uint32_t height_segments;
+} bench_density;
+
+static const bench_density densities[BENCH_DENSITIES] = {
+    { 16, 8 },
+    { 48, 32 },
+    { 128, 64 }
+};
+
+typedef struct bench_scene {
+    const char *name;
+    uint32_t spheres;
+    uint32_t planes;
+    uint32_t density;
+} bench_scene;
+
+static const bench_scene scenes[] = {
+    { .name = "spheres_low",  .spheres = 1024, .planes = 0,    .density = 0 },
+    { .name = "spheres_mid",  .spheres = 1024, .planes = 0,    .density = 1 },
+    { .name = "spheres_high", .spheres = 1024, .planes = 0,    .density = 2 },
+    { .name = "planes",       .spheres = 0,    .planes = 4096, .density = 0 },
+    { .name = "mixed",        .spheres = 512,  .planes = 2048, .density = 1 }
+};
+
+#define BENCH_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+typedef struct bench_draw_data {
+    mat4 model;
+    float position_scale[4];
+} bench_draw_data;
+
+// the push constant programs take the position scale folded into the model matrix
+static void fold_position_scale(mat4 dest, const bench_draw_data *data) {
+    for (size_t column = 0; column < 4; column++) {
+        float scale = column < 3 ? data->position_scale[column] : 1.0f;
+        for (size_t row = 0; row < 4; row++) {
+            set_mat4(dest, row, column, get_mat4(data->model, row, column) * scale);
+        }
+    }
+}
+
+typedef struct bench_state {
+    const bench_scene *scene;
+    int sphere_meshes[BENCH_DENSITIES];
+    int plane_mesh;
+    uint32_t frame;
+    uint32_t frames;
+} bench_state;
+
+typedef struct bench_percentiles {
+    float p50;
+    float p95;
+    float p99;
+    float max;
+    uint32_t samples;
+} bench_percentiles;
+
+typedef struct bench_result {
+    bench_percentiles cpu;
+    bench_percentiles gpu;
+    double draw_calls;
+    double pipeline_binds;
+    double descriptor_sets;
+    double descriptor_sets_reused;
+    uint32_t descriptor_pools;
+    // per frame, how long the async culling ran next to graphics passes
+    double async_overlap_ms;
+    // per frame, fragment shader invocations of the draw pass and how many of them land on each pixel
+    double fragment_invocations;
+    double overdraw;
+    // average scale of the scene with dynamic resolution, 1 without
+    double render_scale;
+    uint64_t triangles;
+    VkDeviceSize peak_allocated_bytes;
+    VkDeviceSize peak_block_bytes;
+} bench_result;
+
+typedef struct bench_options {
+    uint32_t warmup_frames;
+    uint32_t frames;
+    const char *output;
+} bench_options;
+
+static bool add_meshes(bench_state *s) {
+    for (size_t i = 0; i < BENCH_DENSITIES; i++) {
+        mesh_geometry_config sphere = {
+            .type = SPHERE_GEOMETRY,
+            .geom_config_flag_bits = GEOM_Y_AXIS_FLIP_BIT,
+            .radius = 1.0f,
+            .phi_start = 0.0f,
+            .phi_length = GEOM_2PI,
+            .theta_start = 0.0f,
+            .theta_length = GEOM_PI,
+            .width_segments = densities[i].width_segments,
+            .height_segments = densities[i].height_segments
+        };
+        s->sphere_meshes[i] = add_static_mesh_vertex_manager(&vertex_cache, &sphere, VERTEX_LAYOUT_POS16_NOR_UV_PACKED);
+        if (s->sphere_meshes[i] < 0) {
+            return false;
+        }
+    }
+
+    mesh_geometry_config plane = {
+        .type = PLANE_GEOMETRY,
+        .geom_config_flag_bits = GEOM_Y_AXIS_FLIP_BIT,
+        .width = 2.0f,
+        .height = 2.0f,
+        .width_segments = 1,
+        .height_segments = 1
+    };
+    s->plane_mesh = add_static_mesh_vertex_manager(&vertex_cache, &plane, VERTEX_LAYOUT_POS16_NOR_UV_PACKED);
+
+    return s->plane_mesh >= 0 && upload_vertex_cache();
+}
+
+// orbits the grid once over the measured frames, the warmup frames repeat the start of the path
+static void get_camera(const bench_state *s, mat4 view_projection, vec3 eye) {
+    float t = (float) (s->frame % s->frames) / (float) s->frames;
+    float angle = t * GEOM_2PI;
+    eye[0] = 60.0f * cosf(angle);
+    eye[1] = 25.0f;
+    eye[2] = 60.0f * sinf(angle);
+
+    vec3 center = { 0.0f, 0.0f, 0.0f };
+    vec3 up = { 0.0f, 1.0f, 0.0f };
+    mat4 view, projection;
+    look_at(view, eye, center, up);
+    perspective(projection, GEOM_PI / 3.0f, (float) render_config.width / (float) render_config.height, 0.1f, 200.0f);
+    mulmat4(view_projection, projection, view);
+}
+
+// objects are laid out on a square grid in the xz plane, spheres above the planes
+static void get_position(uint32_t index, uint32_t count, float y, vec3 position) {
+    uint32_t side = (uint32_t) ceilf(sqrtf((float) count));
+    float offset = 0.5f * BENCH_SPACING * (float) (side - 1);
+    position[0] = BENCH_SPACING * (float) (index % side) - offset;
+    position[1] = y;
+    position[2] = BENCH_SPACING * (float) (index / side) - offset;
+}
+
+static bool add_objects(render_queue *q, draw_packet *packet, const static_mesh *mesh, uint32_t count, float y,
+    const vec3 eye)
+{
+    set_static_mesh_draw_packet(packet, mesh);
+
+    bench_draw_data data;
+    identity_mat4(data.model);
+    data.position_scale[0] = mesh->position_scale;
+    data.position_scale[1] = mesh->position_scale;
+    data.position_scale[2] = mesh->position_scale;
+    data.position_scale[3] = 1.0f;
+
+    for (uint32_t i = 0; i < count; i++) {
+        vec3 position;
+        get_position(i, count, y, position);
+        set_mat4(data.model, 0, 3, position[0]);
+        set_mat4(data.model, 1, 3, position[1]);
+        set_mat4(data.model, 2, 3, position[2]);
+
+        float dx = position[0] - eye[0], dy = position[1] - eye[1], dz = position[2] - eye[2];
+        set_depth_draw_packet(packet, fminf(sqrtf(dx * dx + dy * dy + dz * dz) / 200.0f, 1.0f));
+
+        mat4 constants;
+        fold_position_scale(constants, &data);
+        bool success = packet->draw_data_range > 0 ?
+            set_draw_data_draw_packet(packet, &data, sizeof(data)) :
+            packet->instance_data_range > 0 ?
+            set_instance_data_draw_packet(packet, &data, sizeof(data)) :
+            set_push_constants_draw_packet(packet, constants, sizeof(constants));
+        if (!success || !add_render_queue(q, packet)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool draw_scene(render_queue *q, void *data) {
+    bench_state *s = data;
+    const bench_scene *scene = s->scene;
+
+    render_program_instance instance = render_config.gpu_culling ?
+        RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INDIRECT : RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE;
+    if (!bind_program_instance(instance)) {
+        return false;
+    }
+
+    mat4 view_projection;
+    vec3 eye;
+    get_camera(s, view_projection, eye);
+    set_view_gpu_cull(view_projection);
+    s->frame++;
+
+    draw_packet packet;
+    init_draw_packet(&packet);
+    if (!set_program_draw_packet(&packet, RST_BASIC_3D) ||
+        !alloc_uniform_block(view_projection, sizeof(mat4), &packet.dynamic_offset))
+    {
+        return false;
+    }
+    set_material_draw_packet(&packet, 0);
+
+    const static_mesh *sphere = &vertex_cache.static_meshes[s->sphere_meshes[scene->density]];
+    const static_mesh *plane = &vertex_cache.static_meshes[s->plane_mesh];
+
+    return add_objects(q, &packet, sphere, scene->spheres, 1.0f, eye) &&
+        add_objects(q, &packet, plane, scene->planes, 0.0f, eye);
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *) a, y = *(const float *) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// nearest rank, the same definition the profilers use
+static void get_percentiles(float *samples, uint32_t samples_size, bench_percentiles *result) {
+    result->samples = samples_size;
+    result->p50 = result->p95 = result->p99 = result->max = 0.0f;
+    if (samples_size == 0) {
+        return;
+    }
+    qsort(samples, samples_size, sizeof(float), compare_float);
+    result->p50 = samples[(uint32_t) ceilf(0.50f * samples_size) - 1];
+    result->p95 = samples[(uint32_t) ceilf(0.95f * samples_size) - 1];
+    result->p99 = samples[(uint32_t) ceilf(0.99f * samples_size) - 1];
+    result->max = samples[samples_size - 1];
+}
+
+static uint64_t get_triangles(const bench_state *s) {
+    const static_mesh *sphere = &vertex_cache.static_meshes[s->sphere_meshes[s->scene->density]];
+    const static_mesh *plane = &vertex_cache.static_meshes[s->plane_mesh];
+    return (uint64_t) s->scene->spheres * (sphere->index_count / 3) +
+        (uint64_t) s->scene->planes * (plane->index_count / 3);
+}
+
+static bool run_scene(bench_state *s, const bench_options *o, float *cpu_ms, float *gpu_ms, bench_result *result) {
+    s->frame = 0;
+    s->frames = o->frames;
+    for (uint32_t i = 0; i < o->warmup_frames; i++) {
+        if (!render()) {
+            return false;
+        }
+    }
+    vk_reset_memory_peak();
+
+    gpu_profiler_stats stats;
+    uint64_t gpu_samples = get_gpu_stats("frame", &stats) ? stats.total_samples : 0;
+    uint64_t overlap_samples = get_gpu_stats(GPU_PROFILER_OVERLAP_SCOPE, &stats) ? stats.total_samples : 0;
+    pipeline_stats_result pipeline;
+    uint64_t pipeline_samples = get_pipe_stats(&pipeline) ? pipe_stats.total_samples : 0;
+    uint32_t gpu_ms_size = 0, overlap_size = 0, pipeline_size = 0;
+    double overlap_ms = 0.0, fragment_invocations = 0.0, overdraw = 0.0, render_scale = 0.0;
+    uint64_t draw_calls = 0, pipeline_binds = 0, descriptor_sets = 0, descriptor_sets_reused = 0;
+    s->frame = 0;
+
+    for (uint32_t i = 0; i < o->frames; i++) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        bool success = render();
+        Uint64 end = SDL_GetPerformanceCounter();
+        if (!success) {
+            return false;
+        }
+        cpu_ms[i] = (float) ((double) (end - start) * 1000.0 / (double) SDL_GetPerformanceFrequency());
+
+        // frames are resolved frames_in_flight frames late, the first ones still belong to the warmup
+        if (get_gpu_stats("frame", &stats) && stats.total_samples != gpu_samples && i >= context.frames_in_flight) {
+            gpu_ms[gpu_ms_size++] = stats.last_ms;
+        }
+        gpu_samples = stats.total_samples;
+        if (get_gpu_stats(GPU_PROFILER_OVERLAP_SCOPE, &stats) && stats.total_samples != overlap_samples &&
+            i >= context.frames_in_flight)
+        {
+            overlap_ms += stats.last_ms;
+            overlap_size++;
+            overlap_samples = stats.total_samples;
+        }
+        if (get_pipe_stats(&pipeline) && pipe_stats.total_samples != pipeline_samples &&
+            i >= context.frames_in_flight)
+        {
+            fragment_invocations += (double) pipeline.fragment_invocations;
+            overdraw += pipeline.overdraw;
+            pipeline_size++;
+            pipeline_samples = pipe_stats.total_samples;
+        }
+
+        render_scale += dyn_res.enabled ? dyn_res.scale : 1.0;
+        draw_calls += renderer.pc.commands.issued[COMMAND_STATE_CALL_DRAW];
+        pipeline_binds += renderer.pc.commands.issued[COMMAND_STATE_CALL_PIPELINE];
+        descriptor_sets += descriptor_alloc.counters.allocated;
+        descriptor_sets_reused += descriptor_alloc.counters.reused;
+    }
+
+    get_percentiles(cpu_ms, o->frames, &result->cpu);
+    get_percentiles(gpu_ms, gpu_ms_size, &result->gpu);
+    result->draw_calls = (double) draw_calls / o->frames;
+    result->pipeline_binds = (double) pipeline_binds / o->frames;
+    result->descriptor_sets = (double) descriptor_sets / o->frames;
+    result->descriptor_sets_reused = (double) descriptor_sets_reused / o->frames;
+    result->descriptor_pools = descriptor_alloc.counters.pools;
+    result->async_overlap_ms = overlap_size > 0 ? overlap_ms / overlap_size : 0.0;
+    result->fragment_invocations = pipeline_size > 0 ? fragment_invocations / pipeline_size : 0.0;
+    result->overdraw = pipeline_size > 0 ? overdraw / pipeline_size : 0.0;
+    result->render_scale = render_scale / o->frames;
+    result->triangles = get_triangles(s);
+    result->peak_allocated_bytes = vk_allocator.peak_allocated_bytes;
+    result->peak_block_bytes = vk_allocator.peak_block_bytes;
+
+    return true;
+}
+
+static void write_percentiles(FILE *file, const char *name, const bench_percentiles *p) {
+    fprintf(file, "\"%s\": {\"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"samples\": %u}",
+        name, p->p50, p->p95, p->p99, p->max, p->samples);
+}
+
+static void write_result(FILE *file, const bench_scene *scene, const bench_result *r, bool last) {
+    fprintf(file, "    {\n");
+    fprintf(file, "      \"name\": \"%s\",\n", scene->name);
+    fprintf(file, "      \"spheres\": %u,\n", scene->spheres);
+    fprintf(file, "      \"sphere_segments\": [%u, %u],\n", densities[scene->density].width_segments,
+        densities[scene->density].height_segments);
+    fprintf(file, "      \"planes\": %u,\n", scene->planes);
+    fprintf(file, "      \"triangles\": %llu,\n", (unsigned long long) r->triangles);
+    fprintf(file, "      ");
+    write_percentiles(file, "cpu_ms", &r->cpu);
+    fprintf(file, ",\n      ");
+    write_percentiles(file, "gpu_ms", &r->gpu);
+    fprintf(file, ",\n");
+    fprintf(file, "      \"draw_calls\": %.1f,\n", r->draw_calls);
+    fprintf(file, "      \"pipeline_binds\": %.1f,\n", r->pipeline_binds);
+    fprintf(file, "      \"descriptor_sets\": %.1f,\n", r->descriptor_sets);
+    fprintf(file, "      \"descriptor_sets_reused\": %.1f,\n", r->descriptor_sets_reused);
+    fprintf(file, "      \"descriptor_pools\": %u,\n", r->descriptor_pools);
+    fprintf(file, "      \"async_overlap_ms\": %.4f,\n", r->async_overlap_ms);
+    fprintf(file, "      \"fragment_invocations\": %.1f,\n", r->fragment_invocations);
+    fprintf(file, "      \"overdraw\": %.3f,\n", r->overdraw);
+    fprintf(file, "      \"render_scale\": %.3f,\n", r->render_scale);
+    fprintf(file, "      \"peak_allocated_bytes\": %llu,\n", (unsigned long long) r->peak_allocated_bytes);
+    fprintf(file, "      \"peak_block_bytes\": %llu\n", (unsigned long long) r->peak_block_bytes);
+    fprintf(file, "    }%s\n", last ? "" : ",");
+}
+
+static bool parse_options(int argc, char *args[], bench_options *o) {
+    o->warmup_frames = BENCH_WARMUP_FRAMES;
+    o->frames = BENCH_FRAMES;
+    o->output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(args[i], "--frames") == 0 && has_value) {
+            o->frames = (uint32_t) atoi(args[++i]);
+        } else if (strcmp(args[i], "--warmup") == 0 && has_value) {
+            o->warmup_frames = (uint32_t) atoi(args[++i]);
+        } else if (strcmp(args[i], "--output") == 0 && has_value) {
+            o->output = args[++i];
+        } else if (strcmp(args[i], "--depth-prepass") == 0) {
+            render_config.depth_prepass = true;
+        } else if (strcmp(args[i], "--dynamic-resolution") == 0) {
+            render_config.dynamic_resolution = true;
+        } else {
+            fprintf(stderr, "Usage: %s [--frames N] [--warmup N] [--depth-prepass] [--dynamic-resolution] "
+                "[--output FILE]\n", args[0]);
+            return false;
+        }
+    }
+    if (o->frames == 0) {
+        fprintf(stderr, "The number of frames has to be positive\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool init_bench(const bench_options *o) {
+    if (SDL_Init(0) != 0) {
+        fprintf(stderr, "Unable to initialize SDL: %s\n", SDL_GetError());
+        return false;
+    }
+
+    render_config.headless = true;
+    render_config.headless_frames = o->warmup_frames + o->frames;
+    render_config.dump_directory = NULL;
+    // room for the densest sphere next to the others
+    vertex_management_config.static_buffer_size = 4 * 1024 * 1024;
+
+    init_copy_kernels();
+
+    return init_mesh_loader(64 * 1024, 256 * 1024) &&
+        init_vulkan(&context, NULL) &&
+        init_renderer();
+}
+
+int main(int argc, char *args[]) {
+    bench_options options;
+    if (!parse_options(argc, args, &options)) {
+        return EXIT_FAILURE;
+    }
+
+    // shaders live next to the main binary, one directory up
+    if (!set_dirname(args[0]) || !string_append(dirname, MAX_PATH_LENGTH, dirname[0] ? "/.." : "..")) {
+        return EXIT_FAILURE;
+    }
+
+    init_vk_context(&context);
+
+    int rc = EXIT_FAILURE;
+    FILE *file = NULL;
+    float *cpu_ms = mem_alloc(options.frames * sizeof(float));
+    float *gpu_ms = mem_alloc(options.frames * sizeof(float));
+    bench_state state;
+
+    if (!cpu_ms || !gpu_ms || !init_bench(&options) || !add_meshes(&state)) {
+        fprintf(stderr, "Unable to initialize the benchmark\n");
+        goto cleanup;
+    }
+    set_draw_scene(draw_scene, &state);
+
+    file = options.output ? fopen(options.output, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "Unable to open %s\n", options.output);
+        goto cleanup;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"width\": %d,\n", render_config.width);
+    fprintf(file, "  \"height\": %d,\n", render_config.height);
+    fprintf(file, "  \"frames_in_flight\": %u,\n", context.frames_in_flight);
+    fprintf(file, "  \"gpu_culling\": %s,\n", render_config.gpu_culling ? "true" : "false");
+    fprintf(file, "  \"async_compute\": %s,\n", context.async_compute ? "true" : "false");
+    fprintf(file, "  \"depth_prepass\": %s,\n", render_config.depth_prepass ? "true" : "false");
+    fprintf(file, "  \"dynamic_resolution\": %s,\n", dyn_res.enabled ? "true" : "false");
+    fprintf(file, "  \"frame_budget_ms\": %.2f,\n", render_config.frame_budget_ms);
+    fprintf(file, "  \"warmup_frames\": %u,\n", options.warmup_frames);
+    fprintf(file, "  \"frames\": %u,\n", options.frames);
+    fprintf(file, "  \"scenes\": [\n");
+
+    rc = EXIT_SUCCESS;
+    for (size_t i = 0; i < BENCH_SCENES; i++) {
+        state.scene = &scenes[i];
+        bench_result result;
+        if (!run_scene(&state, &options, cpu_ms, gpu_ms, &result)) {
+            fprintf(stderr, "Unable to render scene %s\n", scenes[i].name);
+            rc = EXIT_FAILURE;
+            break;
+        }
+        write_result(file, &scenes[i], &result, i + 1 == BENCH_SCENES);
+    }
+
+    fprintf(file, "  ]\n}\n");
+    if (ferror(file)) {
+        rc = EXIT_FAILURE;
+    }
+
+cleanup:
+    if (file && file != stdout) {
+        fclose(file);
+    }
+    set_draw_scene(NULL, NULL);
+    destroy_renderer();
+    shutdown_vulkan(&context);
+    destroy_mesh_loader();
+    mem_free(cpu_ms);
+    mem_free(gpu_ms);
+    SDL_Quit();
+
+    return rc;
+}
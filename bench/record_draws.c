@@ -0,0 +1,323 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_vulkan.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+#include "../src/vulkan/context.h"
+#include "../src/vulkan/functions/functions.h"
+#include "../src/vulkan/buffers/uniform_ring.h"
+#include "../src/renderer/backend.h"
+#include "../src/renderer/config.h"
+#include "../src/renderer/render_state.h"
+#include "../src/renderer/render_queue.h"
+#include "../src/renderer/record_workers.h"
+#include "../src/renderer/shaders/shader_manager.h"
+#include "../src/vertex_management/config.h"
+#include "../src/vertex_management/mesh_loader.h"
+#include "../src/vertex_management/vertex_manager.h"
+#include "../src/vmath/mat4.h"
+#include "../src/string/string.h"
+#include "../src/utils/copy.h"
+#include "../src/utils/file.h"
+
+// recorded command buffers are never submitted, this only measures the CPU side
+#define BENCH_DRAWS 100000
+#define BENCH_FRAMES 32
+
+typedef struct bench_draw_data {
+    mat4 model;
+    float position_scale[4];
+} bench_draw_data;
+
+// the push constant programs take the position scale folded into the model matrix
+static void fold_position_scale(mat4 dest, const bench_draw_data *data) {
+    for (size_t column = 0; column < 4; column++) {
+        float scale = column < 3 ? data->position_scale[column] : 1.0f;
+        for (size_t row = 0; row < 4; row++) {
+            set_mat4(dest, row, column, get_mat4(data->model, row, column) * scale);
+        }
+    }
+}
+
+// the diffuse program takes the per-draw data as push constants, its indirect and instanced variants from the batch
+static bool fill_queue(render_queue *q, render_program_instance instance) {
+    vk_start_frame_uniform_ring(0);
+    clear_render_queue(q);
+    if (!start_frame_ren_pm() || !bind_program_instance(instance)) {
+        return false;
+    }
+
+    mat4 view_projection;
+    perspective(view_projection, 90.0f, 4.0f / 3.0f, 0.0f, 200.0f);
+
+    draw_packet packet;
+    init_draw_packet(&packet);
+    if (!set_program_draw_packet(&packet, RST_BASIC_3D) ||
+        !alloc_uniform_block(view_projection, sizeof(mat4), &packet.dynamic_offset))
+    {
+        return false;
+    }
+
+    const static_mesh *mesh = &vertex_cache.static_meshes[0];
+    set_static_mesh_draw_packet(&packet, mesh);
+
+    bench_draw_data data;
+    identity_mat4(data.model);
+    data.position_scale[0] = mesh->position_scale;
+    data.position_scale[1] = mesh->position_scale;
+    data.position_scale[2] = mesh->position_scale;
+    data.position_scale[3] = 1.0f;
+
+    for (size_t i = 0; i < BENCH_DRAWS; i++) {
+        set_mat4(data.model, 0, 3, (float) (i % 100) - 50.0f);
+        set_mat4(data.model, 1, 3, (float) (i / 100 % 100) - 50.0f);
+        set_mat4(data.model, 2, 3, -10.0f - (float) (i / 10000));
+        // scattered materials and depths give the sort something to do
+        set_material_draw_packet(&packet, (i * 2654435761u) >> 28);
+        set_depth_draw_packet(&packet, (float) ((i * 40503u) & 0xFFFF) / 65535.0f);
+        mat4 constants;
+        fold_position_scale(constants, &data);
+        bool success = packet.draw_data_range > 0 ?
+            set_draw_data_draw_packet(&packet, &data, sizeof(data)) :
+            packet.instance_data_range > 0 ?
+            set_instance_data_draw_packet(&packet, &data, sizeof(data)) :
+            set_push_constants_draw_packet(&packet, constants, sizeof(constants));
+        if (!success || !add_render_queue(q, &packet)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static double elapsed_ms(Uint64 start) {
+    return (double) (SDL_GetPerformanceCounter() - start) * 1000.0 / (double) SDL_GetPerformanceFrequency();
+}
+
+static void get_target(record_target *target) {
+    target->frame = 0;
+    target->framebuffer = context.framebuffers[0];
+
+    VkViewport viewport = {
+        .x = 0,
+        .y = 0,
+        .width = context.extent.width,
+        .height = context.extent.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    target->viewport = viewport;
+    target->scissor.offset.x = 0;
+    target->scissor.offset.y = 0;
+    target->scissor.extent = context.extent;
+    target->depth_prepass = false;
+    target->pipeline_statistics = 0;
+}
+
+static bool record_frame(record_worker_pool *p, const record_target *target, const render_queue *q,
+    command_state_counters *counters)
+{
+    VkCommandBuffer command_buffer = context.command_buffers[0];
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = NULL,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL
+    };
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+        return false;
+    }
+
+    // the render pass clears both attachments as it loads them
+    VkClearValue clear_values[2] = {
+        { .color = { .float32 = { 0.0f, 0.0f, 0.0f, 0.0f } } },
+        { .depthStencil = { .depth = 1.0f, .stencil = 0 } }
+    };
+    VkRenderPassBeginInfo render_pass_begin_info = {
+        .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext           = NULL,
+        .renderPass      = context.render_pass,
+        .framebuffer     = target->framebuffer,
+        .renderArea      = target->scissor,
+        .clearValueCount = 2,
+        .pClearValues    = clear_values
+    };
+
+    bool success = true;
+    if (p) {
+        vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        success = record_draws_record_worker_pool(p, target, q->batches, q->batches_size, command_buffer, counters);
+    } else {
+        vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+        command_state state;
+        init_command_state(&state);
+        begin_command_state(&state, command_buffer);
+        set_viewport_command_state(&state, &target->viewport);
+        set_scissor_command_state(&state, &target->scissor);
+        record_draw_batches(q->batches, q->batches_size, &state);
+        add_command_state_counters(counters, &state.counters);
+    }
+    vkCmdEndRenderPass(command_buffer);
+
+    return vkEndCommandBuffer(command_buffer) == VK_SUCCESS && success;
+}
+
+static double measure(record_worker_pool *p, const record_target *target, const render_queue *q,
+    command_state_counters *counters)
+{
+    init_command_state_counters(counters);
+    if (!record_frame(p, target, q, counters)) {
+        return -1.0;
+    }
+
+    command_state_counters frame_counters;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < BENCH_FRAMES; i++) {
+        init_command_state_counters(&frame_counters);
+        if (!record_frame(p, target, q, &frame_counters)) {
+            return -1.0;
+        }
+    }
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    return (double) (end - start) * 1000.0 / ((double) SDL_GetPerformanceFrequency() * BENCH_FRAMES);
+}
+
+// times building the batches of a sorted queue, then recording them inline
+static bool measure_batches(render_queue *q, render_program_instance instance, const char *name,
+    const record_target *target)
+{
+    if (!fill_queue(q, instance)) {
+        fprintf(stderr, "Unable to build the %s draw list\n", name);
+        return false;
+    }
+    sort_render_queue(q);
+    Uint64 build_start = SDL_GetPerformanceCounter();
+    bool built = build_batches_render_queue(q, false);
+    double build_ms = elapsed_ms(build_start);
+    if (!built) {
+        return false;
+    }
+
+    command_state_counters counters;
+    double ms = measure(NULL, target, q, &counters);
+    printf("%10s %10.3f\n", "batch", build_ms);
+    printf("%10s %10.3f %10u %10u   %zu batches\n", name, ms, get_issued_command_state_counters(&counters),
+        get_skipped_command_state_counters(&counters), q->batches_size);
+
+    return ms >= 0.0;
+}
+
+static bool init_bench(SDL_Window **window) {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0 || SDL_Vulkan_LoadLibrary(NULL) != 0) {
+        fprintf(stderr, "Unable to initialize SDL: %s\n", SDL_GetError());
+        return false;
+    }
+
+    *window = SDL_CreateWindow("Record draws", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+        render_config.width, render_config.height, SDL_WINDOW_HIDDEN | SDL_WINDOW_VULKAN);
+    if (!*window) {
+        fprintf(stderr, "Unable to create window: %s\n", SDL_GetError());
+        return false;
+    }
+    SDL_Vulkan_GetDrawableSize(*window, &render_config.width, &render_config.height);
+
+    init_copy_kernels();
+
+    return init_mesh_loader(
+            vertex_management_config.mesh_loader_config.max_vertex_buffer_size,
+            vertex_management_config.mesh_loader_config.max_index_buffer_size
+        ) &&
+        init_vulkan(&context, *window);
+}
+
+int main(int argc, char *args[]) {
+    // shaders live next to the main binary, one directory up
+    if (!set_dirname(args[0]) || !string_append(dirname, MAX_PATH_LENGTH, dirname[0] ? "/.." : "..")) {
+        return EXIT_FAILURE;
+    }
+
+    init_vk_context(&context);
+
+    int rc = EXIT_FAILURE;
+    SDL_Window *window = NULL;
+    render_queue queue;
+    init_render_queue(&queue);
+
+    if (!init_bench(&window) || !alloc_render_queue(&queue, BENCH_DRAWS)) {
+        goto cleanup;
+    }
+
+    if (!fill_queue(&queue, RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE) || !build_batches_render_queue(&queue, false)) {
+        fprintf(stderr, "Unable to build the draw list\n");
+        goto cleanup;
+    }
+
+    record_target target;
+    get_target(&target);
+
+    command_state_counters counters;
+    double unsorted_ms = measure(NULL, &target, &queue, &counters);
+    uint32_t unsorted_issued = get_issued_command_state_counters(&counters);
+    uint32_t unsorted_skipped = get_skipped_command_state_counters(&counters);
+
+    Uint64 sort_start = SDL_GetPerformanceCounter();
+    sort_render_queue(&queue);
+    double sort_ms = elapsed_ms(sort_start);
+    if (!build_batches_render_queue(&queue, false)) {
+        goto cleanup;
+    }
+
+    printf("%d draws, ms per frame, commands issued / skipped\n", BENCH_DRAWS);
+    printf("%10s %10.3f %10u %10u\n", "unsorted", unsorted_ms, unsorted_issued, unsorted_skipped);
+    printf("%10s %10.3f\n", "sort", sort_ms);
+    double sorted_ms = measure(NULL, &target, &queue, &counters);
+    printf("%10s %10.3f %10u %10u\n", "inline", sorted_ms, get_issued_command_state_counters(&counters),
+        get_skipped_command_state_counters(&counters));
+
+    int max_threads = SDL_GetCPUCount();
+    if (max_threads > MAX_RECORD_WORKERS) {
+        max_threads = MAX_RECORD_WORKERS;
+    }
+
+    rc = EXIT_SUCCESS;
+    for (int threads = 1; threads <= max_threads; threads++) {
+        record_worker_pool pool;
+        if (!create_record_worker_pool(&pool, threads)) {
+            destroy_record_worker_pool(&pool);
+            rc = EXIT_FAILURE;
+            break;
+        }
+        double ms = measure(&pool, &target, &queue, &counters);
+        destroy_record_worker_pool(&pool);
+        if (ms < 0.0) {
+            fprintf(stderr, "Unable to record with %d threads\n", threads);
+            rc = EXIT_FAILURE;
+            break;
+        }
+        printf("%10d %10.3f %10u %10u\n", threads, ms, get_issued_command_state_counters(&counters),
+            get_skipped_command_state_counters(&counters));
+    }
+
+    if (rc == EXIT_SUCCESS) {
+        bool success =
+            measure_batches(&queue, RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INDIRECT, "indirect", &target) &&
+            measure_batches(&queue, RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INSTANCED, "instanced", &target);
+        rc = success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+cleanup:
+    destroy_render_queue(&queue);
+    if (context.device && vkDeviceWaitIdle) {
+        vkDeviceWaitIdle(context.device);
+    }
+    shutdown_vulkan(&context);
+    destroy_mesh_loader();
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
+    SDL_Quit();
+
+    return rc;
+}
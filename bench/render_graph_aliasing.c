@@ -0,0 +1,125 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vulkan/vulkan.h>
+#include "../src/vulkan/context.h"
+#include "../src/vulkan/functions/functions.h"
+#include "../src/vulkan/buffers/uniform_ring.h"
+#include "../src/renderer/config.h"
+#include "../src/renderer/render_graph.h"
+#include "../src/vertex_management/mesh_loader.h"
+#include "../src/string/string.h"
+#include "../src/utils/copy.h"
+#include "../src/utils/file.h"
+
+// the graphs are only compiled, which creates and places the transients, nothing is recorded or submitted
+#define TRANSIENT_SIZE 512
+
+static bool execute_nothing(VkCommandBuffer command_buffer, void *data) {
+    return true;
+}
+
+// write first, copy it out, write second from the copy, copy that out. with overlapping lifetimes both
+// transients are also read by the last pass
+static bool compile_graph(render_graph *g, bool overlapping) {
+    reset_render_graph(g);
+
+    render_graph_image_desc desc = {
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .extent = { TRANSIENT_SIZE, TRANSIENT_SIZE },
+        .usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .aspect = VK_IMAGE_ASPECT_COLOR_BIT
+    };
+    uint32_t first = create_image_render_graph(g, "first", &desc);
+    uint32_t second = create_image_render_graph(g, "second", &desc);
+    uint32_t staging = import_buffer_render_graph(g, "staging", uniform_ring.buffer.buffer);
+    uint32_t output = import_buffer_render_graph(g, "output", uniform_ring.buffer.buffer);
+    set_output_render_graph(g, output);
+
+    uint32_t write_first = add_pass_render_graph(g, "write_first", execute_nothing, NULL);
+    use_render_graph(g, write_first, first, RG_USAGE_COMPUTE_WRITE);
+
+    uint32_t copy_first = add_pass_render_graph(g, "copy_first", execute_nothing, NULL);
+    use_render_graph(g, copy_first, first, RG_USAGE_TRANSFER_READ);
+    use_render_graph(g, copy_first, staging, RG_USAGE_TRANSFER_WRITE);
+
+    uint32_t write_second = add_pass_render_graph(g, "write_second", execute_nothing, NULL);
+    use_render_graph(g, write_second, staging, RG_USAGE_TRANSFER_READ);
+    use_render_graph(g, write_second, second, RG_USAGE_TRANSFER_WRITE);
+
+    uint32_t copy_second = add_pass_render_graph(g, "copy_second", execute_nothing, NULL);
+    use_render_graph(g, copy_second, second, RG_USAGE_TRANSFER_READ);
+    if (overlapping) {
+        use_render_graph(g, copy_second, first, RG_USAGE_TRANSFER_READ);
+    }
+    use_render_graph(g, copy_second, output, RG_USAGE_TRANSFER_WRITE);
+
+    return compile_render_graph(g);
+}
+
+static bool check_graph(render_graph *g, bool overlapping) {
+    if (!compile_graph(g, overlapping)) {
+        fprintf(stderr, "Unable to compile the %s graph\n", overlapping ? "overlapping" : "disjoint");
+        return false;
+    }
+    if (g->transients_size != 2 || !g->transients[0].image || !g->transients[1].image) {
+        fprintf(stderr, "The transients of the %s graph were not created\n", overlapping ? "overlapping" : "disjoint");
+        return false;
+    }
+
+    const render_graph_transient *a = &g->transients[0], *b = &g->transients[1];
+    bool shared = a->offset < b->offset + b->size && b->offset < a->offset + a->size;
+    printf("%-12s first %u-%u at %lu, second %u-%u at %lu, %lu bytes each: %s\n",
+        overlapping ? "overlapping" : "disjoint", a->first_pass, a->last_pass, (unsigned long) a->offset,
+        b->first_pass, b->last_pass, (unsigned long) b->offset, (unsigned long) a->size,
+        shared ? "shared" : "separate");
+
+    // transients whose passes do not overlap have to alias, the others must not
+    if (shared == overlapping) {
+        fprintf(stderr, "The %s transients are expected to be %s\n", overlapping ? "overlapping" : "disjoint",
+            overlapping ? "separate" : "shared");
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *args[]) {
+    // shaders live next to the main binary, one directory up
+    if (!set_dirname(args[0]) || !string_append(dirname, MAX_PATH_LENGTH, dirname[0] ? "/.." : "..")) {
+        return EXIT_FAILURE;
+    }
+
+    init_vk_context(&context);
+
+    int rc = EXIT_FAILURE;
+    render_graph graph;
+    init_render_graph(&graph);
+
+    if (SDL_Init(0) != 0) {
+        fprintf(stderr, "Unable to initialize SDL: %s\n", SDL_GetError());
+        goto cleanup;
+    }
+    render_config.headless = true;
+    render_config.dump_directory = NULL;
+    init_copy_kernels();
+    if (!init_mesh_loader(64 * 1024, 256 * 1024) || !init_vulkan(&context, NULL)) {
+        fprintf(stderr, "Unable to initialize Vulkan\n");
+        goto cleanup;
+    }
+
+    if (check_graph(&graph, false) && check_graph(&graph, true)) {
+        rc = EXIT_SUCCESS;
+    }
+
+cleanup:
+    if (context.device && vkDeviceWaitIdle) {
+        vkDeviceWaitIdle(context.device);
+    }
+    destroy_render_graph(&graph);
+    shutdown_vulkan(&context);
+    destroy_mesh_loader();
+    SDL_Quit();
+
+    return rc;
+}
@@ -33,7 +33,7 @@ static inline void normalize_vertex_float3(vertex_float dest[3], const vertex_fl
     if (l <= 0.00001) {
         return;
     }
-    dest[0] = a[0] / l, dest[1] = a[1] / l, dest[2] / l;
+    dest[0] = a[0] / l, dest[1] = a[1] / l, dest[2] = a[2] / l;
 }
 
 typedef struct vertex {
@@ -1,29 +1,77 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <vulkan/vulkan.h>
 #include "./logger/logger.h"
 #include "./vulkan/context.h"
+#include "./vulkan/functions/functions.h"
 #include "./window/config.h"
 #include "./renderer/config.h"
 #include "./vulkan/memory/memory.h"
 #include "./renderer/backend.h"
+#include "./renderer/gpu_profiler.h"
+#include "./renderer/pipeline_stats.h"
+#include "./profiler/cpu_profiler.h"
 #include "./utils/file.h"
+#include "./utils/copy.h"
 #include "./input/input.h"
 #include "./vertex_management/mesh_loader.h"
 
 #define MS_PER_UPDATE 16
 
+// [--bindless] [--no-async-compute] [--depth-prepass] [--dynamic-resolution [--budget MS]]
+// [--headless [--frames N] [--dump DIR] [--dump-interval N]]
+static bool parse_args(int argc, char* args[]) {
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(args[i], "--bindless") == 0) {
+            render_config.bindless = true;
+        } else if (strcmp(args[i], "--no-async-compute") == 0) {
+            render_config.async_compute = false;
+        } else if (strcmp(args[i], "--depth-prepass") == 0) {
+            render_config.depth_prepass = true;
+        } else if (strcmp(args[i], "--dynamic-resolution") == 0) {
+            render_config.dynamic_resolution = true;
+        } else if (strcmp(args[i], "--budget") == 0 && has_value) {
+            render_config.frame_budget_ms = (float) atof(args[++i]);
+        } else if (strcmp(args[i], "--headless") == 0) {
+            render_config.headless = true;
+        } else if (strcmp(args[i], "--frames") == 0 && has_value) {
+            render_config.headless_frames = atoi(args[++i]);
+        } else if (strcmp(args[i], "--dump") == 0 && has_value) {
+            render_config.dump_directory = args[++i];
+        } else if (strcmp(args[i], "--dump-interval") == 0 && has_value) {
+            render_config.dump_interval = atoi(args[++i]);
+        } else {
+            log_error("Unknown argument %s", args[i]);
+            return false;
+        }
+    }
+    if (render_config.frame_budget_ms <= 0.0f) {
+        log_error("The frame budget has to be positive");
+        return false;
+    }
+    if (render_config.headless_frames <= 0) {
+        log_error("The number of headless frames has to be positive");
+        return false;
+    }
+
+    return true;
+}
+
 static bool init_SDL() {
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
+    // the context loads Vulkan itself when there is no video subsystem
+    Uint32 flags = render_config.headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO | SDL_INIT_EVENTS;
+    if (SDL_Init(flags) != 0) {
         log_error("Error while initializing SDL: %s", SDL_GetError());
         return false;
     }
 
-    if (SDL_Vulkan_LoadLibrary(NULL) != 0) {
+    if (!render_config.headless && SDL_Vulkan_LoadLibrary(NULL) != 0) {
         log_error("Error while loading Vulkan library: %s", SDL_GetError());
         return false;
     }
@@ -32,11 +80,13 @@ static bool init_SDL() {
 }
 
 static bool init(vk_context *ctx, SDL_Window *window) {
-    return init_vulkan(ctx, window) &&
-        init_mesh_loader(
+    init_copy_kernels();
+
+    return init_mesh_loader(
             vertex_management_config.mesh_loader_config.max_vertex_buffer_size,
             vertex_management_config.mesh_loader_config.max_index_buffer_size
         ) &&
+        init_vulkan(ctx, window) &&
         init_input();
 }
 
@@ -44,9 +94,40 @@ void shutdown_SDL() {
     SDL_Quit();
 }
 
+// renders a fixed number of frames as fast as the GPU allows, without a window
+static bool run_headless() {
+    log_info("Headless size: %d, %d, %d frames", render_config.width, render_config.height,
+        render_config.headless_frames);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < render_config.headless_frames; i++) {
+        begin_cpu_zone("render");
+        bool success = render();
+        end_cpu_zone();
+        mark_frame_cpu_prof();
+        if (!success) {
+            return false;
+        }
+    }
+    if (context.device && vkDeviceWaitIdle) {
+        vkDeviceWaitIdle(context.device);
+    }
+    double seconds = (double) (SDL_GetPerformanceCounter() - start) / (double) SDL_GetPerformanceFrequency();
+
+    log_info("%d frames in %.3f s, %.1f fps", render_config.headless_frames, seconds,
+        render_config.headless_frames / seconds);
+    log_cpu_stats();
+    log_gpu_stats();
+    log_pipe_stats();
+
+    return true;
+}
+
 static void quit(int rc) {
+    destroy_renderer();
     shutdown_vulkan(&context);
     destroy_mesh_loader();
+    destroy_cpu_prof();
     shutdown_SDL();
     exit(rc);
 }
@@ -57,12 +138,23 @@ int main(int argc, char* args[]) {
     }
     log_info("Binary path: %s, directory: %s", args[0], dirname);
 
+    if (!parse_args(argc, args)) {
+        exit(EXIT_FAILURE);
+    }
+
     init_vk_context(&context);
 
-    if (!init_SDL()) {
+    if (!init_SDL() || !init_cpu_prof()) {
         quit(EXIT_FAILURE);
     }
 
+    if (render_config.headless) {
+        if (!init(&context, NULL) || !init_renderer()) {
+            quit(EXIT_FAILURE);
+        }
+        quit(run_headless() ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     SDL_DisplayMode mode;
     SDL_Window *window = NULL;
 
@@ -73,7 +165,7 @@ int main(int argc, char* args[]) {
     } else {
         window = SDL_CreateWindow(
             "Vulkan sample", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_config.width, window_config.height,
-            SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN
+            SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE
         );
     }
 
@@ -88,10 +180,9 @@ int main(int argc, char* args[]) {
     log_info("Draw Size: %d, %d", render_config.width, render_config.height);
     log_info("Screen BPP: %d", SDL_BITSPERPIXEL(mode.format));
 
-    if (!init(&context, window)) {
+    if (!init(&context, window) || !init_renderer()) {
         quit(EXIT_FAILURE);
     }
-    init_renderer();
 
     bool is_running = true;
 
@@ -104,27 +195,50 @@ int main(int argc, char* args[]) {
         previous_time = current_time;
         lag += elapsed_time;
 
+        begin_cpu_zone("input");
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             switch (event.type) {
                 case SDL_QUIT:
                     is_running = false;
                     break;
+                case SDL_WINDOWEVENT:
+                    if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                        SDL_GetWindowSize(window, &window_config.width, &window_config.height);
+                        SDL_Vulkan_GetDrawableSize(window, &render_config.width, &render_config.height);
+                        resize_renderer();
+                    }
+                    break;
                 case SDL_KEYUP:
                     if (event.key.keysym.sym == SDLK_ESCAPE) {
                         is_running = false;
+                    } else if (event.key.keysym.sym == SDLK_F2) {
+                        char trace_path[MAX_PATH_LENGTH];
+                        log_cpu_stats();
+                        log_gpu_stats();
+                        log_pipe_stats();
+                        if (path_resolve(trace_path, dirname, "trace.json", NULL)) {
+                            write_gpu_trace(trace_path);
+                        }
+                    } else if (event.key.keysym.sym == SDLK_F3) {
+                        render_config.depth_prepass = !render_config.depth_prepass;
+                        log_info("Depth pre-pass %s", render_config.depth_prepass ? "on" : "off");
                     }
                     break;
             }
             update_input(&event);
         }
+        end_cpu_zone();
 
         while (lag >= MS_PER_UPDATE) {
             double delta = lag / MS_PER_UPDATE;
             lag -= MS_PER_UPDATE;
         }
 
+        begin_cpu_zone("render");
         bool success = render();
+        end_cpu_zone();
+        mark_frame_cpu_prof();
         if (!success) {
             is_running = false;
         }
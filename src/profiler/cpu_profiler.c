@@ -0,0 +1,297 @@
+#include "./cpu_profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../utils/heap.h"
+#include "../logger/logger.h"
+
+cpu_profiler cpu_prof;
+
+static _Thread_local cpu_profiler_thread *current_thread = NULL;
+
+static void calibrate_clock(cpu_profiler *p) {
+    uint64_t ticks = get_cpu_ticks();
+    uint64_t counter = SDL_GetPerformanceCounter();
+    if (counter == p->base_counter || ticks <= p->base_ticks) {
+        return;
+    }
+    double elapsed_us = (double) (counter - p->base_counter) * 1000000.0 / (double) SDL_GetPerformanceFrequency();
+    p->ticks_per_us = (double) (ticks - p->base_ticks) / elapsed_us;
+}
+
+bool init_cpu_prof() {
+    cpu_profiler *p = &cpu_prof;
+    p->enabled = false;
+    p->lock = 0;
+    p->threads_size = 0;
+    p->zones_size = 0;
+
+    p->base_ticks = get_cpu_ticks();
+    p->base_counter = SDL_GetPerformanceCounter();
+    p->ticks_per_us = (double) SDL_GetPerformanceFrequency() / 1000000.0;
+    // a first estimate, refined every frame as the interval grows
+    SDL_Delay(5);
+    calibrate_clock(p);
+
+    p->enabled = true;
+
+    return true;
+}
+
+int32_t register_cpu_zone(const char *name) {
+    cpu_profiler *p = &cpu_prof;
+    if (!p->enabled) {
+        return CPU_ZONE_UNREGISTERED;
+    }
+
+    SDL_AtomicLock(&p->lock);
+    int32_t zone = CPU_ZONE_DISABLED;
+    for (uint32_t i = 0; i < p->zones_size; i++) {
+        if (strcmp(p->zones[i].name, name) == 0) {
+            zone = i;
+            break;
+        }
+    }
+    if (zone == CPU_ZONE_DISABLED && p->zones_size < CPU_PROFILER_MAX_ZONES) {
+        cpu_profiler_zone *z = &p->zones[p->zones_size];
+        z->name = name;
+        z->history_size = 0;
+        z->history_index = 0;
+        z->last_calls = 0;
+        zone = p->zones_size++;
+    }
+    SDL_AtomicUnlock(&p->lock);
+
+    if (zone == CPU_ZONE_DISABLED) {
+        log_warning("No room for CPU profiler zone %s", name);
+    }
+
+    return zone;
+}
+
+static cpu_profiler_thread *register_thread(cpu_profiler *p) {
+    cpu_profiler_thread *t = mem_alloc(sizeof(cpu_profiler_thread));
+    cpu_profiler_event *events = mem_alloc(sizeof(cpu_profiler_event) * CPU_PROFILER_EVENTS);
+    if (!t || !events) {
+        mem_free(t);
+        mem_free(events);
+        return NULL;
+    }
+    t->id = SDL_ThreadID();
+    t->events = events;
+    atomic_init(&t->write_index, 0);
+    t->next_index = 0;
+    t->read_index = 0;
+    t->stack_size = 0;
+
+    SDL_AtomicLock(&p->lock);
+    bool registered = p->threads_size < CPU_PROFILER_MAX_THREADS;
+    if (registered) {
+        t->index = p->threads_size;
+        p->threads[p->threads_size++] = t;
+    }
+    SDL_AtomicUnlock(&p->lock);
+
+    if (!registered) {
+        log_warning("No room for CPU profiler thread %lu", (unsigned long) t->id);
+        mem_free(events);
+        mem_free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+void begin_cpu_zone_id(int32_t zone) {
+    if (!cpu_prof.enabled) {
+        return;
+    }
+    cpu_profiler_thread *t = current_thread;
+    if (!t) {
+        t = current_thread = register_thread(&cpu_prof);
+        if (!t) {
+            return;
+        }
+    }
+
+    uint32_t depth = t->stack_size++;
+    if (depth < CPU_PROFILER_MAX_DEPTH) {
+        t->stack_zones[depth] = zone;
+        t->stack[depth] = get_cpu_ticks();
+    }
+}
+
+void end_cpu_zone() {
+    cpu_profiler_thread *t = current_thread;
+    if (!cpu_prof.enabled || !t || t->stack_size == 0) {
+        return;
+    }
+
+    uint64_t end = get_cpu_ticks();
+    uint32_t depth = --t->stack_size;
+    if (depth >= CPU_PROFILER_MAX_DEPTH || t->stack_zones[depth] < 0) {
+        return;
+    }
+
+    cpu_profiler_event *event = &t->events[t->next_index & (CPU_PROFILER_EVENTS - 1)];
+    event->start = t->stack[depth];
+    event->end = end;
+    event->zone = t->stack_zones[depth];
+    event->depth = depth;
+    atomic_store_explicit(&t->write_index, ++t->next_index, memory_order_release);
+}
+
+static void add_sample(cpu_profiler_zone *zone, float ms) {
+    zone->history[zone->history_index] = ms;
+    zone->history_index = (zone->history_index + 1) % CPU_PROFILER_HISTORY;
+    if (zone->history_size < CPU_PROFILER_HISTORY) {
+        zone->history_size++;
+    }
+}
+
+void mark_frame_cpu_prof() {
+    cpu_profiler *p = &cpu_prof;
+    if (!p->enabled) {
+        return;
+    }
+    calibrate_clock(p);
+
+    uint64_t frame_ticks[CPU_PROFILER_MAX_ZONES];
+    uint32_t calls[CPU_PROFILER_MAX_ZONES];
+
+    SDL_AtomicLock(&p->lock);
+    uint32_t zones_size = p->zones_size;
+    uint32_t threads_size = p->threads_size;
+    SDL_AtomicUnlock(&p->lock);
+
+    for (uint32_t i = 0; i < zones_size; i++) {
+        frame_ticks[i] = 0;
+        calls[i] = 0;
+    }
+
+    for (uint32_t i = 0; i < threads_size; i++) {
+        cpu_profiler_thread *t = p->threads[i];
+        uint32_t write_index = atomic_load_explicit(&t->write_index, memory_order_acquire);
+        uint32_t read_index = t->read_index;
+        // the oldest zones were overwritten before this frame got to them
+        if (write_index - read_index > CPU_PROFILER_EVENTS) {
+            read_index = write_index - CPU_PROFILER_EVENTS;
+        }
+        for (; read_index != write_index; read_index++) {
+            const cpu_profiler_event *event = &t->events[read_index & (CPU_PROFILER_EVENTS - 1)];
+            if ((uint32_t) event->zone < zones_size) {
+                frame_ticks[event->zone] += event->end - event->start;
+                calls[event->zone]++;
+            }
+        }
+        t->read_index = write_index;
+    }
+
+    // nested calls of the same zone are counted twice, zones are not expected to recurse
+    for (uint32_t i = 0; i < zones_size; i++) {
+        cpu_profiler_zone *zone = &p->zones[i];
+        zone->last_calls = calls[i];
+        if (calls[i] > 0) {
+            add_sample(zone, (float) ((double) frame_ticks[i] / p->ticks_per_us / 1000.0));
+        }
+    }
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *) a, y = *(const float *) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void get_zone_stats(const cpu_profiler_zone *zone, cpu_profiler_stats *stats) {
+    stats->samples = zone->history_size;
+    stats->last_calls = zone->last_calls;
+    stats->last_ms = stats->min_ms = stats->avg_ms = stats->p99_ms = 0.0f;
+    if (zone->history_size == 0) {
+        return;
+    }
+
+    float sorted[CPU_PROFILER_HISTORY];
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < zone->history_size; i++) {
+        sorted[i] = zone->history[i];
+        sum += sorted[i];
+    }
+    qsort(sorted, zone->history_size, sizeof(float), compare_float);
+
+    uint32_t last = (zone->history_index + CPU_PROFILER_HISTORY - 1) % CPU_PROFILER_HISTORY;
+    uint32_t p99 = (uint32_t) ceilf(0.99f * zone->history_size) - 1;
+    stats->last_ms = zone->history[last];
+    stats->min_ms = sorted[0];
+    stats->avg_ms = sum / zone->history_size;
+    stats->p99_ms = sorted[p99];
+}
+
+bool get_cpu_stats(const char *name, cpu_profiler_stats *stats) {
+    const cpu_profiler *p = &cpu_prof;
+    for (uint32_t i = 0; i < p->zones_size; i++) {
+        if (strcmp(p->zones[i].name, name) == 0) {
+            get_zone_stats(&p->zones[i], stats);
+            return stats->samples > 0;
+        }
+    }
+    return false;
+}
+
+void log_cpu_stats() {
+    const cpu_profiler *p = &cpu_prof;
+    for (uint32_t i = 0; i < p->zones_size; i++) {
+        cpu_profiler_stats stats;
+        get_zone_stats(&p->zones[i], &stats);
+        log_info("%s: last %.3f min %.3f avg %.3f p99 %.3f ms, %u calls", p->zones[i].name,
+            stats.last_ms, stats.min_ms, stats.avg_ms, stats.p99_ms, stats.last_calls);
+    }
+}
+
+double ticks_to_us_cpu_prof(uint64_t ticks) {
+    const cpu_profiler *p = &cpu_prof;
+    if (!p->enabled || ticks < p->base_ticks) {
+        return 0.0;
+    }
+    return (double) (ticks - p->base_ticks) / p->ticks_per_us;
+}
+
+bool write_trace_events_cpu_prof(FILE *file, int pid) {
+    const cpu_profiler *p = &cpu_prof;
+    if (!p->enabled) {
+        return true;
+    }
+
+    fprintf(file, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"CPU\"}}", pid);
+    for (uint32_t i = 0; i < p->threads_size; i++) {
+        const cpu_profiler_thread *t = p->threads[i];
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+            "\"args\":{\"name\":\"Thread %lu\"}}", pid, t->index, (unsigned long) t->id);
+
+        uint32_t write_index = atomic_load_explicit(&t->write_index, memory_order_acquire);
+        uint32_t size = write_index < CPU_PROFILER_EVENTS ? write_index : CPU_PROFILER_EVENTS;
+        for (uint32_t j = write_index - size; j != write_index; j++) {
+            const cpu_profiler_event *event = &t->events[j & (CPU_PROFILER_EVENTS - 1)];
+            if ((uint32_t) event->zone >= p->zones_size) {
+                continue;
+            }
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,"
+                "\"ts\":%.3f,\"dur\":%.3f}", p->zones[event->zone].name, pid, t->index,
+                ticks_to_us_cpu_prof(event->start), (double) (event->end - event->start) / p->ticks_per_us);
+        }
+    }
+
+    return ferror(file) == 0;
+}
+
+void destroy_cpu_prof() {
+    cpu_profiler *p = &cpu_prof;
+    p->enabled = false;
+    for (uint32_t i = 0; i < p->threads_size; i++) {
+        mem_free(p->threads[i]->events);
+        mem_free(p->threads[i]);
+    }
+    p->threads_size = 0;
+    p->zones_size = 0;
+    current_thread = NULL;
+}
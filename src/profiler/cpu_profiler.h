@@ -0,0 +1,116 @@
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+#define CPU_PROFILER_MAX_THREADS 32
+#define CPU_PROFILER_MAX_ZONES   256
+#define CPU_PROFILER_MAX_DEPTH   32
+// per thread, a power of two
+#define CPU_PROFILER_EVENTS      16384
+#define CPU_PROFILER_HISTORY     128
+
+// zone ids cached by the call sites, the disabled one is never looked up again
+#define CPU_ZONE_UNREGISTERED -1
+#define CPU_ZONE_DISABLED     -2
+
+typedef struct cpu_profiler_event {
+    uint64_t start;
+    uint64_t end;
+    int32_t zone;
+    uint32_t depth;
+} cpu_profiler_event;
+
+// written only by its own thread, the frame marker reads up to the published write index
+typedef struct cpu_profiler_thread {
+    uint32_t index;
+    SDL_threadID id;
+
+    cpu_profiler_event *events;
+    atomic_uint write_index;
+    uint32_t next_index;
+    uint32_t read_index;
+
+    uint64_t stack[CPU_PROFILER_MAX_DEPTH];
+    int32_t stack_zones[CPU_PROFILER_MAX_DEPTH];
+    uint32_t stack_size;
+} cpu_profiler_thread;
+
+typedef struct cpu_profiler_zone {
+    const char *name;
+    float history[CPU_PROFILER_HISTORY];
+    uint32_t history_size;
+    uint32_t history_index;
+    uint32_t last_calls;
+} cpu_profiler_zone;
+
+typedef struct cpu_profiler_stats {
+    float last_ms;
+    float min_ms;
+    float avg_ms;
+    float p99_ms;
+    uint32_t last_calls;
+    uint32_t samples;
+} cpu_profiler_stats;
+
+typedef struct cpu_profiler {
+    bool enabled;
+    SDL_SpinLock lock;
+
+    cpu_profiler_thread *threads[CPU_PROFILER_MAX_THREADS];
+    uint32_t threads_size;
+
+    cpu_profiler_zone zones[CPU_PROFILER_MAX_ZONES];
+    uint32_t zones_size;
+
+    // the clock is the TSC where there is one, calibrated against the SDL performance counter
+    uint64_t base_ticks;
+    uint64_t base_counter;
+    double ticks_per_us;
+} cpu_profiler;
+
+extern cpu_profiler cpu_prof;
+
+static inline uint64_t get_cpu_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return SDL_GetPerformanceCounter();
+#endif
+}
+
+bool init_cpu_prof();
+// unregistered while the profiler is disabled, disabled for good once the zone table is full
+int32_t register_cpu_zone(const char *name);
+void begin_cpu_zone_id(int32_t zone);
+void end_cpu_zone();
+// once per frame on the main thread, folds the finished zones of all threads into the statistics
+void mark_frame_cpu_prof();
+bool get_cpu_stats(const char *name, cpu_profiler_stats *stats);
+void log_cpu_stats();
+double ticks_to_us_cpu_prof(uint64_t ticks);
+// Chrome trace events of the last zones of every thread, each prefixed with a comma
+bool write_trace_events_cpu_prof(FILE *file, int pid);
+void destroy_cpu_prof();
+
+// the zone is looked up once per call site, name has to be a string literal
+#define begin_cpu_zone(name)                                                             \
+    do {                                                                                 \
+        static atomic_int cpu_zone_id = CPU_ZONE_UNREGISTERED;                           \
+        int32_t zone = atomic_load_explicit(&cpu_zone_id, memory_order_relaxed);         \
+        if (zone == CPU_ZONE_UNREGISTERED) {                                             \
+            zone = register_cpu_zone(name);                                              \
+            atomic_store_explicit(&cpu_zone_id, zone, memory_order_relaxed);             \
+        }                                                                                \
+        begin_cpu_zone_id(zone);                                                         \
+    } while (0)
+
+#endif // CPU_PROFILER_H
@@ -7,105 +7,202 @@
 #include "../vulkan/gpu_info.h"
 #include "../vulkan/memory/memory.h"
 #include "../vulkan/memory/staging.h"
+#include "../vulkan/buffers/uniform_ring.h"
+#include "../vulkan/descriptors/descriptor_allocator.h"
+#include "../vulkan/descriptors/bindless.h"
 #include "../logger/logger.h"
+#include "../profiler/cpu_profiler.h"
 #include "./shaders/shader_manager.h"
 #include "../vertex_management/vertex_manager.h"
+#include "../vmath/mat4.h"
 
 #include "./render_state.h"
+#include "./render_queue.h"
+#include "./record_workers.h"
+#include "./gpu_culling.h"
+#include "./gpu_profiler.h"
+#include "./pipeline_stats.h"
+#include "./dynamic_resolution.h"
+#include "./frame_dump.h"
 #include "./config.h"
 
 render_backend renderer;
 
 void init_backend_counters(backend_counters *b) {
     b->gpu_microsec = 0;
+    b->gpu_latency_frames = 0;
+    init_command_state_counters(&b->commands);
 }
 
 void init_render_backend(render_backend *r) {
     r->current_frame = 0;
     r->current_swap_index = 0;
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
-        r->query_index[i] = 0;
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         r->command_buffer_recorded[i] = false;
-        for (size_t j = 0; j < NUM_TIMESTAMP_QUERIES; j++) {
-            r->query_results[i][j] = 0;
-        }
     }
 
+    init_render_queue(&r->queue);
+    init_command_state(&r->command_state);
+    init_command_state(&r->compute_state);
+    r->cull_async = false;
+    r->cull_pyramid = 0;
+    r->cull_wait_value = 0;
     init_backend_counters(&r->pc);
+    r->draw_scene = NULL;
+    r->draw_scene_data = NULL;
+    init_render_graph(&r->graph);
+    r->graph_logged = false;
+    r->dump_buffer = VK_NULL_HANDLE;
+    r->resize_pending = false;
+}
+
+// in the order of the attachments of the render pass, which clears them as it loads them
+static void get_clear_values(VkClearValue values[2], const float rgba[4], float depth, uint32_t stencil) {
+    values[0].color.float32[0] = rgba[0];
+    values[0].color.float32[1] = rgba[1];
+    values[0].color.float32[2] = rgba[2];
+    values[0].color.float32[3] = rgba[3];
+    values[1].depthStencil.depth = depth;
+    values[1].depthStencil.stencil = stencil;
 }
 
-static void clear_frame(render_backend *r, uint32_t clear_bits, float rgba[4], uint32_t stencil_value) {
-    uint32_t num_attachments = 0;
-    VkClearAttachment attachments[2] = {
-        { 0 },
-        { 0 }
+// the scene covers the whole swapchain image unless it is scaled
+static VkExtent2D get_scene_extent() {
+    return dyn_res.enabled ? dyn_res.extent : context.extent;
+}
+
+static void get_record_target(render_backend *r, record_target *target) {
+    target->frame = r->current_frame;
+    target->framebuffer = dyn_res.enabled ? dyn_res.framebuffer : context.framebuffers[r->current_swap_index];
+
+    VkExtent2D extent = get_scene_extent();
+    VkViewport viewport = {
+        x: 0,
+        y: 0,
+        width: extent.width,
+        height: extent.height,
+        minDepth: 0.0f,
+        maxDepth: 1.0f
     };
+    target->viewport = viewport;
+
+    VkRect2D scissor = {
+        offset: {
+            x: 0,
+            y: 0,
+        },
+        extent: {
+            width: viewport.width,
+            height: viewport.height
+        }
+    };
+    target->scissor = scissor;
+    target->depth_prepass = false;
+    target->pipeline_statistics = 0;
+}
+
+static bool recreate_swapchain(render_backend *r) {
+    bool recreated = false;
+    begin_cpu_zone("recreate_swapchain");
+    bool success = recreate_swapchain_vulkan(&context, &recreated) &&
+        (!recreated || !render_config.gpu_culling || resize_gpu_cull()) &&
+        (!recreated || resize_dyn_res());
+    end_cpu_zone();
+    if (!success) {
+        log_error("Unable to recreate the swapchain");
+        return false;
+    }
+    if (recreated) {
+        log_info("Swapchain recreated: %u x %u", context.extent.width, context.extent.height);
+        r->resize_pending = false;
+    }
 
-    if (clear_bits & CLEAR_COLOR_BUFFER) {
-        VkClearAttachment *attachment = &attachments[num_attachments++];
-        attachment->aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        attachment->colorAttachment = 0;
-        VkClearColorValue *color = &attachment->clearValue.color;
-        color->float32[0] = rgba[0];
-        color->float32[1] = rgba[1];
-        color->float32[2] = rgba[2];
-        color->float32[3] = rgba[3];
-    }
-
-    if (clear_bits & (CLEAR_DEPTH_BUFFER | CLEAR_STENCIL_BUFFER)) {
-        VkClearAttachment *attachment = &attachments[num_attachments++];
-        if (clear_bits & CLEAR_DEPTH_BUFFER) {
-            attachment->aspectMask |= VK_IMAGE_ASPECT_DEPTH_BIT;
+    return true;
+}
+
+// acquired is false while the window is minimized, the frame is skipped then
+static bool acquire_image(render_backend *r, bool *acquired) {
+    *acquired = false;
+    // once for an out of date swapchain, once more for the recreated one
+    for (uint32_t i = 0; i < 2; i++) {
+        if (r->resize_pending && !recreate_swapchain(r)) {
+            return false;
         }
-        if (clear_bits & CLEAR_STENCIL_BUFFER) {
-            attachment->aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        if (r->resize_pending) {
+            return true;
         }
-        attachment->clearValue.depthStencil.depth = 1.0;
-        attachment->clearValue.depthStencil.stencil = stencil_value;
+
+        begin_cpu_zone("acquire");
+        VkResult result = vkAcquireNextImageKHR(context.device, context.swapchain, UINT64_MAX,
+            context.acquire_semaphores[r->current_frame], VK_NULL_HANDLE, &r->current_swap_index);
+        end_cpu_zone();
+        // nothing was acquired and the semaphore is left unsignaled, the next attempt reuses it
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            r->resize_pending = true;
+            continue;
+        }
+        // still presentable, this frame goes out as is
+        if (result == VK_SUBOPTIMAL_KHR) {
+            r->resize_pending = true;
+        } else {
+            CHECK_VK(result);
+        }
+        *acquired = true;
+        return true;
     }
 
-    VkClearRect clear_rect = {
-        .rect = {
-            .offset = {
-                .x = 0,
-                .y = 0
-            },
-            .extent = context.extent
-        },
-        .baseArrayLayer = 0,
-        .layerCount = 1
-    };
-    vkCmdClearAttachments(context.command_buffers[r->current_frame], num_attachments, attachments, 1, &clear_rect);
+    return true;
 }
 
-static bool start_frame(render_backend *r) {
-    CHECK_VK(vkAcquireNextImageKHR(context.device, context.swapchain, UINT64_MAX,
-        context.acquire_semaphores[r->current_frame], VK_NULL_HANDLE, &r->current_swap_index));
-    vk_empty_garbage();
-    vk_flush_stage();
+static bool start_frame(render_backend *r, bool *started) {
+    *started = false;
 
-    if (!start_frame_ren_pm()) {
-        log_error("Unable to start render manager");
+    // only the frame whose resources are about to be reused has to be done, the others keep running
+    begin_cpu_zone("fence_wait");
+    bool swapped = block_swap_buffers_render_backend(r);
+    end_cpu_zone();
+    if (!swapped) {
+        log_error("Unable to swap buffers");
         return false;
     }
+    release_retired_vulkan(&context, r->current_frame);
 
-    VkQueryPool query_pool = context.query_pools[r->current_frame];
-    uint64_t *results = r->query_results[r->current_frame];
-    size_t results_byte_size = sizeof(uint64_t) * NUM_TIMESTAMP_QUERIES;
-
-    if (r->query_index[r->current_frame] > 0) {
-        vkGetQueryPoolResults(context.device, query_pool, 0, 2, results_byte_size,
-            results, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    if (!resolve_frame_dump(r->current_frame)) {
+        log_warning("Unable to dump a frame");
+    }
 
-        gpu_info *gpu = &context.gpus[context.selected_gpu];
+    // a headless context has an offscreen image per frame slot, there is nothing to acquire
+    if (context.headless) {
+        r->current_swap_index = r->current_frame;
+    } else {
+        bool acquired = false;
+        if (!acquire_image(r, &acquired)) {
+            log_error("Unable to acquire a swapchain image");
+            return false;
+        }
+        if (!acquired) {
+            return true;
+        }
+    }
+    *started = true;
 
-        uint64_t gpu_start = results[0];
-        uint64_t gpu_end = results[1];
-        uint64_t gpu_tick = (1000 * 1000 * 1000) / gpu->props.limits.timestampPeriod;
-        r->pc.gpu_microsec = ((gpu_end - gpu_start) * 1000 * 1000) / gpu_tick;
+    begin_cpu_zone("empty_garbage");
+    vk_empty_garbage();
+    end_cpu_zone();
+    begin_cpu_zone("flush_stage");
+    vk_flush_stage();
+    end_cpu_zone();
+    vk_start_frame_uniform_ring(r->current_frame);
+    if (!vk_start_frame_descriptor_allocator(r->current_frame)) {
+        log_error("Unable to reset the descriptor pools");
+        return false;
+    }
+    vk_start_frame_bindless(r->current_frame);
 
-        r->query_index[r->current_frame] = 0;
+    if (!start_frame_ren_pm()) {
+        log_error("Unable to start render manager");
+        return false;
     }
 
     VkCommandBuffer command_buffer = context.command_buffers[r->current_frame];
@@ -119,91 +216,373 @@ static bool start_frame(render_backend *r) {
 
     CHECK_VK(vkBeginCommandBuffer(command_buffer, &command_buffer_begin_info));
 
-    VkViewport viewport = {
-        x: 0,
-        y: 0,
-        width: render_config.width,
-        height: render_config.height,
-        minDepth: 0.0f,
-        maxDepth: 1.0f
-    };
-    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    // the async queue culls against the older pyramid, not the one the frame still rendering builds. it has to be
+    // in its compute layout once, new pyramids are culled against on graphics first
+    r->cull_async = context.async_compute && render_config.gpu_culling &&
+        gpu_cull.hiz[get_cull_pyramid_gpu_cull(true)].layout == VK_IMAGE_LAYOUT_GENERAL;
+    r->cull_pyramid = get_cull_pyramid_gpu_cull(r->cull_async);
+    VkCommandBuffer compute_buffer = r->cull_async ? context.compute_command_buffers[r->current_frame] :
+        VK_NULL_HANDLE;
+    if (compute_buffer) {
+        CHECK_VK(vkBeginCommandBuffer(compute_buffer, &command_buffer_begin_info));
+    }
 
-    VkRect2D scissor = {
-        offset: {
-            x: 0,
-            y: 0,
-        },
-        extent: {
-            width: viewport.width,
-            height: viewport.height
-        }
-    };
-    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    // the timestamps of this frame slot are from frames_in_flight frames ago, any not available yet are skipped
+    if (!begin_frame_gpu_prof(r->current_frame, command_buffer, compute_buffer)) {
+        return false;
+    }
+    gpu_profiler_stats frame_stats;
+    if (get_gpu_stats("frame", &frame_stats)) {
+        r->pc.gpu_microsec = (uint64_t) (frame_stats.last_ms * 1000.0f);
+        r->pc.gpu_latency_frames = frame_stats.latency_frames;
+        update_dyn_res(frame_stats.last_ms, frame_stats.total_samples);
+    }
+    begin_gpu_scope(command_buffer, "frame");
+    if (!begin_frame_pipe_stats(r->current_frame, command_buffer)) {
+        return false;
+    }
+
+    clear_render_queue(&r->queue);
+    init_command_state_counters(&r->pc.commands);
+
+    return true;
+}
+
+static bool execute_cull_pass(VkCommandBuffer command_buffer, void *data) {
+    render_backend *r = data;
+    command_state *state = &r->command_state;
+
+    init_command_state_counters(&state->counters);
+    if (!dispatch_gpu_cull(&r->queue, r->cull_pyramid, state)) {
+        return false;
+    }
+    add_command_state_counters(&r->pc.commands, &state->counters);
+
+    return true;
+}
+
+static bool record_async_cull(render_backend *r) {
+    VkCommandBuffer command_buffer = context.compute_command_buffers[r->current_frame];
+    command_state *state = &r->compute_state;
+
+    // the pyramid is from the frame before the last one, the culling overlaps the last frame still rendering
+    r->cull_wait_value = gpu_cull.hiz[r->cull_pyramid].ready_value;
 
-    vkCmdResetQueryPool(command_buffer, query_pool, 0, NUM_TIMESTAMP_QUERIES);
+    begin_command_state(state, command_buffer);
+    init_command_state_counters(&state->counters);
+    begin_compute_gpu_scope(command_buffer, "cull");
+    bool success = dispatch_gpu_cull(&r->queue, r->cull_pyramid, state);
+    end_compute_gpu_scope(command_buffer);
+    add_command_state_counters(&r->pc.commands, &state->counters);
+
+    return success;
+}
+
+static bool execute_draw_pass(VkCommandBuffer command_buffer, void *data) {
+    render_backend *r = data;
+    command_state *state = &r->command_state;
+
+    record_target target;
+    get_record_target(r, &target);
+
+    bool parallel = record_workers.workers_size > 1 &&
+        r->queue.size >= (size_t) render_config.parallel_recording_min_draws;
+    target.depth_prepass = render_config.depth_prepass;
+
+    // outside of the render pass, the secondary command buffers count toward it through inheritance
+    VkExtent2D extent = get_scene_extent();
+    if (begin_pipe_stats_draws(command_buffer, parallel, extent.width * extent.height)) {
+        target.pipeline_statistics = PIPELINE_STATS_FLAGS;
+    }
+
+    const float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    VkClearValue clear_values[2];
+    get_clear_values(clear_values, clear_color, 1.0f, 0);
 
     VkRenderPassBeginInfo render_pass_begin_info = {
         .sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
         .pNext       = NULL,
-        .renderPass  = context.render_pass,
-        .framebuffer = context.framebuffers[r->current_swap_index],
+        .renderPass  = dyn_res.enabled ? dyn_res.render_pass : context.render_pass,
+        .framebuffer = target.framebuffer,
         .renderArea  = {
             .offset  = {
                 .x = 0,
                 .y = 0
             },
-            .extent = context.extent
+            .extent = extent
         },
-        .clearValueCount = 0,
-        .pClearValues    = NULL
+        .clearValueCount = 2,
+        .pClearValues    = clear_values
     };
 
-    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, query_pool, r->query_index[r->current_frame]);
+    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info,
+        parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+    bool success = true;
+    if (parallel) {
+        success = record_draws(&target, r->queue.batches, r->queue.batches_size, command_buffer, &r->pc.commands);
+    } else {
+        init_command_state_counters(&state->counters);
+        set_viewport_command_state(state, &target.viewport);
+        set_scissor_command_state(state, &target.scissor);
+        if (target.depth_prepass) {
+            record_depth_batches(r->queue.batches, r->queue.batches_size, state);
+        }
+        record_draw_batches(r->queue.batches, r->queue.batches_size, state);
+        add_command_state_counters(&r->pc.commands, &state->counters);
+    }
 
-    float clear_color[4] = { 0.0, 0.0, 0.0, 0.0 };
-    clear_frame(r, CLEAR_COLOR_BUFFER | CLEAR_DEPTH_BUFFER, clear_color, 0);
+    vkCmdEndRenderPass(command_buffer);
+    end_pipe_stats_draws(command_buffer);
+
+    return success;
+}
 
-    r->query_index[r->current_frame]++;
+static bool execute_hiz_pass(VkCommandBuffer command_buffer, void *data) {
+    render_backend *r = data;
+    command_state *state = &r->command_state;
+
+    init_command_state_counters(&state->counters);
+    if (!build_hiz_gpu_cull(state, get_scene_extent())) {
+        return false;
+    }
+    add_command_state_counters(&r->pc.commands, &state->counters);
 
     return true;
 }
 
-static bool end_frame(render_backend *r) {
+static bool execute_upscale_pass(VkCommandBuffer command_buffer, void *data) {
+    render_backend *r = data;
+    upscale_dyn_res(command_buffer, context.swapchain_images[r->current_swap_index]);
+
+    return true;
+}
+
+static bool execute_dump_pass(VkCommandBuffer command_buffer, void *data) {
+    render_backend *r = data;
+    record_frame_dump(r->current_frame, command_buffer, context.swapchain_images[r->current_swap_index]);
+
+    return true;
+}
+
+// the passes of a frame, their barriers are synthesized from the resources they declare
+static bool build_frame_graph(render_backend *r) {
+    render_graph *g = &r->graph;
+    reset_render_graph(g);
+
+    uint32_t color = import_image_render_graph(g, "color", context.swapchain_images[r->current_swap_index],
+        context.swapchain_views[r->current_swap_index], VK_IMAGE_ASPECT_COLOR_BIT, NULL);
+    uint32_t depth = import_image_render_graph(g, "depth", context.depth_image.image, context.depth_image.view,
+        VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT, &context.depth_image.layout);
+    if (context.headless) {
+        set_output_render_graph(g, color);
+    } else {
+        set_final_usage_render_graph(g, color, RG_USAGE_PRESENT);
+        // the upscale blit is the first write to the swapchain image, its transition waits for the acquire
+        if (dyn_res.enabled) {
+            set_initial_stages_render_graph(g, color, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        }
+    }
+
+    bool culling = render_config.gpu_culling;
+    bool occlusion = culling && gpu_cull.occlusion;
+    uint32_t draw_commands = RENDER_GRAPH_NONE;
+    if (culling) {
+        draw_commands = import_buffer_render_graph(g, "draw_commands", uniform_ring.buffer.buffer);
+
+        // the commands culled on the async queue are ordered by the timeline
+        if (!r->cull_async) {
+            gpu_culling_pyramid *culled = &gpu_cull.hiz[r->cull_pyramid];
+            uint32_t hiz = import_image_render_graph(g, "hiz", culled->image, culled->view, VK_IMAGE_ASPECT_COLOR_BIT,
+                &culled->layout);
+            culled->pending = true;
+
+            uint32_t cull = add_pass_render_graph(g, "cull", execute_cull_pass, r);
+            use_render_graph(g, cull, hiz, RG_USAGE_COMPUTE_READ);
+            use_render_graph(g, cull, draw_commands, RG_USAGE_COMPUTE_WRITE);
+        }
+    }
+
+    // a scaled scene is rendered on its own target and upscaled into the swapchain image
+    uint32_t scene = color;
+    if (dyn_res.enabled) {
+        scene = import_image_render_graph(g, "scene", dyn_res.color_image, dyn_res.color_view,
+            VK_IMAGE_ASPECT_COLOR_BIT, &dyn_res.color_layout);
+    }
+
+    uint32_t draw = add_pass_render_graph(g, "draw", execute_draw_pass, r);
+    use_attachment_render_graph(g, draw, scene, RG_USAGE_COLOR_ATTACHMENT,
+        dyn_res.enabled || context.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    use_attachment_render_graph(g, draw, depth, RG_USAGE_DEPTH_ATTACHMENT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+    if (culling) {
+        use_render_graph(g, draw, draw_commands, RG_USAGE_INDIRECT_READ);
+    }
+
+    if (dyn_res.enabled) {
+        uint32_t upscale = add_pass_render_graph(g, "upscale", execute_upscale_pass, r);
+        use_render_graph(g, upscale, scene, RG_USAGE_TRANSFER_READ);
+        use_render_graph(g, upscale, color, RG_USAGE_TRANSFER_WRITE);
+    }
+
+    // the pyramid is read by the culling pass of the next frame on graphics or of the one after on the async queue,
+    // the depth written by its render pass. there is no second culling phase against the new pyramid, an object
+    // disoccluded this frame pops in one or two frames late
+    if (occlusion && r->queue.cull_objects_size == 0) {
+        // nothing is culled against them, older pyramids would be stale by the time something is again
+        for (size_t i = 0; i < HIZ_PYRAMIDS; i++) {
+            gpu_cull.hiz[i].valid = false;
+        }
+    } else if (occlusion) {
+        gpu_culling_pyramid *built = &gpu_cull.hiz[get_build_pyramid_gpu_cull()];
+        uint32_t hiz = import_image_render_graph(g, "hiz_build", built->image, built->view,
+            VK_IMAGE_ASPECT_COLOR_BIT, &built->layout);
+        // the culling of earlier frames on graphics, or of this one on the async queue, may still read it
+        set_initial_stages_render_graph(g, hiz, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        built->pending = true;
+
+        uint32_t build_hiz = add_pass_render_graph(g, "hiz", execute_hiz_pass, r);
+        use_render_graph(g, build_hiz, depth, RG_USAGE_DEPTH_SAMPLED);
+        use_render_graph(g, build_hiz, hiz, RG_USAGE_COMPUTE_WRITE);
+        set_final_usage_render_graph(g, hiz, RG_USAGE_COMPUTE_READ);
+        set_final_usage_render_graph(g, depth, RG_USAGE_DEPTH_ATTACHMENT);
+    }
+
+    r->dump_buffer = context.headless ? start_frame_dump(r->current_frame) : VK_NULL_HANDLE;
+    if (r->dump_buffer) {
+        uint32_t dump = import_buffer_render_graph(g, "dump", r->dump_buffer);
+        uint32_t copy = add_pass_render_graph(g, "dump", execute_dump_pass, r);
+        use_render_graph(g, copy, color, RG_USAGE_TRANSFER_READ);
+        use_render_graph(g, copy, dump, RG_USAGE_TRANSFER_WRITE);
+        set_final_usage_render_graph(g, dump, RG_USAGE_HOST_READ);
+    }
+
+    if (!compile_render_graph(g)) {
+        return false;
+    }
+    #ifdef DEBUG
+    if (!r->graph_logged) {
+        log_render_graph(g);
+        r->graph_logged = true;
+    }
+    #endif
+
+    return true;
+}
+
+static bool record_frame(render_backend *r) {
     VkCommandBuffer command_buffer = context.command_buffers[r->current_frame];
 
-    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, context.query_pools[r->current_frame],
-        r->query_index[r->current_frame]);
+    begin_cpu_zone("sort");
+    sort_render_queue(&r->queue);
+    end_cpu_zone();
+    begin_cpu_zone("build_batches");
+    bool built = build_batches_render_queue(&r->queue, render_config.gpu_culling);
+    end_cpu_zone();
+    if (!built) {
+        return false;
+    }
 
-    vkCmdEndRenderPass(command_buffer);
+    if (r->cull_async && !record_async_cull(r)) {
+        log_error("Unable to record the async culling");
+        return false;
+    }
+
+    begin_cpu_zone("build_graph");
+    built = build_frame_graph(r);
+    end_cpu_zone();
+    if (!built) {
+        log_error("Unable to build the frame graph");
+        return false;
+    }
+
+    begin_command_state(&r->command_state, command_buffer);
+    return execute_render_graph(&r->graph, command_buffer);
+}
+
+static bool end_frame(render_backend *r) {
+    VkCommandBuffer command_buffer = context.command_buffers[r->current_frame];
 
-    r->query_index[r->current_frame]++;
+    end_gpu_scope(command_buffer);
+    end_frame_gpu_prof();
 
     CHECK_VK(vkEndCommandBuffer(command_buffer));
     r->command_buffer_recorded[r->current_frame] = true;
 
-    VkSemaphore *acquire_semaphore = &context.acquire_semaphores[r->current_frame];
-    VkSemaphore *render_complete_semaphore = &context.render_complete_semaphores[r->current_frame];
+    VkSemaphore *render_complete_semaphore = &context.render_complete_semaphores[r->current_swap_index];
+
+    // binary semaphores take no value, they are listed with a zero one next to the timelines
+    VkSemaphore wait_semaphores[2], signal_semaphores[2];
+    VkPipelineStageFlags wait_stages[2];
+    uint64_t wait_values[2], signal_values[2];
+    uint32_t waits_size = 0, signals_size = 0;
+    if (!context.headless) {
+        // the render pass or the upscale blit is the first to touch the swapchain image
+        wait_semaphores[waits_size] = context.acquire_semaphores[r->current_frame];
+        wait_stages[waits_size] = dyn_res.enabled ? VK_PIPELINE_STAGE_TRANSFER_BIT :
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        wait_values[waits_size++] = 0;
+        signal_semaphores[signals_size] = *render_complete_semaphore;
+        signal_values[signals_size++] = 0;
+    }
 
-    VkPipelineStageFlags dst_stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    begin_cpu_zone("submit");
+    // only the indirect draws and the compute passes wait for the culled commands, the passes before them overlap
+    if (r->cull_async) {
+        VkCommandBuffer compute_buffer = context.compute_command_buffers[r->current_frame];
+        CHECK_VK(vkEndCommandBuffer(compute_buffer));
+        if (!submit_compute_vulkan(&context, compute_buffer, r->cull_wait_value)) {
+            end_cpu_zone();
+            return false;
+        }
+        wait_semaphores[waits_size] = context.compute_timeline;
+        wait_stages[waits_size] = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        wait_values[waits_size++] = context.compute_timeline_value;
+    }
+    if (context.async_compute) {
+        signal_semaphores[signals_size] = context.graphics_timeline;
+        signal_values[signals_size++] = context.graphics_timeline_value + 1;
+    }
+
+    VkTimelineSemaphoreSubmitInfoKHR timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = waits_size,
+        .pWaitSemaphoreValues = wait_values,
+        .signalSemaphoreValueCount = signals_size,
+        .pSignalSemaphoreValues = signal_values
+    };
 
     VkSubmitInfo submit_info = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = NULL,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = acquire_semaphore,
-        .pWaitDstStageMask = &dst_stage_mask,
+        .pNext = context.async_compute ? &timeline_info : NULL,
+        .waitSemaphoreCount = waits_size,
+        .pWaitSemaphores = wait_semaphores,
+        .pWaitDstStageMask = wait_stages,
         .commandBufferCount = 1,
         .pCommandBuffers = &command_buffer,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores = render_complete_semaphore
+        .signalSemaphoreCount = signals_size,
+        .pSignalSemaphores = signal_semaphores
     };
 
-    CHECK_VK(vkQueueSubmit(context.graphics_queue, 1, &submit_info, context.command_buffer_fences[r->current_frame]));
-    if (!block_swap_buffers_render_backend(&renderer)) {
-        log_error("Unable to swap buffers");
-        return false;
+    VkResult result = vkQueueSubmit(context.graphics_queue, 1, &submit_info,
+        context.command_buffer_fences[r->current_frame]);
+    end_cpu_zone();
+    CHECK_VK(result);
+    if (context.async_compute) {
+        context.graphics_timeline_value++;
+    }
+    // the async culling waits for the submit that built its pyramid or moved it into the layout it is sampled in
+    for (size_t i = 0; i < HIZ_PYRAMIDS; i++) {
+        if (gpu_cull.hiz[i].pending) {
+            gpu_cull.hiz[i].ready_value = context.graphics_timeline_value;
+            gpu_cull.hiz[i].pending = false;
+        }
+    }
+
+    if (context.headless) {
+        r->current_frame = (r->current_frame + 1) % context.frames_in_flight;
+        return true;
     }
 
     VkPresentInfoKHR present_info = {
@@ -217,44 +596,94 @@ static bool end_frame(render_backend *r) {
         .pResults = NULL
     };
 
-    CHECK_VK(vkQueuePresentKHR(context.present_queue, &present_info));
+    begin_cpu_zone("present");
+    result = vkQueuePresentKHR(context.present_queue, &present_info);
+    end_cpu_zone();
+    // the semaphore wait still happens, the swapchain is recreated once the next frame slot is free
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        r->resize_pending = true;
+    } else {
+        CHECK_VK(result);
+    }
 
-    r->current_frame = (r->current_frame + 1) % NUM_FRAME_DATA;
+    r->current_frame = (r->current_frame + 1) % context.frames_in_flight;
 
     return true;
 }
 
+typedef struct draw_data {
+    mat4 model;
+    float position_scale[4];
+} draw_data;
+
 static bool draw(render_backend *r) {
-    VkCommandBuffer command_buffer = context.command_buffers[r->current_frame];
-    bool success = bind_program_instance(RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE) &&
-        commit_current_program(RST_BASIC_3D, command_buffer);
-    if (!success) {
+    if (!bind_program_instance(RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INDIRECT)) {
         return false;
     }
 
-    VkDeviceSize offset = 0;
-    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_cache.static_buffer.buffer, &offset);
-    vkCmdBindIndexBuffer(command_buffer, vertex_cache.static_buffer.buffer, 2080, VK_INDEX_TYPE_UINT32);
+    mat4 view_projection;
+    perspective(view_projection, 90.0f, 4.0f / 3.0f, 0.0f, 200.0f);
+    set_view_gpu_cull(view_projection);
 
-    vkCmdDrawIndexed(command_buffer, 192, 1, 0, 0, 0);
+    draw_packet packet;
+    init_draw_packet(&packet);
+    if (!set_program_draw_packet(&packet, RST_BASIC_3D) ||
+        !alloc_uniform_block(view_projection, sizeof(mat4), &packet.dynamic_offset))
+    {
+        return false;
+    }
 
-    return true;
+    const static_mesh *mesh = &vertex_cache.static_meshes[0];
+    set_static_mesh_draw_packet(&packet, mesh);
+    set_material_draw_packet(&packet, 0);
+    set_depth_draw_packet(&packet, 3.0f / 200.0f);
+
+    draw_data data;
+    identity_mat4(data.model);
+    set_mat4(data.model, 0, 3, 2.0f);
+    set_mat4(data.model, 1, 3, -3.0f);
+    set_mat4(data.model, 2, 3, -3.0f);
+    data.position_scale[0] = mesh->position_scale;
+    data.position_scale[1] = mesh->position_scale;
+    data.position_scale[2] = mesh->position_scale;
+    data.position_scale[3] = 1.0f;
+
+    return set_draw_data_draw_packet(&packet, &data, sizeof(data)) &&
+        add_render_queue(&r->queue, &packet);
 }
 
 bool execute_render_backend(render_backend *r) {
-    bool success = start_frame(r);
+    bool started = false;
+    begin_cpu_zone("start_frame");
+    bool success = start_frame(r, &started);
+    end_cpu_zone();
     if (!success) {
         log_error("Unable to start a frame");
         return false;
     }
+    if (!started) {
+        return true;
+    }
 
-    success = draw(r);
+    begin_cpu_zone("draw");
+    success = r->draw_scene ? r->draw_scene(&r->queue, r->draw_scene_data) : draw(r);
+    end_cpu_zone();
     if (!success) {
         log_error("Unable to draw stuff");
         return false;
     }
 
+    begin_cpu_zone("record_frame");
+    success = record_frame(r);
+    end_cpu_zone();
+    if (!success) {
+        log_error("Unable to record a frame");
+        return false;
+    }
+
+    begin_cpu_zone("end_frame");
     success = end_frame(r);
+    end_cpu_zone();
     if (!success) {
         log_error("Unable to finish a frame");
         return false;
@@ -274,11 +703,53 @@ bool block_swap_buffers_render_backend(render_backend *r) {
     return true;
 }
 
-void init_renderer() {
+void resize_render_backend(render_backend *r) {
+    r->resize_pending = true;
+}
+
+void set_draw_scene_render_backend(render_backend *r, draw_scene_function draw_scene, void *data) {
+    r->draw_scene = draw_scene;
+    r->draw_scene_data = data;
+}
+
+bool init_renderer() {
     init_render_backend(&renderer);
+
+    return alloc_render_queue(&renderer.queue, render_config.max_draw_packets) &&
+        init_record_workers(render_config.recording_threads) &&
+        init_gpu_prof() &&
+        init_pipe_stats() &&
+        init_frame_dump() &&
+        (!render_config.gpu_culling || init_gpu_cull()) &&
+        init_dyn_res();
+}
+
+void destroy_renderer() {
+    if (context.device && vkDeviceWaitIdle) {
+        vkDeviceWaitIdle(context.device);
+    }
+    if (!flush_frame_dump()) {
+        log_warning("Unable to dump the last frames");
+    }
+    destroy_frame_dump();
+    destroy_render_graph(&renderer.graph);
+    destroy_dyn_res();
+    destroy_gpu_cull();
+    destroy_pipe_stats();
+    destroy_gpu_prof();
+    destroy_record_workers();
+    destroy_render_queue(&renderer.queue);
 }
 
 bool render() {
     return execute_render_backend(&renderer);
 }
 
+void resize_renderer() {
+    resize_render_backend(&renderer);
+}
+
+void set_draw_scene(draw_scene_function draw_scene, void *data) {
+    set_draw_scene_render_backend(&renderer, draw_scene, data);
+}
+
@@ -5,21 +5,42 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "../vulkan/config.h"
-
-#define CLEAR_COLOR_BUFFER   1
-#define CLEAR_DEPTH_BUFFER   2
-#define CLEAR_STENCIL_BUFFER 4
+#include "./render_queue.h"
+#include "./command_state.h"
+#include "./render_graph.h"
 
 typedef struct backend_counters {
+    // of the last frame whose timestamps were available, gpu_latency_frames before the current one
     uint64_t gpu_microsec;
+    uint32_t gpu_latency_frames;
+    // state changes issued and filtered out while recording the last frame
+    command_state_counters commands;
 } backend_counters;
 
+// fills the render queue of a frame in place of the built-in scene
+typedef bool (*draw_scene_function)(render_queue *q, void *data);
+
 typedef struct render_backend {
     uint32_t current_frame, current_swap_index;
-    uint64_t query_results[NUM_FRAME_DATA][NUM_TIMESTAMP_QUERIES];
-    uint32_t query_index[NUM_FRAME_DATA];
-    bool command_buffer_recorded[NUM_FRAME_DATA];
+    bool command_buffer_recorded[MAX_FRAMES_IN_FLIGHT];
+    render_queue queue;
+    command_state command_state;
+    // the culling recorded into the command buffer of the async compute queue
+    command_state compute_state;
+    bool cull_async;
+    // the depth pyramid culled against this frame
+    uint32_t cull_pyramid;
+    // graphics timeline value of the submit that built that pyramid or first moved it into its layout
+    uint64_t cull_wait_value;
     backend_counters pc;
+    draw_scene_function draw_scene;
+    void *draw_scene_data;
+    // declared again every frame, only its transient images outlive it
+    render_graph graph;
+    bool graph_logged;
+    VkBuffer dump_buffer;
+    // the swapchain is recreated at the start of the next frame, after the fence of its slot
+    bool resize_pending;
 } render_backend;
 
 extern render_backend renderer;
@@ -29,8 +50,14 @@ void init_backend_counters(backend_counters *b);
 void init_render_backend(render_backend *r);
 bool execute_render_backend(render_backend *r);
 bool block_swap_buffers_render_backend(render_backend *r);
+void resize_render_backend(render_backend *r);
+void set_draw_scene_render_backend(render_backend *r, draw_scene_function draw_scene, void *data);
 
-void init_renderer();
+bool init_renderer();
+void destroy_renderer();
 bool render();
+// after the window was resized, out of date swapchains are noticed without it
+void resize_renderer();
+void set_draw_scene(draw_scene_function draw_scene, void *data);
 
 #endif // RENDERER_BACKEND_H
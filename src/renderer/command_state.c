@@ -0,0 +1,294 @@
+#include "./command_state.h"
+
+#include <string.h>
+#include "../vulkan/functions/functions.h"
+
+static command_state_bind_point *get_bind_point(command_state *state, VkPipelineBindPoint bind_point) {
+    return &state->bind_points[bind_point == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0];
+}
+
+static void init_command_state_bind_point(command_state_bind_point *bp) {
+    bp->pipeline = VK_NULL_HANDLE;
+    bp->pipeline_layout = VK_NULL_HANDLE;
+    for (size_t i = 0; i < MAX_COMMAND_STATE_DESCRIPTOR_SETS; i++) {
+        bp->descriptor_sets[i] = VK_NULL_HANDLE;
+        bp->dynamic_offsets_size[i] = 0;
+    }
+}
+
+static bool is_viewport_equal(const VkViewport *a, const VkViewport *b) {
+    return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height &&
+        a->minDepth == b->minDepth && a->maxDepth == b->maxDepth;
+}
+
+static bool is_scissor_equal(const VkRect2D *a, const VkRect2D *b) {
+    return a->offset.x == b->offset.x && a->offset.y == b->offset.y &&
+        a->extent.width == b->extent.width && a->extent.height == b->extent.height;
+}
+
+void init_command_state_counters(command_state_counters *counters) {
+    for (size_t i = 0; i < COMMAND_STATE_CALLS_TOTAL; i++) {
+        counters->issued[i] = 0;
+        counters->skipped[i] = 0;
+    }
+}
+
+void add_command_state_counters(command_state_counters *dest, const command_state_counters *src) {
+    for (size_t i = 0; i < COMMAND_STATE_CALLS_TOTAL; i++) {
+        dest->issued[i] += src->issued[i];
+        dest->skipped[i] += src->skipped[i];
+    }
+}
+
+uint32_t get_issued_command_state_counters(const command_state_counters *counters) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < COMMAND_STATE_CALLS_TOTAL; i++) {
+        total += counters->issued[i];
+    }
+    return total;
+}
+
+uint32_t get_skipped_command_state_counters(const command_state_counters *counters) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < COMMAND_STATE_CALLS_TOTAL; i++) {
+        total += counters->skipped[i];
+    }
+    return total;
+}
+
+void init_command_state(command_state *state) {
+    begin_command_state(state, VK_NULL_HANDLE);
+    init_command_state_counters(&state->counters);
+}
+
+void begin_command_state(command_state *state, VkCommandBuffer command_buffer) {
+    state->command_buffer = command_buffer;
+
+    init_command_state_bind_point(&state->bind_points[0]);
+    init_command_state_bind_point(&state->bind_points[1]);
+
+    state->push_constants_layout = VK_NULL_HANDLE;
+    state->push_constants_stages = 0;
+    state->push_constants_size = 0;
+
+    for (size_t i = 0; i < MAX_COMMAND_STATE_VERTEX_BUFFERS; i++) {
+        state->vertex_buffers[i] = VK_NULL_HANDLE;
+        state->vertex_offsets[i] = 0;
+    }
+
+    state->index_buffer = VK_NULL_HANDLE;
+    state->index_offset = 0;
+    state->index_type = VK_INDEX_TYPE_UINT32;
+
+    state->viewport_valid = false;
+    state->scissor_valid = false;
+    state->stencil_reference_valid[0] = false;
+    state->stencil_reference_valid[1] = false;
+}
+
+void bind_pipeline_command_state(command_state *state, VkPipelineBindPoint bind_point, VkPipeline pipeline) {
+    command_state_bind_point *bp = get_bind_point(state, bind_point);
+    if (bp->pipeline == pipeline) {
+        state->counters.skipped[COMMAND_STATE_CALL_PIPELINE]++;
+        return;
+    }
+
+    vkCmdBindPipeline(state->command_buffer, bind_point, pipeline);
+    bp->pipeline = pipeline;
+    state->counters.issued[COMMAND_STATE_CALL_PIPELINE]++;
+
+    // pipelines bake the stencil reference, binding one leaves the dynamic value undefined
+    if (bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS) {
+        state->stencil_reference_valid[0] = false;
+        state->stencil_reference_valid[1] = false;
+    }
+}
+
+void bind_descriptor_sets_command_state(command_state *state, VkPipelineBindPoint bind_point,
+    VkPipelineLayout pipeline_layout, uint32_t first_set, uint32_t descriptor_sets_size,
+    const VkDescriptorSet *descriptor_sets, uint32_t dynamic_offsets_size, const uint32_t *dynamic_offsets)
+{
+    command_state_bind_point *bp = get_bind_point(state, bind_point);
+
+    if (bp->pipeline_layout != pipeline_layout) {
+        for (size_t i = 0; i < MAX_COMMAND_STATE_DESCRIPTOR_SETS; i++) {
+            bp->descriptor_sets[i] = VK_NULL_HANDLE;
+        }
+        bp->pipeline_layout = pipeline_layout;
+    }
+
+    // dynamic offsets can only be attributed to a set when a single set is bound
+    bool trackable = first_set + descriptor_sets_size <= MAX_COMMAND_STATE_DESCRIPTOR_SETS &&
+        dynamic_offsets_size <= MAX_COMMAND_STATE_DYNAMIC_OFFSETS &&
+        (descriptor_sets_size == 1 || dynamic_offsets_size == 0);
+
+    if (trackable) {
+        bool redundant = true;
+        for (uint32_t i = 0; i < descriptor_sets_size && redundant; i++) {
+            uint32_t set = first_set + i;
+            redundant = bp->descriptor_sets[set] == descriptor_sets[i] &&
+                bp->dynamic_offsets_size[set] == dynamic_offsets_size &&
+                memcmp(bp->dynamic_offsets[set], dynamic_offsets, sizeof(uint32_t) * dynamic_offsets_size) == 0;
+        }
+        if (redundant) {
+            state->counters.skipped[COMMAND_STATE_CALL_DESCRIPTOR_SETS]++;
+            return;
+        }
+    }
+
+    vkCmdBindDescriptorSets(state->command_buffer, bind_point, pipeline_layout, first_set, descriptor_sets_size,
+        descriptor_sets, dynamic_offsets_size, dynamic_offsets);
+    state->counters.issued[COMMAND_STATE_CALL_DESCRIPTOR_SETS]++;
+
+    for (uint32_t i = 0; i < descriptor_sets_size && first_set + i < MAX_COMMAND_STATE_DESCRIPTOR_SETS; i++) {
+        uint32_t set = first_set + i;
+        bp->descriptor_sets[set] = trackable ? descriptor_sets[i] : VK_NULL_HANDLE;
+        bp->dynamic_offsets_size[set] = trackable ? dynamic_offsets_size : 0;
+        if (trackable) {
+            memcpy(bp->dynamic_offsets[set], dynamic_offsets, sizeof(uint32_t) * dynamic_offsets_size);
+        }
+    }
+}
+
+void push_constants_command_state(command_state *state, VkPipelineLayout pipeline_layout, VkShaderStageFlags stages,
+    uint32_t size, const void *data)
+{
+    if (state->push_constants_layout == pipeline_layout && state->push_constants_stages == stages &&
+        state->push_constants_size == size && memcmp(state->push_constants, data, size) == 0)
+    {
+        state->counters.skipped[COMMAND_STATE_CALL_PUSH_CONSTANTS]++;
+        return;
+    }
+
+    vkCmdPushConstants(state->command_buffer, pipeline_layout, stages, 0, size, data);
+    state->counters.issued[COMMAND_STATE_CALL_PUSH_CONSTANTS]++;
+
+    if (size <= MAX_COMMAND_STATE_PUSH_CONSTANTS_SIZE) {
+        state->push_constants_layout = pipeline_layout;
+        state->push_constants_stages = stages;
+        state->push_constants_size = size;
+        memcpy(state->push_constants, data, size);
+    } else {
+        state->push_constants_layout = VK_NULL_HANDLE;
+    }
+}
+
+void bind_vertex_buffers_command_state(command_state *state, uint32_t first_binding, uint32_t buffers_size,
+    const VkBuffer *buffers, const VkDeviceSize *offsets)
+{
+    bool trackable = first_binding + buffers_size <= MAX_COMMAND_STATE_VERTEX_BUFFERS;
+
+    if (trackable) {
+        bool redundant = true;
+        for (uint32_t i = 0; i < buffers_size && redundant; i++) {
+            redundant = state->vertex_buffers[first_binding + i] == buffers[i] &&
+                state->vertex_offsets[first_binding + i] == offsets[i];
+        }
+        if (redundant) {
+            state->counters.skipped[COMMAND_STATE_CALL_VERTEX_BUFFERS]++;
+            return;
+        }
+    }
+
+    vkCmdBindVertexBuffers(state->command_buffer, first_binding, buffers_size, buffers, offsets);
+    state->counters.issued[COMMAND_STATE_CALL_VERTEX_BUFFERS]++;
+
+    for (uint32_t i = 0; i < buffers_size && first_binding + i < MAX_COMMAND_STATE_VERTEX_BUFFERS; i++) {
+        state->vertex_buffers[first_binding + i] = buffers[i];
+        state->vertex_offsets[first_binding + i] = offsets[i];
+    }
+}
+
+void bind_index_buffer_command_state(command_state *state, VkBuffer buffer, VkDeviceSize offset,
+    VkIndexType index_type)
+{
+    if (state->index_buffer == buffer && state->index_offset == offset && state->index_type == index_type) {
+        state->counters.skipped[COMMAND_STATE_CALL_INDEX_BUFFER]++;
+        return;
+    }
+
+    vkCmdBindIndexBuffer(state->command_buffer, buffer, offset, index_type);
+    state->counters.issued[COMMAND_STATE_CALL_INDEX_BUFFER]++;
+
+    state->index_buffer = buffer;
+    state->index_offset = offset;
+    state->index_type = index_type;
+}
+
+void set_viewport_command_state(command_state *state, const VkViewport *viewport) {
+    if (state->viewport_valid && is_viewport_equal(&state->viewport, viewport)) {
+        state->counters.skipped[COMMAND_STATE_CALL_VIEWPORT]++;
+        return;
+    }
+
+    vkCmdSetViewport(state->command_buffer, 0, 1, viewport);
+    state->counters.issued[COMMAND_STATE_CALL_VIEWPORT]++;
+
+    state->viewport = *viewport;
+    state->viewport_valid = true;
+}
+
+void set_scissor_command_state(command_state *state, const VkRect2D *scissor) {
+    if (state->scissor_valid && is_scissor_equal(&state->scissor, scissor)) {
+        state->counters.skipped[COMMAND_STATE_CALL_SCISSOR]++;
+        return;
+    }
+
+    vkCmdSetScissor(state->command_buffer, 0, 1, scissor);
+    state->counters.issued[COMMAND_STATE_CALL_SCISSOR]++;
+
+    state->scissor = *scissor;
+    state->scissor_valid = true;
+}
+
+void set_stencil_reference_command_state(command_state *state, VkStencilFaceFlags face_mask, uint32_t reference) {
+    bool front = face_mask & VK_STENCIL_FACE_FRONT_BIT;
+    bool back = face_mask & VK_STENCIL_FACE_BACK_BIT;
+    bool front_redundant = !front || (state->stencil_reference_valid[0] && state->stencil_reference[0] == reference);
+    bool back_redundant = !back || (state->stencil_reference_valid[1] && state->stencil_reference[1] == reference);
+    if (front_redundant && back_redundant) {
+        state->counters.skipped[COMMAND_STATE_CALL_STENCIL_REFERENCE]++;
+        return;
+    }
+
+    vkCmdSetStencilReference(state->command_buffer, face_mask, reference);
+    state->counters.issued[COMMAND_STATE_CALL_STENCIL_REFERENCE]++;
+
+    if (front) {
+        state->stencil_reference_valid[0] = true;
+        state->stencil_reference[0] = reference;
+    }
+    if (back) {
+        state->stencil_reference_valid[1] = true;
+        state->stencil_reference[1] = reference;
+    }
+}
+
+void draw_indexed_command_state(command_state *state, uint32_t index_count, uint32_t instance_count,
+    uint32_t first_index, int32_t vertex_offset, uint32_t first_instance)
+{
+    vkCmdDrawIndexed(state->command_buffer, index_count, instance_count, first_index, vertex_offset, first_instance);
+    state->counters.issued[COMMAND_STATE_CALL_DRAW]++;
+}
+
+void draw_indexed_indirect_command_state(command_state *state, VkBuffer buffer, VkDeviceSize offset,
+    uint32_t draw_count, uint32_t stride)
+{
+    vkCmdDrawIndexedIndirect(state->command_buffer, buffer, offset, draw_count, stride);
+    state->counters.issued[COMMAND_STATE_CALL_DRAW]++;
+}
+
+void draw_indexed_indirect_count_command_state(command_state *state, VkBuffer buffer, VkDeviceSize offset,
+    VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride)
+{
+    vkCmdDrawIndexedIndirectCountKHR(state->command_buffer, buffer, offset, count_buffer, count_offset,
+        max_draw_count, stride);
+    state->counters.issued[COMMAND_STATE_CALL_DRAW]++;
+}
+
+void dispatch_command_state(command_state *state, uint32_t group_count_x, uint32_t group_count_y,
+    uint32_t group_count_z)
+{
+    vkCmdDispatch(state->command_buffer, group_count_x, group_count_y, group_count_z);
+    state->counters.issued[COMMAND_STATE_CALL_DISPATCH]++;
+}
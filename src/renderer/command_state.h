@@ -0,0 +1,101 @@
+#ifndef COMMAND_STATE_H
+#define COMMAND_STATE_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_COMMAND_STATE_DESCRIPTOR_SETS 4
+#define MAX_COMMAND_STATE_DYNAMIC_OFFSETS 4
+#define MAX_COMMAND_STATE_VERTEX_BUFFERS 4
+#define MAX_COMMAND_STATE_PUSH_CONSTANTS_SIZE 128
+
+typedef enum command_state_call {
+    COMMAND_STATE_CALL_PIPELINE,
+    COMMAND_STATE_CALL_DESCRIPTOR_SETS,
+    COMMAND_STATE_CALL_PUSH_CONSTANTS,
+    COMMAND_STATE_CALL_VERTEX_BUFFERS,
+    COMMAND_STATE_CALL_INDEX_BUFFER,
+    COMMAND_STATE_CALL_VIEWPORT,
+    COMMAND_STATE_CALL_SCISSOR,
+    COMMAND_STATE_CALL_STENCIL_REFERENCE,
+    COMMAND_STATE_CALL_DRAW,
+    COMMAND_STATE_CALL_DISPATCH,
+    COMMAND_STATE_CALLS_TOTAL
+} command_state_call;
+
+typedef struct command_state_counters {
+    uint32_t issued[COMMAND_STATE_CALLS_TOTAL];
+    uint32_t skipped[COMMAND_STATE_CALLS_TOTAL];
+} command_state_counters;
+
+typedef struct command_state_bind_point {
+    VkPipeline pipeline;
+    VkPipelineLayout pipeline_layout;
+    VkDescriptorSet descriptor_sets[MAX_COMMAND_STATE_DESCRIPTOR_SETS];
+    uint32_t dynamic_offsets[MAX_COMMAND_STATE_DESCRIPTOR_SETS][MAX_COMMAND_STATE_DYNAMIC_OFFSETS];
+    uint32_t dynamic_offsets_size[MAX_COMMAND_STATE_DESCRIPTOR_SETS];
+} command_state_bind_point;
+
+// shadow of the state bound in one command buffer, has to be reset whenever recording starts
+typedef struct command_state {
+    VkCommandBuffer command_buffer;
+
+    // graphics and compute
+    command_state_bind_point bind_points[2];
+
+    VkPipelineLayout push_constants_layout;
+    VkShaderStageFlags push_constants_stages;
+    uint32_t push_constants_size;
+    unsigned char push_constants[MAX_COMMAND_STATE_PUSH_CONSTANTS_SIZE];
+
+    VkBuffer vertex_buffers[MAX_COMMAND_STATE_VERTEX_BUFFERS];
+    VkDeviceSize vertex_offsets[MAX_COMMAND_STATE_VERTEX_BUFFERS];
+
+    VkBuffer index_buffer;
+    VkDeviceSize index_offset;
+    VkIndexType index_type;
+
+    bool viewport_valid;
+    VkViewport viewport;
+    bool scissor_valid;
+    VkRect2D scissor;
+    bool stencil_reference_valid[2];
+    uint32_t stencil_reference[2];
+
+    command_state_counters counters;
+} command_state;
+
+void init_command_state_counters(command_state_counters *counters);
+void add_command_state_counters(command_state_counters *dest, const command_state_counters *src);
+uint32_t get_issued_command_state_counters(const command_state_counters *counters);
+uint32_t get_skipped_command_state_counters(const command_state_counters *counters);
+
+void init_command_state(command_state *state);
+// forgets the shadowed state but keeps the counters
+void begin_command_state(command_state *state, VkCommandBuffer command_buffer);
+
+void bind_pipeline_command_state(command_state *state, VkPipelineBindPoint bind_point, VkPipeline pipeline);
+void bind_descriptor_sets_command_state(command_state *state, VkPipelineBindPoint bind_point,
+    VkPipelineLayout pipeline_layout, uint32_t first_set, uint32_t descriptor_sets_size,
+    const VkDescriptorSet *descriptor_sets, uint32_t dynamic_offsets_size, const uint32_t *dynamic_offsets);
+void push_constants_command_state(command_state *state, VkPipelineLayout pipeline_layout, VkShaderStageFlags stages,
+    uint32_t size, const void *data);
+void bind_vertex_buffers_command_state(command_state *state, uint32_t first_binding, uint32_t buffers_size,
+    const VkBuffer *buffers, const VkDeviceSize *offsets);
+void bind_index_buffer_command_state(command_state *state, VkBuffer buffer, VkDeviceSize offset,
+    VkIndexType index_type);
+void set_viewport_command_state(command_state *state, const VkViewport *viewport);
+void set_scissor_command_state(command_state *state, const VkRect2D *scissor);
+void set_stencil_reference_command_state(command_state *state, VkStencilFaceFlags face_mask, uint32_t reference);
+void draw_indexed_command_state(command_state *state, uint32_t index_count, uint32_t instance_count,
+    uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
+void draw_indexed_indirect_command_state(command_state *state, VkBuffer buffer, VkDeviceSize offset,
+    uint32_t draw_count, uint32_t stride);
+void draw_indexed_indirect_count_command_state(command_state *state, VkBuffer buffer, VkDeviceSize offset,
+    VkBuffer count_buffer, VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride);
+void dispatch_command_state(command_state *state, uint32_t group_count_x, uint32_t group_count_y,
+    uint32_t group_count_z);
+
+#endif // COMMAND_STATE_H
@@ -3,5 +3,20 @@
 renderer_configuration render_config = {
     .width = 1920,
     .height = 1080,
-    .desired_sample_count = 1
+    .desired_sample_count = 1,
+    .recording_threads = 4,
+    .parallel_recording_min_draws = 512,
+    .max_draw_packets = 128 * 1024,
+    .gpu_culling = true,
+    .depth_prepass = false,
+    .dynamic_resolution = false,
+    // under the 16.7 ms of a 60 Hz display, with room for presenting
+    .frame_budget_ms = 15.0f,
+    .async_compute = true,
+    .bindless = false,
+    .frames_in_flight = 2,
+    .headless = false,
+    .headless_frames = 300,
+    .dump_directory = NULL,
+    .dump_interval = 0
 };
@@ -1,12 +1,36 @@
 #ifndef RENDERER_CONFIG_H
 #define RENDERER_CONFIG_H
 
-#define MAX_DECRIPTOR_SETS 100
+#include <stddef.h>
+#include <stdbool.h>
 
 typedef struct renderer_configuration {
     int width;
     int height;
     int desired_sample_count;
+    int recording_threads;
+    int parallel_recording_min_draws;
+    int max_draw_packets;
+    bool gpu_culling;
+    // draws depth alone first so shading runs once per pixel, for the programs that have a depth program
+    bool depth_prepass;
+    // renders the scene at a scale that keeps the GPU frame time within frame_budget_ms, then upscales it
+    bool dynamic_resolution;
+    float frame_budget_ms;
+    // culls on a compute-only queue next to the graphics one, when the device has one and timeline semaphores
+    bool async_compute;
+    // one update-after-bind descriptor array for all textures and storage buffers, when the device allows it
+    bool bindless;
+    // frames the CPU may record ahead of the GPU, 1 for the lowest latency, up to 4 for throughput
+    int frames_in_flight;
+    // render offscreen without a window, presenting nothing
+    bool headless;
+    // frames a headless run renders before it exits
+    int headless_frames;
+    // headless frames are written here as PPM images when set
+    const char *dump_directory;
+    // every how many frames to write, 0 for the last frame only
+    int dump_interval;
 } renderer_configuration;
 
 extern renderer_configuration render_config;
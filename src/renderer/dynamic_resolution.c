@@ -0,0 +1,265 @@
+#include "./dynamic_resolution.h"
+
+#include <math.h>
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/tools/tools.h"
+#include "../vulkan/context.h"
+#include "../vulkan/gpu_info.h"
+#include "../logger/logger.h"
+#include "./config.h"
+
+dynamic_resolution dyn_res;
+
+void init_dynamic_resolution(dynamic_resolution *d) {
+    d->color_image = VK_NULL_HANDLE;
+    init_vk_allocation(&d->color_allocation);
+    d->color_view = VK_NULL_HANDLE;
+    d->color_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    d->render_pass = VK_NULL_HANDLE;
+    d->framebuffer = VK_NULL_HANDLE;
+    d->enabled = false;
+    d->budget_ms = 0.0f;
+    d->scale = DYNAMIC_RESOLUTION_MAX_SCALE;
+    d->smoothed_ms = 0.0f;
+    d->total_samples = 0;
+    d->extent.width = 0;
+    d->extent.height = 0;
+}
+
+static bool is_supported() {
+    const gpu_info *gpu = &context.gpus[context.selected_gpu];
+    VkFormatFeatureFlags features = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+        VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(gpu->device, context.surface_format.format, &props);
+    if ((props.optimalTilingFeatures & features) != features) {
+        log_warning("The surface format can not be blitted with a linear filter, dynamic resolution is disabled");
+        return false;
+    }
+    if (!context.headless && !(gpu->surface_caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+        log_warning("The swapchain images can not be blitted to, dynamic resolution is disabled");
+        return false;
+    }
+
+    return true;
+}
+
+static bool create_color_image(dynamic_resolution *d) {
+    VkImageCreateInfo image_info = {
+        .sType     = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext     = NULL,
+        .flags     = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format    = context.surface_format.format,
+        .extent    = {
+            .width  = context.extent.width,
+            .height = context.extent.height,
+            .depth  = 1
+        },
+        .mipLevels             = 1,
+        .arrayLayers           = 1,
+        .samples               = VK_SAMPLE_COUNT_1_BIT,
+        .tiling                = VK_IMAGE_TILING_OPTIMAL,
+        .usage                 = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices   = NULL,
+        .initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    CHECK_VK(vkCreateImage(context.device, &image_info, NULL, &d->color_image));
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(context.device, d->color_image, &memory_requirements);
+
+    bool success = vk_allocate(&d->color_allocation, memory_requirements.size, memory_requirements.alignment,
+        memory_requirements.memoryTypeBits, VULKAN_MEMORY_USAGE_GPU_ONLY, VULKAN_ALLOCATION_TYPE_IMAGE_OPTIMAL);
+    if (!success) {
+        log_error("Unable to allocate the scaled scene");
+        return false;
+    }
+
+    CHECK_VK(vkBindImageMemory(context.device, d->color_image, d->color_allocation.device_memory,
+        d->color_allocation.offset));
+
+    VkImageViewCreateInfo view_info = {
+        .sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext      = NULL,
+        .flags      = 0,
+        .image      = d->color_image,
+        .viewType   = VK_IMAGE_VIEW_TYPE_2D,
+        .format     = context.surface_format.format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_R,
+            .g = VK_COMPONENT_SWIZZLE_G,
+            .b = VK_COMPONENT_SWIZZLE_B,
+            .a = VK_COMPONENT_SWIZZLE_A
+        },
+        .subresourceRange = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel   = 0,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        }
+    };
+
+    CHECK_VK(vkCreateImageView(context.device, &view_info, NULL, &d->color_view));
+
+    return true;
+}
+
+static bool create_framebuffer(dynamic_resolution *d) {
+    VkImageView attachments[] = { d->color_view, context.depth_image.view };
+    VkFramebufferCreateInfo framebuffer_info = {
+        .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .pNext           = NULL,
+        .flags           = 0,
+        .renderPass      = d->render_pass,
+        .attachmentCount = 2,
+        .pAttachments    = attachments,
+        .width           = context.extent.width,
+        .height          = context.extent.height,
+        .layers          = 1
+    };
+    CHECK_VK(vkCreateFramebuffer(context.device, &framebuffer_info, NULL, &d->framebuffer));
+
+    return true;
+}
+
+static void update_extent(dynamic_resolution *d) {
+    uint32_t width = (uint32_t) ((float) context.extent.width * d->scale);
+    uint32_t height = (uint32_t) ((float) context.extent.height * d->scale);
+    d->extent.width = width > 0 ? width : 1;
+    d->extent.height = height > 0 ? height : 1;
+}
+
+bool create_dynamic_resolution(dynamic_resolution *d, float budget_ms) {
+    init_dynamic_resolution(d);
+    d->budget_ms = budget_ms;
+    update_extent(d);
+    if (!is_supported()) {
+        return true;
+    }
+
+    bool success = create_render_pass_vulkan(&context, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, &d->render_pass) &&
+        create_color_image(d) &&
+        create_framebuffer(d);
+    if (success) {
+        d->enabled = true;
+        log_info("Dynamic resolution within %.1f ms, scales %.2f to %.2f", budget_ms, DYNAMIC_RESOLUTION_MIN_SCALE,
+            DYNAMIC_RESOLUTION_MAX_SCALE);
+    }
+
+    return success;
+}
+
+// the old target may still be rendered to by the frames in flight, it is retired rather than destroyed
+bool resize_dynamic_resolution(dynamic_resolution *d) {
+    update_extent(d);
+    if (!d->enabled) {
+        return true;
+    }
+
+    vk_retired_handles target = {
+        .framebuffer = d->framebuffer,
+        .image = d->color_image,
+        .view = d->color_view
+    };
+    retire_handles_vulkan(&context, &target);
+    vk_free_allocation(&d->color_allocation);
+
+    d->color_image = VK_NULL_HANDLE;
+    init_vk_allocation(&d->color_allocation);
+    d->color_view = VK_NULL_HANDLE;
+    d->color_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    d->framebuffer = VK_NULL_HANDLE;
+
+    return create_color_image(d) &&
+        create_framebuffer(d);
+}
+
+void update_dynamic_resolution(dynamic_resolution *d, float gpu_ms, uint64_t total_samples) {
+    if (!d->enabled || total_samples == d->total_samples) {
+        return;
+    }
+    d->total_samples = total_samples;
+    d->smoothed_ms = d->smoothed_ms > 0.0f ?
+        d->smoothed_ms + DYNAMIC_RESOLUTION_SMOOTHING * (gpu_ms - d->smoothed_ms) : gpu_ms;
+
+    // the frame time follows the pixels rendered, the square of the scale
+    float load = d->smoothed_ms / d->budget_ms;
+    if (load <= 0.0f || fabsf(load - 1.0f) <= DYNAMIC_RESOLUTION_DEADBAND) {
+        return;
+    }
+    float target = d->scale / sqrtf(load);
+    float scale = d->scale + DYNAMIC_RESOLUTION_GAIN * (target - d->scale);
+    scale = scale < DYNAMIC_RESOLUTION_MIN_SCALE ? DYNAMIC_RESOLUTION_MIN_SCALE : scale;
+    d->scale = scale > DYNAMIC_RESOLUTION_MAX_SCALE ? DYNAMIC_RESOLUTION_MAX_SCALE : scale;
+    update_extent(d);
+}
+
+void upscale_dynamic_resolution(const dynamic_resolution *d, VkCommandBuffer command_buffer, VkImage destination) {
+    VkImageBlit region = {
+        .srcSubresource = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        },
+        .srcOffsets = {
+            { 0, 0, 0 },
+            { (int32_t) d->extent.width, (int32_t) d->extent.height, 1 }
+        },
+        .dstSubresource = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        },
+        .dstOffsets = {
+            { 0, 0, 0 },
+            { (int32_t) context.extent.width, (int32_t) context.extent.height, 1 }
+        }
+    };
+    vkCmdBlitImage(command_buffer, d->color_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, destination,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_LINEAR);
+}
+
+void destroy_dynamic_resolution(dynamic_resolution *d) {
+    if (d->framebuffer) {
+        vkDestroyFramebuffer(context.device, d->framebuffer, NULL);
+    }
+    if (d->color_view) {
+        vkDestroyImageView(context.device, d->color_view, NULL);
+    }
+    if (d->color_image) {
+        vkDestroyImage(context.device, d->color_image, NULL);
+        vk_free_allocation(&d->color_allocation);
+    }
+    if (d->render_pass) {
+        vkDestroyRenderPass(context.device, d->render_pass, NULL);
+    }
+    init_dynamic_resolution(d);
+}
+
+bool init_dyn_res() {
+    init_dynamic_resolution(&dyn_res);
+    return !render_config.dynamic_resolution || create_dynamic_resolution(&dyn_res, render_config.frame_budget_ms);
+}
+
+bool resize_dyn_res() {
+    return resize_dynamic_resolution(&dyn_res);
+}
+
+void update_dyn_res(float gpu_ms, uint64_t total_samples) {
+    update_dynamic_resolution(&dyn_res, gpu_ms, total_samples);
+}
+
+void upscale_dyn_res(VkCommandBuffer command_buffer, VkImage destination) {
+    upscale_dynamic_resolution(&dyn_res, command_buffer, destination);
+}
+
+void destroy_dyn_res() {
+    destroy_dynamic_resolution(&dyn_res);
+}
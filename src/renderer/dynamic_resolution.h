@@ -0,0 +1,59 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vulkan/memory/memory.h"
+
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+#define DYNAMIC_RESOLUTION_MAX_SCALE 1.0f
+// how much of the frame time of each sample goes into the smoothed one
+#define DYNAMIC_RESOLUTION_SMOOTHING 0.2f
+// how far the scale moves toward the one estimated to meet the budget, per sample
+#define DYNAMIC_RESOLUTION_GAIN      0.25f
+// within this fraction of the budget the scale is left alone
+#define DYNAMIC_RESOLUTION_DEADBAND  0.05f
+
+// the scene is rendered into the top left of a target as large as the swapchain, only the render area changes
+// with the scale, and a linear blit upscales it into the swapchain image
+typedef struct dynamic_resolution {
+    VkImage color_image;
+    vk_allocation color_allocation;
+    VkImageView color_view;
+    // left to the render graph, it only changes between passes
+    VkImageLayout color_layout;
+    VkRenderPass render_pass;
+    VkFramebuffer framebuffer;
+
+    bool enabled;
+    float budget_ms;
+    float scale;
+    float smoothed_ms;
+    // of the GPU frame time last acted on, the same sample is seen again until the next one is resolved
+    uint64_t total_samples;
+    // rendered this frame
+    VkExtent2D extent;
+} dynamic_resolution;
+
+void init_dynamic_resolution(dynamic_resolution *d);
+// stays disabled when the surface format can not be blitted with a linear filter
+bool create_dynamic_resolution(dynamic_resolution *d, float budget_ms);
+// after the swapchain and the depth image were recreated
+bool resize_dynamic_resolution(dynamic_resolution *d);
+// before recording, with the GPU frame time of a frame resolved frames_in_flight frames ago
+void update_dynamic_resolution(dynamic_resolution *d, float gpu_ms, uint64_t total_samples);
+// outside of a render pass, the scene in TRANSFER_SRC_OPTIMAL and the destination in TRANSFER_DST_OPTIMAL
+void upscale_dynamic_resolution(const dynamic_resolution *d, VkCommandBuffer command_buffer, VkImage destination);
+void destroy_dynamic_resolution(dynamic_resolution *d);
+
+extern dynamic_resolution dyn_res;
+
+bool init_dyn_res();
+bool resize_dyn_res();
+void update_dyn_res(float gpu_ms, uint64_t total_samples);
+void upscale_dyn_res(VkCommandBuffer command_buffer, VkImage destination);
+void destroy_dyn_res();
+
+#endif // DYNAMIC_RESOLUTION_H
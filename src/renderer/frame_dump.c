@@ -0,0 +1,201 @@
+#include "./frame_dump.h"
+
+#include <stdio.h>
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/tools/tools.h"
+#include "../vulkan/context.h"
+#include "../utils/file.h"
+#include "../logger/logger.h"
+#include "./config.h"
+
+#define FRAME_DUMP_PIXEL_SIZE 4
+
+frame_dumper frame_dump;
+
+void init_frame_dumper(frame_dumper *d) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        d->slots[i].buffer = VK_NULL_HANDLE;
+        init_vk_allocation(&d->slots[i].allocation);
+        d->slots[i].frame_index = 0;
+        d->slots[i].pending = false;
+    }
+    d->slots_size = 0;
+    d->width = 0;
+    d->height = 0;
+    d->frame_index = 0;
+    d->directory = NULL;
+    d->interval = 0;
+    d->last_frame = 0;
+}
+
+bool create_frame_dumper(frame_dumper *d, uint32_t slots_size, uint32_t width, uint32_t height,
+    const char *directory, uint32_t interval, uint64_t last_frame)
+{
+    init_frame_dumper(d);
+    d->width = width;
+    d->height = height;
+    d->directory = directory;
+    d->interval = interval;
+    d->last_frame = last_frame;
+
+    VkBufferCreateInfo buffer_info = {
+        .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext                 = NULL,
+        .flags                 = 0,
+        .size                  = (VkDeviceSize) width * height * FRAME_DUMP_PIXEL_SIZE,
+        .usage                 = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices   = NULL
+    };
+
+    for (uint32_t i = 0; i < slots_size; i++) {
+        frame_dump_slot *slot = &d->slots[i];
+        CHECK_VK(vkCreateBuffer(context.device, &buffer_info, NULL, &slot->buffer));
+        d->slots_size++;
+
+        VkMemoryRequirements memory_requirements;
+        vkGetBufferMemoryRequirements(context.device, slot->buffer, &memory_requirements);
+
+        // coherent, so the copy is visible to the host once the fence is signaled
+        bool success = vk_allocate(&slot->allocation, memory_requirements.size, memory_requirements.alignment,
+            memory_requirements.memoryTypeBits, VULKAN_MEMORY_USAGE_CPU_ONLY, VULKAN_ALLOCATION_TYPE_BUFFER);
+        if (!success) {
+            log_error("Unable to allocate frame dump memory");
+            return false;
+        }
+        CHECK_VK(vkBindBufferMemory(context.device, slot->buffer, slot->allocation.device_memory,
+            slot->allocation.offset));
+    }
+
+    return true;
+}
+
+static bool is_dumped_frame(const frame_dumper *d, uint64_t frame_index) {
+    return frame_index == d->last_frame || (d->interval > 0 && (frame_index + 1) % d->interval == 0);
+}
+
+// binary PPM, the alpha channel is dropped
+static bool write_slot(const frame_dumper *d, const frame_dump_slot *slot) {
+    char filename[64];
+    char path[MAX_PATH_LENGTH];
+    snprintf(filename, sizeof(filename), "frame_%06llu.ppm", (unsigned long long) slot->frame_index);
+    if (!path_resolve(path, d->directory, filename, NULL)) {
+        log_error("Frame dump path too long");
+        return false;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        log_error("Unable to open %s", path);
+        return false;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", d->width, d->height);
+    const byte *pixels = slot->allocation.data;
+    for (size_t i = 0; i < (size_t) d->width * d->height; i++) {
+        fwrite(&pixels[i * FRAME_DUMP_PIXEL_SIZE], 1, 3, file);
+    }
+
+    bool success = ferror(file) == 0;
+    fclose(file);
+    if (!success) {
+        log_error("Unable to write %s", path);
+    }
+
+    return success;
+}
+
+bool resolve_frame_dumper(frame_dumper *d, uint32_t frame) {
+    if (frame >= d->slots_size || !d->slots[frame].pending) {
+        return true;
+    }
+    frame_dump_slot *slot = &d->slots[frame];
+    slot->pending = false;
+
+    return write_slot(d, slot);
+}
+
+VkBuffer start_frame_dumper(frame_dumper *d, uint32_t frame) {
+    uint64_t frame_index = d->frame_index++;
+    if (frame >= d->slots_size || !is_dumped_frame(d, frame_index)) {
+        return VK_NULL_HANDLE;
+    }
+    frame_dump_slot *slot = &d->slots[frame];
+    slot->frame_index = frame_index;
+    slot->pending = true;
+
+    return slot->buffer;
+}
+
+void record_frame_dumper(frame_dumper *d, uint32_t frame, VkCommandBuffer command_buffer, VkImage image) {
+    frame_dump_slot *slot = &d->slots[frame];
+
+    VkBufferImageCopy region = {
+        .bufferOffset      = 0,
+        .bufferRowLength   = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource  = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        },
+        .imageOffset = { 0, 0, 0 },
+        .imageExtent = { d->width, d->height, 1 }
+    };
+    vkCmdCopyImageToBuffer(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &region);
+}
+
+bool flush_frame_dumper(frame_dumper *d) {
+    bool success = true;
+    for (uint32_t i = 0; i < d->slots_size; i++) {
+        success = resolve_frame_dumper(d, i) && success;
+    }
+    return success;
+}
+
+void destroy_frame_dumper(frame_dumper *d) {
+    for (uint32_t i = 0; i < d->slots_size; i++) {
+        frame_dump_slot *slot = &d->slots[i];
+        if (slot->buffer) {
+            vkDestroyBuffer(context.device, slot->buffer, NULL);
+        }
+        if (slot->allocation.block) {
+            vk_free_allocation(&slot->allocation);
+        }
+    }
+    init_frame_dumper(d);
+}
+
+bool init_frame_dump() {
+    init_frame_dumper(&frame_dump);
+    if (!context.headless || !render_config.dump_directory) {
+        return true;
+    }
+    int last_frame = render_config.headless_frames > 0 ? render_config.headless_frames - 1 : 0;
+    int interval = render_config.dump_interval > 0 ? render_config.dump_interval : 0;
+
+    return create_frame_dumper(&frame_dump, context.frames_in_flight, context.extent.width, context.extent.height,
+        render_config.dump_directory, interval, last_frame);
+}
+
+bool resolve_frame_dump(uint32_t frame) {
+    return resolve_frame_dumper(&frame_dump, frame);
+}
+
+VkBuffer start_frame_dump(uint32_t frame) {
+    return start_frame_dumper(&frame_dump, frame);
+}
+
+void record_frame_dump(uint32_t frame, VkCommandBuffer command_buffer, VkImage image) {
+    record_frame_dumper(&frame_dump, frame, command_buffer, image);
+}
+
+bool flush_frame_dump() {
+    return flush_frame_dumper(&frame_dump);
+}
+
+void destroy_frame_dump() {
+    destroy_frame_dumper(&frame_dump);
+}
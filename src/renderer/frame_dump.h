@@ -0,0 +1,52 @@
+#ifndef FRAME_DUMP_H
+#define FRAME_DUMP_H
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vulkan/config.h"
+#include "../vulkan/memory/memory.h"
+
+// a host visible copy of the color image of one frame slot, written out once its fence is signaled
+typedef struct frame_dump_slot {
+    VkBuffer buffer;
+    vk_allocation allocation;
+    uint64_t frame_index;
+    bool pending;
+} frame_dump_slot;
+
+typedef struct frame_dumper {
+    frame_dump_slot slots[MAX_FRAMES_IN_FLIGHT];
+    uint32_t slots_size;
+    uint32_t width;
+    uint32_t height;
+    uint64_t frame_index;
+    const char *directory;
+    uint32_t interval;
+    uint64_t last_frame;
+} frame_dumper;
+
+void init_frame_dumper(frame_dumper *d);
+// interval 0 dumps only last_frame
+bool create_frame_dumper(frame_dumper *d, uint32_t slots_size, uint32_t width, uint32_t height,
+    const char *directory, uint32_t interval, uint64_t last_frame);
+// after the fence of the frame slot, writes what it copied last time
+bool resolve_frame_dumper(frame_dumper *d, uint32_t frame);
+// the buffer the current frame is copied into, VK_NULL_HANDLE when it is not dumped
+VkBuffer start_frame_dumper(frame_dumper *d, uint32_t frame);
+// copies the color image into the buffer of the slot, the render graph orders it after the render pass
+void record_frame_dumper(frame_dumper *d, uint32_t frame, VkCommandBuffer command_buffer, VkImage image);
+// once the device is idle, writes every copy not resolved yet
+bool flush_frame_dumper(frame_dumper *d);
+void destroy_frame_dumper(frame_dumper *d);
+
+extern frame_dumper frame_dump;
+
+bool init_frame_dump();
+bool resolve_frame_dump(uint32_t frame);
+VkBuffer start_frame_dump(uint32_t frame);
+void record_frame_dump(uint32_t frame, VkCommandBuffer command_buffer, VkImage image);
+bool flush_frame_dump();
+void destroy_frame_dump();
+
+#endif // FRAME_DUMP_H
@@ -0,0 +1,512 @@
+#include "./gpu_culling.h"
+
+#include <math.h>
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/tools/tools.h"
+#include "../vulkan/context.h"
+#include "../vulkan/descriptors/descriptor_allocator.h"
+#include "../vulkan/descriptors/bindless.h"
+#include "../logger/logger.h"
+#include "../utils/copy.h"
+#include "./shaders/shader_manager.h"
+#include "./render_state.h"
+
+#define CULL_GROUP_SIZE 64
+#define HIZ_GROUP_SIZE  8
+
+gpu_culling gpu_cull;
+
+// std140 layout of the uniform block in cull.comp
+typedef struct cull_uniforms {
+    mat4 view_projection;
+    mat4 occlusion_view_projection;
+    float frustum_planes[6][4];
+    float hiz_size[2];
+    uint32_t hiz_levels;
+    uint32_t objects;
+    uint32_t objects_size;
+    uint32_t flags;
+    uint32_t hiz_index;
+} cull_uniforms;
+
+typedef struct hiz_constants {
+    int32_t source_size[2];
+    int32_t destination_size[2];
+} hiz_constants;
+
+static void init_gpu_culling_pyramid(gpu_culling_pyramid *p) {
+    p->image = VK_NULL_HANDLE;
+    init_vk_allocation(&p->allocation);
+    p->view = VK_NULL_HANDLE;
+    for (size_t i = 0; i < MAX_HIZ_LEVELS; i++) {
+        p->level_views[i] = VK_NULL_HANDLE;
+    }
+    p->bindless_index = BINDLESS_NONE;
+    p->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    p->valid = false;
+    identity_mat4(p->view_projection);
+    p->ready_value = 0;
+    p->pending = false;
+}
+
+void init_gpu_culling(gpu_culling *c) {
+    for (size_t i = 0; i < HIZ_PYRAMIDS; i++) {
+        init_gpu_culling_pyramid(&c->hiz[i]);
+    }
+    c->hiz_current = 0;
+    c->hiz_extent.width = 0;
+    c->hiz_extent.height = 0;
+    c->hiz_levels = 0;
+    c->depth_view = VK_NULL_HANDLE;
+    c->sampler = VK_NULL_HANDLE;
+    c->occlusion = false;
+    identity_mat4(c->view_projection);
+}
+
+static bool create_image_view(VkImageView *view, VkImage image, VkFormat format, VkImageAspectFlags aspect,
+    uint32_t base_level, uint32_t levels)
+{
+    VkImageViewCreateInfo view_info = {
+        .sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext      = NULL,
+        .flags      = 0,
+        .image      = image,
+        .viewType   = VK_IMAGE_VIEW_TYPE_2D,
+        .format     = format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_R,
+            .g = VK_COMPONENT_SWIZZLE_G,
+            .b = VK_COMPONENT_SWIZZLE_B,
+            .a = VK_COMPONENT_SWIZZLE_A
+        },
+        .subresourceRange = {
+            .aspectMask     = aspect,
+            .baseMipLevel   = base_level,
+            .levelCount     = levels,
+            .baseArrayLayer = 0,
+            .layerCount     = 1
+        }
+    };
+
+    CHECK_VK(vkCreateImageView(context.device, &view_info, NULL, view));
+
+    return true;
+}
+
+static bool create_hiz_pyramid(gpu_culling *c, gpu_culling_pyramid *p) {
+    // built on the graphics queue, read by the culling pass on the async compute one
+    uint32_t families[] = { context.graphics_family_index, context.compute_family_index };
+
+    VkImageCreateInfo image_info = {
+        .sType     = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext     = NULL,
+        .flags     = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format    = VK_FORMAT_R32_SFLOAT,
+        .extent    = {
+            .width  = c->hiz_extent.width,
+            .height = c->hiz_extent.height,
+            .depth  = 1
+        },
+        .mipLevels             = c->hiz_levels,
+        .arrayLayers           = 1,
+        .samples               = VK_SAMPLE_COUNT_1_BIT,
+        .tiling                = VK_IMAGE_TILING_OPTIMAL,
+        .usage                 = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+        .sharingMode           = context.async_compute ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = context.async_compute ? 2 : 0,
+        .pQueueFamilyIndices   = context.async_compute ? families : NULL,
+        .initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+
+    CHECK_VK(vkCreateImage(context.device, &image_info, NULL, &p->image));
+
+    VkMemoryRequirements memory_requirements;
+    vkGetImageMemoryRequirements(context.device, p->image, &memory_requirements);
+
+    bool success = vk_allocate(&p->allocation, memory_requirements.size, memory_requirements.alignment,
+        memory_requirements.memoryTypeBits, VULKAN_MEMORY_USAGE_GPU_ONLY, VULKAN_ALLOCATION_TYPE_IMAGE_OPTIMAL);
+    if (!success) {
+        log_error("Unable to allocate the depth pyramid");
+        return false;
+    }
+
+    CHECK_VK(vkBindImageMemory(context.device, p->image, p->allocation.device_memory, p->allocation.offset));
+
+    if (!create_image_view(&p->view, p->image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, c->hiz_levels)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < c->hiz_levels; i++) {
+        if (!create_image_view(&p->level_views[i], p->image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, i,
+            1))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// half the depth resolution, the first reduction already covers 2x2 depth texels
+static bool create_hiz_images(gpu_culling *c) {
+    uint32_t width = context.depth_image.props.width / 2;
+    uint32_t height = context.depth_image.props.height / 2;
+    c->hiz_extent.width = width > 0 ? width : 1;
+    c->hiz_extent.height = height > 0 ? height : 1;
+
+    uint32_t size = c->hiz_extent.width > c->hiz_extent.height ? c->hiz_extent.width : c->hiz_extent.height;
+    c->hiz_levels = 1;
+    while ((size >> c->hiz_levels) > 0 && c->hiz_levels < MAX_HIZ_LEVELS) {
+        c->hiz_levels++;
+    }
+
+    for (size_t i = 0; i < HIZ_PYRAMIDS; i++) {
+        if (!create_hiz_pyramid(c, &c->hiz[i])) {
+            return false;
+        }
+    }
+
+    // the depth attachment view also covers stencil, which can not be sampled together with depth
+    return create_image_view(&c->depth_view, context.depth_image.image, context.depth_image.internal_format,
+        VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+}
+
+static bool create_sampler(gpu_culling *c) {
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_NEVER,
+        .minLod = 0,
+        .maxLod = c->hiz_levels,
+        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+        .unnormalizedCoordinates = VK_FALSE
+    };
+
+    CHECK_VK(vkCreateSampler(context.device, &sampler_info, NULL, &c->sampler));
+
+    return true;
+}
+
+// sets come from the per-frame descriptor allocator, the same images within a frame share one
+static bool get_image_descriptor_set(VkDescriptorSet *set, render_program_instance instance, VkSampler sampler,
+    VkImageView sampled, VkImageLayout sampled_layout, VkImageView storage)
+{
+    descriptor_set_desc desc;
+    init_descriptor_set_desc(&desc, get_image_descriptor_set_layout(instance));
+    add_image_descriptor_set_desc(&desc, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, sampler, sampled,
+        sampled_layout);
+    if (storage) {
+        add_image_descriptor_set_desc(&desc, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_NULL_HANDLE, storage,
+            VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    return vk_get_descriptor_set(&desc, set);
+}
+
+// the culling pass then reads them from the table, without a set of its own
+static bool add_bindless_pyramids(gpu_culling *c) {
+    if (!context.bindless) {
+        return true;
+    }
+    for (size_t i = 0; i < HIZ_PYRAMIDS; i++) {
+        gpu_culling_pyramid *p = &c->hiz[i];
+        p->bindless_index = vk_add_bindless_image(c->sampler, p->view, VK_IMAGE_LAYOUT_GENERAL);
+        if (p->bindless_index == BINDLESS_NONE) {
+            log_error("Unable to add the depth pyramid to the bindless table");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool create_gpu_culling(gpu_culling *c) {
+    init_gpu_culling(c);
+    c->occlusion = context.depth_sampled;
+    if (!c->occlusion) {
+        log_info("Multisampled depth, GPU culling tests the frustum only");
+    }
+
+    return create_hiz_images(c) &&
+        create_sampler(c) &&
+        add_bindless_pyramids(c);
+}
+
+// the old pyramids may still be read by the frames in flight, they are retired rather than destroyed
+bool resize_gpu_culling(gpu_culling *c) {
+    for (size_t i = 0; i < HIZ_PYRAMIDS; i++) {
+        gpu_culling_pyramid *p = &c->hiz[i];
+        for (uint32_t j = 0; j < c->hiz_levels; j++) {
+            vk_retired_handles level = {
+                .view = p->level_views[j]
+            };
+            retire_handles_vulkan(&context, &level);
+        }
+        vk_retired_handles hiz = {
+            .image = p->image,
+            .view = p->view
+        };
+        retire_handles_vulkan(&context, &hiz);
+        if (p->image) {
+            vk_free_allocation(&p->allocation);
+        }
+        vk_remove_bindless(BINDLESS_SAMPLED_IMAGES, p->bindless_index);
+        // the next frames are culled by the frustum only, like the first ones
+        init_gpu_culling_pyramid(p);
+    }
+    vk_retired_handles depth = {
+        .view = c->depth_view,
+        .sampler = c->sampler
+    };
+    retire_handles_vulkan(&context, &depth);
+
+    c->hiz_current = 0;
+    c->depth_view = VK_NULL_HANDLE;
+    c->sampler = VK_NULL_HANDLE;
+    c->hiz_levels = 0;
+
+    return create_hiz_images(c) &&
+        create_sampler(c) &&
+        add_bindless_pyramids(c);
+}
+
+void set_view_gpu_culling(gpu_culling *c, const mat4 view_projection) {
+    mem_copy(c->view_projection, view_projection, sizeof(mat4));
+}
+
+uint32_t get_cull_pyramid_gpu_culling(const gpu_culling *c, bool async) {
+    // without occlusion nothing is built, the pyramid is only bound
+    return async && c->occlusion ? get_build_pyramid_gpu_culling(c) : c->hiz_current;
+}
+
+uint32_t get_build_pyramid_gpu_culling(const gpu_culling *c) {
+    return (c->hiz_current + 1) % HIZ_PYRAMIDS;
+}
+
+// planes point inwards, in world space
+static void get_frustum_planes(float planes[6][4], const mat4 view_projection) {
+    vec4 rows[4];
+    for (size_t i = 0; i < 4; i++) {
+        get_row_mat4(rows[i], view_projection, i);
+    }
+
+    for (size_t i = 0; i < 4; i++) {
+        planes[0][i] = rows[3][i] + rows[0][i];
+        planes[1][i] = rows[3][i] - rows[0][i];
+        planes[2][i] = rows[3][i] + rows[1][i];
+        planes[3][i] = rows[3][i] - rows[1][i];
+        // zero to one depth range
+        planes[4][i] = rows[2][i];
+        planes[5][i] = rows[3][i] - rows[2][i];
+    }
+
+    for (size_t i = 0; i < 6; i++) {
+        float length = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] +
+            planes[i][2] * planes[i][2]);
+        if (length > 0.0f) {
+            for (size_t j = 0; j < 4; j++) {
+                planes[i][j] /= length;
+            }
+        } else {
+            // a projection without a near plane, nothing is behind it
+            planes[i][0] = 0.0f;
+            planes[i][1] = 0.0f;
+            planes[i][2] = 0.0f;
+            planes[i][3] = 1.0f;
+        }
+    }
+}
+
+// orders the reduction of a level before the next one reads it, the rest is synthesized by the render graph
+static void hiz_level_barrier(VkImage image, VkCommandBuffer command_buffer, uint32_t level) {
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = level,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+bool dispatch_gpu_culling(gpu_culling *c, const render_queue *q, uint32_t pyramid, command_state *state) {
+    if (q->cull_objects_size == 0) {
+        return true;
+    }
+    const gpu_culling_pyramid *p = &c->hiz[pyramid];
+
+    cull_uniforms uniforms;
+    mem_copy(uniforms.view_projection, c->view_projection, sizeof(mat4));
+    mem_copy(uniforms.occlusion_view_projection, p->view_projection, sizeof(mat4));
+    get_frustum_planes(uniforms.frustum_planes, c->view_projection);
+    uniforms.hiz_size[0] = c->hiz_extent.width;
+    uniforms.hiz_size[1] = c->hiz_extent.height;
+    uniforms.hiz_levels = c->hiz_levels;
+    uniforms.objects = q->cull_objects;
+    uniforms.objects_size = q->cull_objects_size;
+    uniforms.flags = (c->occlusion && p->valid ? GPU_CULLING_OCCLUSION : 0) |
+        (q->cull_compact ? GPU_CULLING_COMPACT : 0);
+    uniforms.hiz_index = p->bindless_index;
+
+    bool success;
+    if (context.bindless) {
+        // the table is bound with the program, nothing is allocated for the pyramid every frame
+        success = bind_program_instance(RENDER_PROGRAM_INSTANCE_CULL_BINDLESS) &&
+            commit_current_program(RST_DEFAULT, state) &&
+            bind_uniform_block(&uniforms, sizeof(uniforms), state);
+    } else {
+        VkDescriptorSet cull_set;
+        success = get_image_descriptor_set(&cull_set, RENDER_PROGRAM_INSTANCE_CULL, c->sampler, p->view,
+                VK_IMAGE_LAYOUT_GENERAL, VK_NULL_HANDLE) &&
+            bind_program_instance(RENDER_PROGRAM_INSTANCE_CULL) &&
+            commit_current_program(RST_DEFAULT, state) &&
+            bind_uniform_block(&uniforms, sizeof(uniforms), state) &&
+            bind_image_descriptor_set(cull_set, state);
+    }
+    if (!success) {
+        log_error("Unable to set up the culling pass");
+        return false;
+    }
+
+    dispatch_command_state(state, (q->cull_objects_size + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    return true;
+}
+
+bool build_hiz_gpu_culling(gpu_culling *c, command_state *state, VkExtent2D source) {
+    if (!c->occlusion) {
+        return true;
+    }
+
+    VkCommandBuffer command_buffer = state->command_buffer;
+    uint32_t pyramid = get_build_pyramid_gpu_culling(c);
+    gpu_culling_pyramid *p = &c->hiz[pyramid];
+    if (!bind_program_instance(RENDER_PROGRAM_INSTANCE_HIZ) || !commit_current_program(RST_DEFAULT, state)) {
+        log_error("Unable to set up the depth pyramid pass");
+        return false;
+    }
+
+    // a scaled scene covers only part of the depth, stretched over the whole pyramid it still matches the viewport
+    uint32_t source_width = source.width;
+    uint32_t source_height = source.height;
+    for (uint32_t i = 0; i < c->hiz_levels; i++) {
+        uint32_t width = c->hiz_extent.width >> i;
+        uint32_t height = c->hiz_extent.height >> i;
+        width = width > 0 ? width : 1;
+        height = height > 0 ? height : 1;
+
+        hiz_constants constants = {
+            .source_size = { source_width, source_height },
+            .destination_size = { width, height }
+        };
+        // every level reads the one above it, the first one reads the depth attachment
+        VkDescriptorSet build_set;
+        bool success = i == 0 ?
+            get_image_descriptor_set(&build_set, RENDER_PROGRAM_INSTANCE_HIZ, c->sampler, c->depth_view,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, p->level_views[i]) :
+            get_image_descriptor_set(&build_set, RENDER_PROGRAM_INSTANCE_HIZ, c->sampler, p->level_views[i - 1],
+                VK_IMAGE_LAYOUT_GENERAL, p->level_views[i]);
+        if (!success ||
+            !bind_image_descriptor_set(build_set, state) ||
+            !push_constants(&constants, sizeof(constants), state))
+        {
+            return false;
+        }
+        dispatch_command_state(state, (width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+            (height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+
+        if (i + 1 < c->hiz_levels) {
+            hiz_level_barrier(p->image, command_buffer, i);
+        }
+        source_width = width;
+        source_height = height;
+    }
+
+    mem_copy(p->view_projection, c->view_projection, sizeof(mat4));
+    p->valid = true;
+    c->hiz_current = pyramid;
+
+    return true;
+}
+
+void destroy_gpu_culling(gpu_culling *c) {
+    if (c->sampler) {
+        vkDestroySampler(context.device, c->sampler, NULL);
+    }
+    if (c->depth_view) {
+        vkDestroyImageView(context.device, c->depth_view, NULL);
+    }
+    for (size_t i = 0; i < HIZ_PYRAMIDS; i++) {
+        gpu_culling_pyramid *p = &c->hiz[i];
+        for (uint32_t j = 0; j < c->hiz_levels; j++) {
+            if (p->level_views[j]) {
+                vkDestroyImageView(context.device, p->level_views[j], NULL);
+            }
+        }
+        if (p->view) {
+            vkDestroyImageView(context.device, p->view, NULL);
+        }
+        if (p->image) {
+            vkDestroyImage(context.device, p->image, NULL);
+            vk_free_allocation(&p->allocation);
+        }
+        vk_remove_bindless(BINDLESS_SAMPLED_IMAGES, p->bindless_index);
+    }
+    init_gpu_culling(c);
+}
+
+bool init_gpu_cull() {
+    return create_gpu_culling(&gpu_cull);
+}
+
+bool resize_gpu_cull() {
+    return resize_gpu_culling(&gpu_cull);
+}
+
+void set_view_gpu_cull(const mat4 view_projection) {
+    set_view_gpu_culling(&gpu_cull, view_projection);
+}
+
+uint32_t get_cull_pyramid_gpu_cull(bool async) {
+    return get_cull_pyramid_gpu_culling(&gpu_cull, async);
+}
+
+uint32_t get_build_pyramid_gpu_cull() {
+    return get_build_pyramid_gpu_culling(&gpu_cull);
+}
+
+bool dispatch_gpu_cull(const render_queue *q, uint32_t pyramid, command_state *state) {
+    return dispatch_gpu_culling(&gpu_cull, q, pyramid, state);
+}
+
+bool build_hiz_gpu_cull(command_state *state, VkExtent2D source) {
+    return build_hiz_gpu_culling(&gpu_cull, state, source);
+}
+
+void destroy_gpu_cull() {
+    destroy_gpu_culling(&gpu_cull);
+}
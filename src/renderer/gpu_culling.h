@@ -0,0 +1,81 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include <vulkan/vulkan.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vulkan/memory/memory.h"
+#include "../vmath/mat4.h"
+#include "./render_queue.h"
+#include "./command_state.h"
+
+#define MAX_HIZ_LEVELS 16
+#define HIZ_PYRAMIDS   2
+
+// flags of the culling pass, see cull.comp
+#define GPU_CULLING_OCCLUSION 1
+#define GPU_CULLING_COMPACT   2
+
+// farthest depth of a frame, tested against before the draws of a later one
+typedef struct gpu_culling_pyramid {
+    VkImage image;
+    vk_allocation allocation;
+    VkImageView view;
+    VkImageView level_views[MAX_HIZ_LEVELS];
+    // slot of the whole view in the bindless table, BINDLESS_NONE without one
+    uint32_t bindless_index;
+    // left to the render graph, it only changes between passes
+    VkImageLayout layout;
+    bool valid;
+    mat4 view_projection;
+    // graphics timeline value of the last submit that built or first transitioned it
+    uint64_t ready_value;
+    // used by the graphics work being recorded, ready_value is set once it is submitted
+    bool pending;
+} gpu_culling_pyramid;
+
+// two pyramids built in turns. culling on graphics tests the one of the last frame, the async queue tests the one
+// before so it never waits for the frame still rendering, the next build then overwrites that one
+// objects only visible since then are culled for those frames, there is no second phase re-testing them
+typedef struct gpu_culling {
+    gpu_culling_pyramid hiz[HIZ_PYRAMIDS];
+    // the pyramid built last
+    uint32_t hiz_current;
+    VkExtent2D hiz_extent;
+    uint32_t hiz_levels;
+
+    VkImageView depth_view;
+    VkSampler sampler;
+
+    // multisampled depth can not be reduced, only the frustum is tested then
+    bool occlusion;
+    mat4 view_projection;
+} gpu_culling;
+
+void init_gpu_culling(gpu_culling *c);
+bool create_gpu_culling(gpu_culling *c);
+// after the depth image was recreated with the swapchain
+bool resize_gpu_culling(gpu_culling *c);
+void set_view_gpu_culling(gpu_culling *c, const mat4 view_projection);
+// the pyramid a culling pass on the given queue tests against
+uint32_t get_cull_pyramid_gpu_culling(const gpu_culling *c, bool async);
+// the pyramid the next build writes, the one not culled against on graphics
+uint32_t get_build_pyramid_gpu_culling(const gpu_culling *c);
+// outside of a render pass, before the culled batches are drawn
+bool dispatch_gpu_culling(gpu_culling *c, const render_queue *q, uint32_t pyramid, command_state *state);
+// after the render pass, reduces the top left source extent of its depth into the build pyramid
+bool build_hiz_gpu_culling(gpu_culling *c, command_state *state, VkExtent2D source);
+void destroy_gpu_culling(gpu_culling *c);
+
+extern gpu_culling gpu_cull;
+
+bool init_gpu_cull();
+bool resize_gpu_cull();
+void set_view_gpu_cull(const mat4 view_projection);
+uint32_t get_cull_pyramid_gpu_cull(bool async);
+uint32_t get_build_pyramid_gpu_cull();
+bool dispatch_gpu_cull(const render_queue *q, uint32_t pyramid, command_state *state);
+bool build_hiz_gpu_cull(command_state *state, VkExtent2D source);
+void destroy_gpu_cull();
+
+#endif // GPU_CULLING_H
@@ -0,0 +1,604 @@
+#include "./gpu_profiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/tools/tools.h"
+#include "../vulkan/context.h"
+#include "../vulkan/gpu_info.h"
+#include "../utils/heap.h"
+#include "../logger/logger.h"
+#include "../profiler/cpu_profiler.h"
+
+#define NO_QUERY UINT32_MAX
+
+gpu_profiler gpu_prof;
+
+static void init_gpu_profiler_frame(gpu_profiler_frame *f) {
+    for (size_t i = 0; i < GPU_QUEUES_SIZE; i++) {
+        f->query_pools[i] = VK_NULL_HANDLE;
+        f->queries_size[i] = 0;
+        f->queries_used[i] = 0;
+    }
+    f->events_size = 0;
+    f->frame_index = 0;
+    f->recorded_ticks = 0;
+    f->pending = false;
+}
+
+void init_gpu_profiler(gpu_profiler *p) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        init_gpu_profiler_frame(&p->frames[i]);
+    }
+    p->frames_size = 0;
+    p->current_frame = 0;
+    p->frame_index = 0;
+    p->scopes_size = 0;
+    for (size_t i = 0; i < GPU_QUEUES_SIZE; i++) {
+        p->stack_size[i] = 0;
+        p->queue_timestamps[i] = false;
+        p->results[i] = NULL;
+        p->results_size[i] = 0;
+    }
+    p->pass_intervals_size = 0;
+    p->unavailable_queries = 0;
+    p->tick_ns = 1.0;
+    p->timestamp_mask = UINT64_MAX;
+    p->base_timestamp = 0;
+    p->has_base_timestamp = false;
+    p->trace = NULL;
+    p->trace_size = 0;
+    p->trace_index = 0;
+}
+
+static bool create_query_pool(gpu_profiler_frame *f, gpu_profiler_queue queue, uint32_t queries_size) {
+    VkQueryPoolCreateInfo query_pool_info = {
+        .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext              = NULL,
+        .flags              = 0,
+        .queryType          = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount         = queries_size,
+        .pipelineStatistics = 0
+    };
+
+    CHECK_VK(vkCreateQueryPool(context.device, &query_pool_info, NULL, &f->query_pools[queue]));
+    f->queries_size[queue] = queries_size;
+
+    return true;
+}
+
+static bool alloc_results(gpu_profiler *p, gpu_profiler_queue queue, uint32_t results_size) {
+    if (results_size <= p->results_size[queue]) {
+        return true;
+    }
+
+    uint64_t *results = mem_alloc(sizeof(uint64_t) * 2 * results_size);
+    CHECK_ALLOC(results, "Unable to allocate timestamp results");
+    mem_free(p->results[queue]);
+    p->results[queue] = results;
+    p->results_size[queue] = results_size;
+
+    return true;
+}
+
+bool create_gpu_profiler(gpu_profiler *p, uint32_t frames_size, uint32_t queries_size) {
+    init_gpu_profiler(p);
+
+    const gpu_info *gpu = &context.gpus[context.selected_gpu];
+    uint32_t valid_bits = gpu->queue_family_props[context.graphics_family_index].timestampValidBits;
+    if (valid_bits == 0) {
+        log_warning("The graphics queue does not support timestamps, GPU profiling is disabled");
+        return true;
+    }
+    p->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (((uint64_t) 1) << valid_bits) - 1;
+    p->tick_ns = gpu->props.limits.timestampPeriod;
+    p->queue_timestamps[GPU_QUEUE_GRAPHICS] = true;
+    p->queue_timestamps[GPU_QUEUE_COMPUTE] = context.async_compute &&
+        gpu->queue_family_props[context.compute_family_index].timestampValidBits > 0;
+
+    p->trace = mem_alloc(sizeof(gpu_profiler_trace_event) * GPU_PROFILER_TRACE_EVENTS);
+    CHECK_ALLOC(p->trace, "Unable to allocate GPU trace");
+
+    for (size_t queue = 0; queue < GPU_QUEUES_SIZE; queue++) {
+        if (!p->queue_timestamps[queue]) {
+            continue;
+        }
+        if (!alloc_results(p, queue, queries_size)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < frames_size; i++) {
+            if (!create_query_pool(&p->frames[i], queue, queries_size)) {
+                return false;
+            }
+        }
+    }
+    p->frames_size = frames_size;
+
+    return true;
+}
+
+static void add_sample(gpu_profiler_scope *scope, float ms, uint64_t frame_index) {
+    scope->history[scope->history_index] = ms;
+    scope->history_index = (scope->history_index + 1) % GPU_PROFILER_HISTORY;
+    if (scope->history_size < GPU_PROFILER_HISTORY) {
+        scope->history_size++;
+    }
+    scope->total_samples++;
+    scope->last_frame_index = frame_index;
+}
+
+static void add_trace_event(gpu_profiler *p, uint32_t scope, const gpu_profiler_frame *f, uint64_t begin,
+    uint64_t end)
+{
+    if (!p->has_base_timestamp) {
+        p->base_timestamp = begin;
+        p->has_base_timestamp = true;
+    }
+    if (begin < p->base_timestamp) {
+        return;
+    }
+
+    gpu_profiler_trace_event *event = &p->trace[p->trace_index];
+    event->scope = scope;
+    event->frame_index = f->frame_index;
+    event->recorded_us = ticks_to_us_cpu_prof(f->recorded_ticks);
+    event->start_us = (double) (begin - p->base_timestamp) * p->tick_ns / 1000.0;
+    event->duration_us = (double) (end - begin) * p->tick_ns / 1000.0;
+
+    p->trace_index = (p->trace_index + 1) % GPU_PROFILER_TRACE_EVENTS;
+    if (p->trace_size < GPU_PROFILER_TRACE_EVENTS) {
+        p->trace_size++;
+    }
+}
+
+static int32_t find_scope(const gpu_profiler *p, const char *name, int32_t parent, gpu_profiler_queue queue) {
+    for (uint32_t i = 0; i < p->scopes_size; i++) {
+        const gpu_profiler_scope *scope = &p->scopes[i];
+        if (scope->parent == parent && scope->queue == queue &&
+            (scope->name == name || strcmp(scope->name, name) == 0))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int32_t add_scope(gpu_profiler *p, const char *name, int32_t parent, gpu_profiler_queue queue) {
+    int32_t index = find_scope(p, name, parent, queue);
+    if (index >= 0 || p->scopes_size >= GPU_PROFILER_MAX_SCOPES) {
+        return index;
+    }
+
+    gpu_profiler_scope *scope = &p->scopes[p->scopes_size];
+    scope->name = name;
+    scope->parent = parent;
+    scope->depth = parent >= 0 ? p->scopes[parent].depth + 1 : 0;
+    scope->queue = queue;
+    scope->history_size = 0;
+    scope->history_index = 0;
+    scope->total_samples = 0;
+    scope->last_frame_index = 0;
+
+    return p->scopes_size++;
+}
+
+static bool get_timestamp(const gpu_profiler *p, gpu_profiler_queue queue, uint32_t query, uint64_t *timestamp) {
+    const uint64_t *results = p->results[queue];
+    if (query == NO_QUERY || results[query * 2 + 1] == 0) {
+        return false;
+    }
+    *timestamp = results[query * 2] & p->timestamp_mask;
+    return true;
+}
+
+static uint64_t get_overlap(uint64_t begin, uint64_t end, uint64_t intervals[][2], uint32_t intervals_size) {
+    uint64_t overlap = 0;
+    for (uint32_t i = 0; i < intervals_size; i++) {
+        uint64_t from = begin > intervals[i][0] ? begin : intervals[i][0];
+        uint64_t to = end < intervals[i][1] ? end : intervals[i][1];
+        overlap += to > from ? to - from : 0;
+    }
+    return overlap;
+}
+
+// the top level compute scopes against the passes, one level below the frame scope, of this frame and the last
+static void add_overlap_sample(gpu_profiler *p, const gpu_profiler_frame *f) {
+    uint64_t passes[GPU_PROFILER_MAX_EVENTS][2];
+    uint32_t passes_size = 0;
+    for (uint32_t i = 0; i < f->events_size; i++) {
+        const gpu_profiler_event *event = &f->events[i];
+        const gpu_profiler_scope *scope = &p->scopes[event->scope];
+        if (scope->queue == GPU_QUEUE_GRAPHICS && scope->depth == 1 &&
+            get_timestamp(p, GPU_QUEUE_GRAPHICS, event->begin_query, &passes[passes_size][0]) &&
+            get_timestamp(p, GPU_QUEUE_GRAPHICS, event->end_query, &passes[passes_size][1]))
+        {
+            passes_size++;
+        }
+    }
+
+    bool seen = false;
+    uint64_t overlap = 0;
+    for (uint32_t i = 0; i < f->events_size; i++) {
+        const gpu_profiler_event *event = &f->events[i];
+        const gpu_profiler_scope *scope = &p->scopes[event->scope];
+        uint64_t begin, end;
+        if (scope->queue != GPU_QUEUE_COMPUTE || scope->depth != 0 ||
+            !get_timestamp(p, GPU_QUEUE_COMPUTE, event->begin_query, &begin) ||
+            !get_timestamp(p, GPU_QUEUE_COMPUTE, event->end_query, &end))
+        {
+            continue;
+        }
+        overlap += get_overlap(begin, end, p->pass_intervals, p->pass_intervals_size) +
+            get_overlap(begin, end, passes, passes_size);
+        seen = true;
+    }
+
+    mem_copy(p->pass_intervals, passes, sizeof(passes[0]) * passes_size);
+    p->pass_intervals_size = passes_size;
+
+    int32_t scope = seen ? add_scope(p, GPU_PROFILER_OVERLAP_SCOPE, -1, GPU_QUEUE_COMPUTE) : -1;
+    if (scope >= 0) {
+        add_sample(&p->scopes[scope], (float) ((double) overlap * p->tick_ns / 1000000.0), f->frame_index);
+    }
+}
+
+static bool resolve_frame(gpu_profiler *p, gpu_profiler_frame *f) {
+    uint32_t resolved = 0;
+    for (size_t queue = 0; queue < GPU_QUEUES_SIZE; queue++) {
+        uint32_t queries = f->queries_used[queue] < f->queries_size[queue] ? f->queries_used[queue] :
+            f->queries_size[queue];
+        if (queries == 0) {
+            continue;
+        }
+
+        // never waits, the queries not available yet are skipped and the rest of the frame is still used
+        VkResult result = vkGetQueryPoolResults(context.device, f->query_pools[queue], 0, queries,
+            sizeof(uint64_t) * 2 * queries, p->results[queue], sizeof(uint64_t) * 2,
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_NOT_READY) {
+            CHECK_VK(result);
+        }
+        resolved += queries;
+    }
+    if (resolved == 0) {
+        return true;
+    }
+
+    float frame_ms[GPU_PROFILER_MAX_SCOPES];
+    bool seen[GPU_PROFILER_MAX_SCOPES];
+    for (uint32_t i = 0; i < p->scopes_size; i++) {
+        frame_ms[i] = 0.0f;
+        seen[i] = false;
+    }
+
+    for (uint32_t i = 0; i < f->events_size; i++) {
+        const gpu_profiler_event *event = &f->events[i];
+        uint64_t begin, end;
+        if (event->begin_query == NO_QUERY || event->end_query == NO_QUERY) {
+            continue;
+        }
+        gpu_profiler_queue queue = p->scopes[event->scope].queue;
+        if (!get_timestamp(p, queue, event->begin_query, &begin) || !get_timestamp(p, queue, event->end_query, &end)) {
+            p->unavailable_queries += 2;
+            continue;
+        }
+        if (end < begin) {
+            continue;
+        }
+        frame_ms[event->scope] += (float) ((double) (end - begin) * p->tick_ns / 1000000.0);
+        seen[event->scope] = true;
+        add_trace_event(p, event->scope, f, begin, end);
+    }
+
+    // a scope entered several times in a frame counts once with its total
+    for (uint32_t i = 0; i < p->scopes_size; i++) {
+        if (seen[i]) {
+            add_sample(&p->scopes[i], frame_ms[i], f->frame_index);
+        }
+    }
+    if (p->queue_timestamps[GPU_QUEUE_COMPUTE]) {
+        add_overlap_sample(p, f);
+    }
+
+    return true;
+}
+
+static bool grow_frame(gpu_profiler *p, gpu_profiler_frame *f, gpu_profiler_queue queue) {
+    uint32_t queries_size = f->queries_size[queue] > 0 ? f->queries_size[queue] : 1;
+    while (queries_size < f->queries_used[queue]) {
+        queries_size *= 2;
+    }
+    log_debug("Growing GPU profiler queries from %u to %u", f->queries_size[queue], queries_size);
+
+    vkDestroyQueryPool(context.device, f->query_pools[queue], NULL);
+    f->query_pools[queue] = VK_NULL_HANDLE;
+    f->queries_size[queue] = 0;
+
+    return alloc_results(p, queue, queries_size) && create_query_pool(f, queue, queries_size);
+}
+
+bool begin_frame_gpu_profiler(gpu_profiler *p, uint32_t frame, VkCommandBuffer graphics_buffer,
+    VkCommandBuffer compute_buffer)
+{
+    p->current_frame = frame;
+    for (size_t i = 0; i < GPU_QUEUES_SIZE; i++) {
+        p->stack_size[i] = 0;
+    }
+    if (frame >= p->frames_size) {
+        return true;
+    }
+
+    gpu_profiler_frame *f = &p->frames[frame];
+    if (f->pending && !resolve_frame(p, f)) {
+        return false;
+    }
+    f->pending = false;
+
+    // the frame's fence has been waited on, its pools are no longer in use. a queue only writes its own pool, so
+    // each reset is ordered before its timestamps without the queues waiting on each other
+    VkCommandBuffer command_buffers[GPU_QUEUES_SIZE] = { graphics_buffer, compute_buffer };
+    for (size_t queue = 0; queue < GPU_QUEUES_SIZE; queue++) {
+        if (f->queries_used[queue] > f->queries_size[queue] && !grow_frame(p, f, queue)) {
+            return false;
+        }
+        if (f->query_pools[queue] && command_buffers[queue]) {
+            vkCmdResetQueryPool(command_buffers[queue], f->query_pools[queue], 0, f->queries_size[queue]);
+        }
+        f->queries_used[queue] = 0;
+    }
+    f->events_size = 0;
+    f->frame_index = p->frame_index++;
+
+    return true;
+}
+
+static uint32_t next_query(gpu_profiler_frame *f, gpu_profiler_queue queue) {
+    uint32_t query = f->queries_used[queue]++;
+    return query < f->queries_size[queue] ? query : NO_QUERY;
+}
+
+void begin_queue_scope_gpu_profiler(gpu_profiler *p, gpu_profiler_queue queue, VkCommandBuffer command_buffer,
+    const char *name)
+{
+    uint32_t *stack = p->stack[queue];
+    uint32_t depth = p->stack_size[queue]++;
+    if (p->current_frame >= p->frames_size || depth >= GPU_PROFILER_MAX_DEPTH) {
+        return;
+    }
+    gpu_profiler_frame *f = &p->frames[p->current_frame];
+    stack[depth] = NO_QUERY;
+    if (!p->queue_timestamps[queue]) {
+        return;
+    }
+
+    int32_t parent = -1;
+    if (depth > 0) {
+        uint32_t parent_event = stack[depth - 1];
+        if (parent_event == NO_QUERY) {
+            return;
+        }
+        parent = f->events[parent_event].scope;
+    }
+
+    int32_t scope = add_scope(p, name, parent, queue);
+    if (scope < 0 || f->events_size >= GPU_PROFILER_MAX_EVENTS) {
+        return;
+    }
+
+    gpu_profiler_event *event = &f->events[f->events_size];
+    event->scope = scope;
+    event->begin_query = next_query(f, queue);
+    event->end_query = NO_QUERY;
+    if (event->begin_query != NO_QUERY) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, f->query_pools[queue],
+            event->begin_query);
+    }
+    stack[depth] = f->events_size++;
+}
+
+void end_queue_scope_gpu_profiler(gpu_profiler *p, gpu_profiler_queue queue, VkCommandBuffer command_buffer) {
+    if (p->stack_size[queue] == 0) {
+        log_warning("GPU profiler scope ended without being started");
+        return;
+    }
+    uint32_t *stack = p->stack[queue];
+    uint32_t depth = --p->stack_size[queue];
+    if (p->current_frame >= p->frames_size || depth >= GPU_PROFILER_MAX_DEPTH || stack[depth] == NO_QUERY) {
+        return;
+    }
+    gpu_profiler_frame *f = &p->frames[p->current_frame];
+
+    // the end query is still counted when the begin one did not fit, so the pool grows enough for both
+    gpu_profiler_event *event = &f->events[stack[depth]];
+    event->end_query = next_query(f, queue);
+    if (event->begin_query != NO_QUERY && event->end_query != NO_QUERY) {
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, f->query_pools[queue],
+            event->end_query);
+    }
+}
+
+void begin_scope_gpu_profiler(gpu_profiler *p, VkCommandBuffer command_buffer, const char *name) {
+    begin_queue_scope_gpu_profiler(p, GPU_QUEUE_GRAPHICS, command_buffer, name);
+}
+
+void end_scope_gpu_profiler(gpu_profiler *p, VkCommandBuffer command_buffer) {
+    end_queue_scope_gpu_profiler(p, GPU_QUEUE_GRAPHICS, command_buffer);
+}
+
+void end_frame_gpu_profiler(gpu_profiler *p) {
+    for (size_t i = 0; i < GPU_QUEUES_SIZE; i++) {
+        if (p->stack_size[i] != 0) {
+            log_warning("%u GPU profiler scopes are still open at the end of the frame", p->stack_size[i]);
+            p->stack_size[i] = 0;
+        }
+    }
+    if (p->current_frame < p->frames_size) {
+        p->frames[p->current_frame].recorded_ticks = get_cpu_ticks();
+        p->frames[p->current_frame].pending = true;
+    }
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *) a, y = *(const float *) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static void get_scope_stats(const gpu_profiler *p, const gpu_profiler_scope *scope, gpu_profiler_stats *stats) {
+    stats->samples = scope->history_size;
+    stats->total_samples = scope->total_samples;
+    // the frame being recorded is the last one begun
+    stats->latency_frames = scope->total_samples > 0 && p->frame_index > scope->last_frame_index ?
+        (uint32_t) (p->frame_index - 1 - scope->last_frame_index) : 0;
+    stats->last_ms = stats->min_ms = stats->avg_ms = stats->p99_ms = 0.0f;
+    if (scope->history_size == 0) {
+        return;
+    }
+
+    float sorted[GPU_PROFILER_HISTORY];
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < scope->history_size; i++) {
+        sorted[i] = scope->history[i];
+        sum += sorted[i];
+    }
+    qsort(sorted, scope->history_size, sizeof(float), compare_float);
+
+    uint32_t last = (scope->history_index + GPU_PROFILER_HISTORY - 1) % GPU_PROFILER_HISTORY;
+    uint32_t p99 = (uint32_t) ceilf(0.99f * scope->history_size) - 1;
+    stats->last_ms = scope->history[last];
+    stats->min_ms = sorted[0];
+    stats->avg_ms = sum / scope->history_size;
+    stats->p99_ms = sorted[p99];
+}
+
+bool get_stats_gpu_profiler(const gpu_profiler *p, const char *name, gpu_profiler_stats *stats) {
+    for (uint32_t i = 0; i < p->scopes_size; i++) {
+        if (strcmp(p->scopes[i].name, name) == 0) {
+            get_scope_stats(p, &p->scopes[i], stats);
+            return stats->samples > 0;
+        }
+    }
+    return false;
+}
+
+void log_stats_gpu_profiler(const gpu_profiler *p) {
+    for (uint32_t i = 0; i < p->scopes_size; i++) {
+        const gpu_profiler_scope *scope = &p->scopes[i];
+        gpu_profiler_stats stats;
+        get_scope_stats(p, scope, &stats);
+        log_info("%*s%s: last %.3f min %.3f avg %.3f p99 %.3f ms, %u frames old", (int) scope->depth * 2, "",
+            scope->name, stats.last_ms, stats.min_ms, stats.avg_ms, stats.p99_ms, stats.latency_frames);
+    }
+    if (p->unavailable_queries > 0) {
+        log_info("%llu timestamps were not available in time", (unsigned long long) p->unavailable_queries);
+    }
+}
+
+bool write_trace_gpu_profiler(const gpu_profiler *p, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        log_error("Unable to open %s for the GPU trace", path);
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}");
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":%d,\"args\":{\"name\":\"graphics\"}}",
+        GPU_QUEUE_GRAPHICS);
+    fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":%d,\"args\":{\"name\":\"compute\"}}",
+        GPU_QUEUE_COMPUTE);
+
+    // the clocks are not calibrated against each other, the GPU timeline is shifted by the least amount
+    // that starts every frame after the CPU finished recording it
+    uint32_t first = p->trace_size < GPU_PROFILER_TRACE_EVENTS ? 0 : p->trace_index;
+    double offset_us = 0.0;
+    for (uint32_t i = 0; i < p->trace_size; i++) {
+        const gpu_profiler_trace_event *event = &p->trace[(first + i) % GPU_PROFILER_TRACE_EVENTS];
+        double offset = event->recorded_us - event->start_us;
+        offset_us = i == 0 || offset > offset_us ? offset : offset_us;
+    }
+
+    for (uint32_t i = 0; i < p->trace_size; i++) {
+        const gpu_profiler_trace_event *event = &p->trace[(first + i) % GPU_PROFILER_TRACE_EVENTS];
+        const gpu_profiler_scope *scope = &p->scopes[event->scope];
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":2,\"tid\":%d,"
+            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}", scope->name, scope->queue,
+            event->start_us + offset_us, event->duration_us, (unsigned long long) event->frame_index);
+    }
+
+    bool success = write_trace_events_cpu_prof(file, 1);
+    fprintf(file, "\n]}\n");
+    success = success && ferror(file) == 0;
+    if (fclose(file) != 0 || !success) {
+        log_error("Unable to write the GPU trace to %s", path);
+        return false;
+    }
+    log_info("Wrote the trace with %u GPU events to %s", p->trace_size, path);
+
+    return true;
+}
+
+void destroy_gpu_profiler(gpu_profiler *p) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t queue = 0; queue < GPU_QUEUES_SIZE; queue++) {
+            if (p->frames[i].query_pools[queue]) {
+                vkDestroyQueryPool(context.device, p->frames[i].query_pools[queue], NULL);
+            }
+        }
+    }
+    for (size_t queue = 0; queue < GPU_QUEUES_SIZE; queue++) {
+        if (p->results[queue]) {
+            mem_free(p->results[queue]);
+        }
+    }
+    if (p->trace) {
+        mem_free(p->trace);
+    }
+
+    init_gpu_profiler(p);
+}
+
+bool init_gpu_prof() {
+    return create_gpu_profiler(&gpu_prof, context.frames_in_flight, NUM_TIMESTAMP_QUERIES);
+}
+
+bool begin_frame_gpu_prof(uint32_t frame, VkCommandBuffer graphics_buffer, VkCommandBuffer compute_buffer) {
+    return begin_frame_gpu_profiler(&gpu_prof, frame, graphics_buffer, compute_buffer);
+}
+
+void begin_gpu_scope(VkCommandBuffer command_buffer, const char *name) {
+    begin_scope_gpu_profiler(&gpu_prof, command_buffer, name);
+}
+
+void end_gpu_scope(VkCommandBuffer command_buffer) {
+    end_scope_gpu_profiler(&gpu_prof, command_buffer);
+}
+
+void begin_compute_gpu_scope(VkCommandBuffer command_buffer, const char *name) {
+    begin_queue_scope_gpu_profiler(&gpu_prof, GPU_QUEUE_COMPUTE, command_buffer, name);
+}
+
+void end_compute_gpu_scope(VkCommandBuffer command_buffer) {
+    end_queue_scope_gpu_profiler(&gpu_prof, GPU_QUEUE_COMPUTE, command_buffer);
+}
+
+void end_frame_gpu_prof() {
+    end_frame_gpu_profiler(&gpu_prof);
+}
+
+bool get_gpu_stats(const char *name, gpu_profiler_stats *stats) {
+    return get_stats_gpu_profiler(&gpu_prof, name, stats);
+}
+
+void log_gpu_stats() {
+    log_stats_gpu_profiler(&gpu_prof);
+}
+
+bool write_gpu_trace(const char *path) {
+    return write_trace_gpu_profiler(&gpu_prof, path);
+}
+
+void destroy_gpu_prof() {
+    destroy_gpu_profiler(&gpu_prof);
+}
@@ -0,0 +1,149 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vulkan/config.h"
+
+#define GPU_PROFILER_MAX_SCOPES 64
+#define GPU_PROFILER_MAX_DEPTH  16
+#define GPU_PROFILER_MAX_EVENTS 256
+#define GPU_PROFILER_HISTORY    128
+#define GPU_PROFILER_TRACE_EVENTS 8192
+
+// how long the async compute work of a frame ran next to graphics passes, sampled like a scope
+#define GPU_PROFILER_OVERLAP_SCOPE "async_overlap"
+
+// the scopes of each queue nest on their own, each queue is a thread of its own in traces
+typedef enum gpu_profiler_queue {
+    GPU_QUEUE_GRAPHICS,
+    GPU_QUEUE_COMPUTE,
+    GPU_QUEUES_SIZE
+} gpu_profiler_queue;
+
+// a named scope at a given place in the hierarchy, the same name under another parent is another scope
+typedef struct gpu_profiler_scope {
+    const char *name;
+    int32_t parent;
+    uint32_t depth;
+    gpu_profiler_queue queue;
+
+    float history[GPU_PROFILER_HISTORY];
+    uint32_t history_size;
+    uint32_t history_index;
+    // every sample ever added, tells a new sample from a repeated one
+    uint64_t total_samples;
+    // frame the last sample was recorded in
+    uint64_t last_frame_index;
+} gpu_profiler_scope;
+
+// one scope recorded in a frame, the queries are in the pool of its queue and UINT32_MAX when it was too small
+typedef struct gpu_profiler_event {
+    uint32_t scope;
+    uint32_t begin_query;
+    uint32_t end_query;
+} gpu_profiler_event;
+
+typedef struct gpu_profiler_frame {
+    // a pool per queue, each one is reset in its own command buffer before the queue writes to it
+    VkQueryPool query_pools[GPU_QUEUES_SIZE];
+    uint32_t queries_size[GPU_QUEUES_SIZE];
+    // requested by the last recording, larger than queries_size when the pool has to grow
+    uint32_t queries_used[GPU_QUEUES_SIZE];
+
+    gpu_profiler_event events[GPU_PROFILER_MAX_EVENTS];
+    uint32_t events_size;
+    uint64_t frame_index;
+    // CPU profiler clock when recording finished, the GPU work can not start before it
+    uint64_t recorded_ticks;
+    bool pending;
+} gpu_profiler_frame;
+
+typedef struct gpu_profiler_trace_event {
+    uint32_t scope;
+    uint64_t frame_index;
+    double start_us;
+    double duration_us;
+    double recorded_us;
+} gpu_profiler_trace_event;
+
+typedef struct gpu_profiler_stats {
+    float last_ms;
+    float min_ms;
+    float avg_ms;
+    float p99_ms;
+    uint32_t samples;
+    uint64_t total_samples;
+    // frames since the one last_ms was measured in, results never waited on arrive at least frames_in_flight late
+    uint32_t latency_frames;
+} gpu_profiler_stats;
+
+// timestamps are read back without waiting once the frame slot comes around again
+typedef struct gpu_profiler {
+    gpu_profiler_frame frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t frames_size;
+    uint32_t current_frame;
+    uint64_t frame_index;
+
+    gpu_profiler_scope scopes[GPU_PROFILER_MAX_SCOPES];
+    uint32_t scopes_size;
+    uint32_t stack[GPU_QUEUES_SIZE][GPU_PROFILER_MAX_DEPTH];
+    uint32_t stack_size[GPU_QUEUES_SIZE];
+    // queue families without timestamps record no scopes
+    bool queue_timestamps[GPU_QUEUES_SIZE];
+
+    // graphics passes of the last resolved frame, the async compute work of the next one runs next to them
+    uint64_t pass_intervals[GPU_PROFILER_MAX_EVENTS][2];
+    uint32_t pass_intervals_size;
+
+    // a timestamp and its availability per query of each queue
+    uint64_t *results[GPU_QUEUES_SIZE];
+    uint32_t results_size[GPU_QUEUES_SIZE];
+    // timestamps not yet available when their frame slot came around again, their scopes keep the older sample
+    uint64_t unavailable_queries;
+    double tick_ns;
+    uint64_t timestamp_mask;
+    uint64_t base_timestamp;
+    bool has_base_timestamp;
+
+    gpu_profiler_trace_event *trace;
+    uint32_t trace_size;
+    uint32_t trace_index;
+} gpu_profiler;
+
+void init_gpu_profiler(gpu_profiler *p);
+bool create_gpu_profiler(gpu_profiler *p, uint32_t frames_size, uint32_t queries_size);
+// after the fence of the frame, resolves what it recorded last time and resets the queries of each queue in its
+// command buffer, compute_buffer is VK_NULL_HANDLE when the frame records no compute work
+bool begin_frame_gpu_profiler(gpu_profiler *p, uint32_t frame, VkCommandBuffer graphics_buffer,
+    VkCommandBuffer compute_buffer);
+// names are string literals, they are compared by value but stored by pointer and not escaped in traces
+void begin_queue_scope_gpu_profiler(gpu_profiler *p, gpu_profiler_queue queue, VkCommandBuffer command_buffer,
+    const char *name);
+void end_queue_scope_gpu_profiler(gpu_profiler *p, gpu_profiler_queue queue, VkCommandBuffer command_buffer);
+void begin_scope_gpu_profiler(gpu_profiler *p, VkCommandBuffer command_buffer, const char *name);
+void end_scope_gpu_profiler(gpu_profiler *p, VkCommandBuffer command_buffer);
+void end_frame_gpu_profiler(gpu_profiler *p);
+bool get_stats_gpu_profiler(const gpu_profiler *p, const char *name, gpu_profiler_stats *stats);
+void log_stats_gpu_profiler(const gpu_profiler *p);
+// Chrome trace event JSON of the last resolved scopes merged with the CPU zones, for chrome://tracing or Perfetto
+bool write_trace_gpu_profiler(const gpu_profiler *p, const char *path);
+void destroy_gpu_profiler(gpu_profiler *p);
+
+extern gpu_profiler gpu_prof;
+
+bool init_gpu_prof();
+bool begin_frame_gpu_prof(uint32_t frame, VkCommandBuffer graphics_buffer, VkCommandBuffer compute_buffer);
+void begin_gpu_scope(VkCommandBuffer command_buffer, const char *name);
+void end_gpu_scope(VkCommandBuffer command_buffer);
+void begin_compute_gpu_scope(VkCommandBuffer command_buffer, const char *name);
+void end_compute_gpu_scope(VkCommandBuffer command_buffer);
+void end_frame_gpu_prof();
+bool get_gpu_stats(const char *name, gpu_profiler_stats *stats);
+void log_gpu_stats();
+bool write_gpu_trace(const char *path);
+void destroy_gpu_prof();
+
+#endif // GPU_PROFILER_H
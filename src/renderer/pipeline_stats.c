@@ -0,0 +1,172 @@
+#include "./pipeline_stats.h"
+
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/tools/tools.h"
+#include "../vulkan/context.h"
+#include "../logger/logger.h"
+
+#define PIPELINE_STATS_COUNTERS 3
+
+pipeline_stats pipe_stats;
+
+static void init_pipeline_stats_frame(pipeline_stats_frame *f) {
+    f->query_pool = VK_NULL_HANDLE;
+    f->pixels = 0;
+    f->frame_index = 0;
+    f->recorded = false;
+}
+
+void init_pipeline_stats(pipeline_stats *p) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        init_pipeline_stats_frame(&p->frames[i]);
+    }
+    p->frames_size = 0;
+    p->current_frame = 0;
+    p->frame_index = 0;
+    p->last.vertex_invocations = 0;
+    p->last.primitives = 0;
+    p->last.fragment_invocations = 0;
+    p->last.overdraw = 0.0f;
+    p->last.latency_frames = 0;
+    p->last_frame_index = 0;
+    p->total_samples = 0;
+}
+
+bool create_pipeline_stats(pipeline_stats *p, uint32_t frames_size) {
+    init_pipeline_stats(p);
+
+    if (!context.enabled_features.pipelineStatisticsQuery) {
+        log_info("The device has no pipeline statistics queries, overdraw is not measured");
+        return true;
+    }
+
+    VkQueryPoolCreateInfo query_pool_info = {
+        .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext              = NULL,
+        .flags              = 0,
+        .queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+        .queryCount         = 1,
+        .pipelineStatistics = PIPELINE_STATS_FLAGS
+    };
+    for (uint32_t i = 0; i < frames_size; i++) {
+        CHECK_VK(vkCreateQueryPool(context.device, &query_pool_info, NULL, &p->frames[i].query_pool));
+    }
+    p->frames_size = frames_size;
+
+    return true;
+}
+
+static bool resolve_frame(pipeline_stats *p, const pipeline_stats_frame *f) {
+    // the counters followed by their availability
+    uint64_t counters[PIPELINE_STATS_COUNTERS + 1];
+    VkResult result = vkGetQueryPoolResults(context.device, f->query_pool, 0, 1, sizeof(counters), counters,
+        sizeof(counters), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_NOT_READY) {
+        CHECK_VK(result);
+    }
+    if (counters[PIPELINE_STATS_COUNTERS] == 0) {
+        // never waits, the frame is only missing from the statistics
+        return true;
+    }
+
+    p->last.vertex_invocations = counters[0];
+    p->last.primitives = counters[1];
+    p->last.fragment_invocations = counters[2];
+    p->last.overdraw = f->pixels > 0 ? (float) ((double) counters[2] / f->pixels) : 0.0f;
+    p->last_frame_index = f->frame_index;
+    p->total_samples++;
+
+    return true;
+}
+
+bool begin_frame_pipeline_stats(pipeline_stats *p, uint32_t frame, VkCommandBuffer command_buffer) {
+    p->current_frame = frame;
+    if (frame >= p->frames_size) {
+        return true;
+    }
+
+    pipeline_stats_frame *f = &p->frames[frame];
+    if (f->recorded && !resolve_frame(p, f)) {
+        return false;
+    }
+    f->recorded = false;
+
+    vkCmdResetQueryPool(command_buffer, f->query_pool, 0, 1);
+    f->frame_index = p->frame_index++;
+
+    return true;
+}
+
+bool begin_draws_pipeline_stats(pipeline_stats *p, VkCommandBuffer command_buffer, bool secondary, uint32_t pixels) {
+    if (p->current_frame >= p->frames_size || (secondary && !context.enabled_features.inheritedQueries)) {
+        return false;
+    }
+
+    pipeline_stats_frame *f = &p->frames[p->current_frame];
+    vkCmdBeginQuery(command_buffer, f->query_pool, 0, 0);
+    f->pixels = pixels;
+    f->recorded = true;
+
+    return true;
+}
+
+void end_draws_pipeline_stats(pipeline_stats *p, VkCommandBuffer command_buffer) {
+    if (p->current_frame >= p->frames_size || !p->frames[p->current_frame].recorded) {
+        return;
+    }
+    vkCmdEndQuery(command_buffer, p->frames[p->current_frame].query_pool, 0);
+}
+
+bool get_result_pipeline_stats(const pipeline_stats *p, pipeline_stats_result *result) {
+    if (p->total_samples == 0) {
+        return false;
+    }
+    *result = p->last;
+    // the frame being recorded is the last one begun
+    result->latency_frames = (uint32_t) (p->frame_index - 1 - p->last_frame_index);
+
+    return true;
+}
+
+void destroy_pipeline_stats(pipeline_stats *p) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (p->frames[i].query_pool) {
+            vkDestroyQueryPool(context.device, p->frames[i].query_pool, NULL);
+        }
+    }
+
+    init_pipeline_stats(p);
+}
+
+bool init_pipe_stats() {
+    return create_pipeline_stats(&pipe_stats, context.frames_in_flight);
+}
+
+bool begin_frame_pipe_stats(uint32_t frame, VkCommandBuffer command_buffer) {
+    return begin_frame_pipeline_stats(&pipe_stats, frame, command_buffer);
+}
+
+bool begin_pipe_stats_draws(VkCommandBuffer command_buffer, bool secondary, uint32_t pixels) {
+    return begin_draws_pipeline_stats(&pipe_stats, command_buffer, secondary, pixels);
+}
+
+void end_pipe_stats_draws(VkCommandBuffer command_buffer) {
+    end_draws_pipeline_stats(&pipe_stats, command_buffer);
+}
+
+bool get_pipe_stats(pipeline_stats_result *result) {
+    return get_result_pipeline_stats(&pipe_stats, result);
+}
+
+void log_pipe_stats() {
+    pipeline_stats_result result;
+    if (get_pipe_stats(&result)) {
+        log_info("draw pass: %llu vertices %llu primitives %llu fragments, overdraw %.2f, %u frames old",
+            (unsigned long long) result.vertex_invocations, (unsigned long long) result.primitives,
+            (unsigned long long) result.fragment_invocations, result.overdraw, result.latency_frames);
+    }
+}
+
+void destroy_pipe_stats() {
+    destroy_pipeline_stats(&pipe_stats);
+}
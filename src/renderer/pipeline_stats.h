@@ -0,0 +1,65 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vulkan/config.h"
+
+#define PIPELINE_STATS_FLAGS (VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | \
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT)
+
+// counters of the draw pass, in the order of the bits of PIPELINE_STATS_FLAGS
+typedef struct pipeline_stats_result {
+    uint64_t vertex_invocations;
+    uint64_t primitives;
+    uint64_t fragment_invocations;
+    // fragment invocations per pixel of the target, 1 when every pixel is shaded exactly once
+    float overdraw;
+    // frames since the one these were counted in
+    uint32_t latency_frames;
+} pipeline_stats_result;
+
+typedef struct pipeline_stats_frame {
+    VkQueryPool query_pool;
+    uint32_t pixels;
+    uint64_t frame_index;
+    bool recorded;
+} pipeline_stats_frame;
+
+// one query around the draw pass of each frame, read back without waiting once the frame slot comes around again
+typedef struct pipeline_stats {
+    pipeline_stats_frame frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t frames_size;
+    uint32_t current_frame;
+    uint64_t frame_index;
+
+    pipeline_stats_result last;
+    uint64_t last_frame_index;
+    // every result ever read back, tells a new one from a repeated one
+    uint64_t total_samples;
+} pipeline_stats;
+
+void init_pipeline_stats(pipeline_stats *p);
+// does nothing when the device has no pipeline statistics queries
+bool create_pipeline_stats(pipeline_stats *p, uint32_t frames_size);
+// after the fence of the frame, resolves what it recorded last time and resets its query outside of any render pass
+bool begin_frame_pipeline_stats(pipeline_stats *p, uint32_t frame, VkCommandBuffer command_buffer);
+// false when nothing is counted, the draws of secondary command buffers need inherited queries
+bool begin_draws_pipeline_stats(pipeline_stats *p, VkCommandBuffer command_buffer, bool secondary, uint32_t pixels);
+void end_draws_pipeline_stats(pipeline_stats *p, VkCommandBuffer command_buffer);
+bool get_result_pipeline_stats(const pipeline_stats *p, pipeline_stats_result *result);
+void destroy_pipeline_stats(pipeline_stats *p);
+
+extern pipeline_stats pipe_stats;
+
+bool init_pipe_stats();
+bool begin_frame_pipe_stats(uint32_t frame, VkCommandBuffer command_buffer);
+bool begin_pipe_stats_draws(VkCommandBuffer command_buffer, bool secondary, uint32_t pixels);
+void end_pipe_stats_draws(VkCommandBuffer command_buffer);
+bool get_pipe_stats(pipeline_stats_result *result);
+void log_pipe_stats();
+void destroy_pipe_stats();
+
+#endif // PIPELINE_STATS_H
@@ -0,0 +1,269 @@
+#include "./record_workers.h"
+
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/tools/tools.h"
+#include "../vulkan/context.h"
+#include "../logger/logger.h"
+#include "../profiler/cpu_profiler.h"
+
+record_worker_pool record_workers;
+
+static void init_record_worker(record_worker *w, record_worker_pool *p) {
+    w->pool = p;
+    w->thread = NULL;
+    w->start = NULL;
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        w->command_pools[i] = VK_NULL_HANDLE;
+        w->command_buffers[i] = VK_NULL_HANDLE;
+        w->depth_command_buffers[i] = VK_NULL_HANDLE;
+    }
+    w->batches = NULL;
+    w->batches_size = 0;
+    w->success = false;
+    init_command_state(&w->state);
+}
+
+static bool begin_worker_commands(record_worker *w, VkCommandBuffer command_buffer, const record_target *target) {
+    VkCommandBufferInheritanceInfo inheritance_info = {
+        .sType                = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext                = NULL,
+        .renderPass           = context.render_pass,
+        .subpass              = 0,
+        .framebuffer          = target->framebuffer,
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags           = 0,
+        .pipelineStatistics   = target->pipeline_statistics
+    };
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext            = NULL,
+        .flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+            VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritance_info
+    };
+
+    CHECK_VK(vkBeginCommandBuffer(command_buffer, &begin_info));
+
+    begin_command_state(&w->state, command_buffer);
+
+    // dynamic state is not inherited from the primary command buffer
+    set_viewport_command_state(&w->state, &target->viewport);
+    set_scissor_command_state(&w->state, &target->scissor);
+
+    return true;
+}
+
+static bool record_worker_commands(record_worker *w, const record_target *target) {
+    CHECK_VK(vkResetCommandPool(context.device, w->command_pools[target->frame], 0));
+    init_command_state_counters(&w->state.counters);
+
+    if (target->depth_prepass) {
+        VkCommandBuffer depth_command_buffer = w->depth_command_buffers[target->frame];
+        if (!begin_worker_commands(w, depth_command_buffer, target)) {
+            return false;
+        }
+        record_depth_batches(w->batches, w->batches_size, &w->state);
+        CHECK_VK(vkEndCommandBuffer(depth_command_buffer));
+    }
+
+    VkCommandBuffer command_buffer = w->command_buffers[target->frame];
+    if (!begin_worker_commands(w, command_buffer, target)) {
+        return false;
+    }
+    record_draw_batches(w->batches, w->batches_size, &w->state);
+    CHECK_VK(vkEndCommandBuffer(command_buffer));
+
+    return true;
+}
+
+static int record_worker_thread(void *data) {
+    record_worker *w = data;
+
+    while (true) {
+        SDL_SemWait(w->start);
+        if (w->pool->quit) {
+            break;
+        }
+        begin_cpu_zone("record_worker");
+        w->success = record_worker_commands(w, w->pool->target);
+        end_cpu_zone();
+        SDL_SemPost(w->pool->done);
+    }
+
+    return 0;
+}
+
+static bool create_record_worker_command_buffers(record_worker *w) {
+    VkCommandPoolCreateInfo pool_info = {
+        .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext            = NULL,
+        .flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = context.graphics_family_index
+    };
+
+    for (size_t i = 0; i < context.frames_in_flight; i++) {
+        CHECK_VK(vkCreateCommandPool(context.device, &pool_info, NULL, &w->command_pools[i]));
+
+        VkCommandBufferAllocateInfo allocate_info = {
+            .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext              = NULL,
+            .commandPool        = w->command_pools[i],
+            .level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1
+        };
+
+        CHECK_VK(vkAllocateCommandBuffers(context.device, &allocate_info, &w->command_buffers[i]));
+        CHECK_VK(vkAllocateCommandBuffers(context.device, &allocate_info, &w->depth_command_buffers[i]));
+    }
+
+    return true;
+}
+
+void init_record_worker_pool(record_worker_pool *p) {
+    for (size_t i = 0; i < MAX_RECORD_WORKERS; i++) {
+        init_record_worker(&p->workers[i], p);
+    }
+    p->workers_size = 0;
+    p->done = NULL;
+    p->target = NULL;
+    p->quit = false;
+}
+
+bool create_record_worker_pool(record_worker_pool *p, uint32_t workers_size) {
+    init_record_worker_pool(p);
+
+    if (workers_size == 0) {
+        workers_size = 1;
+    }
+    if (workers_size > MAX_RECORD_WORKERS) {
+        log_warning("Requested %u record workers, limiting to %d", workers_size, MAX_RECORD_WORKERS);
+        workers_size = MAX_RECORD_WORKERS;
+    }
+
+    p->done = SDL_CreateSemaphore(0);
+    if (!p->done) {
+        log_error("Unable to create record worker semaphore: %s", SDL_GetError());
+        return false;
+    }
+
+    for (uint32_t i = 0; i < workers_size; i++) {
+        record_worker *w = &p->workers[i];
+        p->workers_size++;
+
+        if (!create_record_worker_command_buffers(w)) {
+            return false;
+        }
+        if (i == 0) {
+            continue;
+        }
+
+        w->start = SDL_CreateSemaphore(0);
+        if (!w->start) {
+            log_error("Unable to create record worker semaphore: %s", SDL_GetError());
+            return false;
+        }
+        w->thread = SDL_CreateThread(record_worker_thread, "record_worker", w);
+        if (!w->thread) {
+            log_error("Unable to create record worker thread: %s", SDL_GetError());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool record_draws_record_worker_pool(record_worker_pool *p, const record_target *target,
+    const draw_batch *batches, size_t batches_size, VkCommandBuffer primary_command_buffer,
+    command_state_counters *counters)
+{
+    uint32_t workers_used = p->workers_size;
+    if (batches_size < workers_used) {
+        workers_used = batches_size > 0 ? batches_size : 1;
+    }
+
+    size_t batches_per_worker = batches_size / workers_used;
+    size_t batches_remainder = batches_size % workers_used;
+    size_t batches_offset = 0;
+
+    p->target = target;
+    for (uint32_t i = 0; i < workers_used; i++) {
+        record_worker *w = &p->workers[i];
+        w->batches = &batches[batches_offset];
+        w->batches_size = batches_per_worker + (i < batches_remainder ? 1 : 0);
+        w->success = false;
+        batches_offset += w->batches_size;
+    }
+
+    for (uint32_t i = 1; i < workers_used; i++) {
+        SDL_SemPost(p->workers[i].start);
+    }
+    begin_cpu_zone("record_worker");
+    p->workers[0].success = record_worker_commands(&p->workers[0], target);
+    end_cpu_zone();
+    begin_cpu_zone("record_join");
+    for (uint32_t i = 1; i < workers_used; i++) {
+        SDL_SemWait(p->done);
+    }
+    end_cpu_zone();
+
+    // all of the depth first, so no worker draws before the depth of a later one is laid down
+    VkCommandBuffer command_buffers[MAX_RECORD_WORKERS * 2];
+    uint32_t command_buffers_size = 0;
+    bool success = true;
+    for (uint32_t i = 0; i < workers_used && target->depth_prepass; i++) {
+        command_buffers[command_buffers_size++] = p->workers[i].depth_command_buffers[target->frame];
+    }
+    for (uint32_t i = 0; i < workers_used; i++) {
+        success = success && p->workers[i].success;
+        command_buffers[command_buffers_size++] = p->workers[i].command_buffers[target->frame];
+        add_command_state_counters(counters, &p->workers[i].state.counters);
+    }
+    if (!success) {
+        log_error("Unable to record draws on worker threads");
+        return false;
+    }
+
+    vkCmdExecuteCommands(primary_command_buffer, command_buffers_size, command_buffers);
+
+    return true;
+}
+
+void destroy_record_worker_pool(record_worker_pool *p) {
+    p->quit = true;
+    for (uint32_t i = 0; i < p->workers_size; i++) {
+        record_worker *w = &p->workers[i];
+        if (w->thread) {
+            SDL_SemPost(w->start);
+            SDL_WaitThread(w->thread, NULL);
+        }
+        if (w->start) {
+            SDL_DestroySemaphore(w->start);
+        }
+        for (size_t j = 0; j < MAX_FRAMES_IN_FLIGHT; j++) {
+            if (w->command_pools[j]) {
+                vkDestroyCommandPool(context.device, w->command_pools[j], NULL);
+            }
+        }
+    }
+    if (p->done) {
+        SDL_DestroySemaphore(p->done);
+    }
+
+    init_record_worker_pool(p);
+}
+
+bool init_record_workers(uint32_t workers_size) {
+    return create_record_worker_pool(&record_workers, workers_size);
+}
+
+bool record_draws(const record_target *target, const draw_batch *batches, size_t batches_size,
+    VkCommandBuffer primary_command_buffer, command_state_counters *counters)
+{
+    return record_draws_record_worker_pool(&record_workers, target, batches, batches_size, primary_command_buffer,
+        counters);
+}
+
+void destroy_record_workers() {
+    destroy_record_worker_pool(&record_workers);
+}
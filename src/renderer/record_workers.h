@@ -0,0 +1,67 @@
+#ifndef RECORD_WORKERS_H
+#define RECORD_WORKERS_H
+
+#include <vulkan/vulkan.h>
+#include <SDL2/SDL.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vulkan/config.h"
+#include "./render_queue.h"
+#include "./command_state.h"
+
+#define MAX_RECORD_WORKERS 16
+
+typedef struct record_target {
+    uint32_t frame;
+    VkFramebuffer framebuffer;
+    VkViewport viewport;
+    VkRect2D scissor;
+    // the depth of every batch is recorded before any of them is drawn
+    bool depth_prepass;
+    // of the query active around the draws, the secondary command buffers inherit it
+    VkQueryPipelineStatisticFlags pipeline_statistics;
+} record_target;
+
+struct record_worker_pool;
+
+typedef struct record_worker {
+    struct record_worker_pool *pool;
+    SDL_Thread *thread;
+    SDL_sem *start;
+
+    VkCommandPool command_pools[MAX_FRAMES_IN_FLIGHT];
+    VkCommandBuffer command_buffers[MAX_FRAMES_IN_FLIGHT];
+    VkCommandBuffer depth_command_buffers[MAX_FRAMES_IN_FLIGHT];
+
+    const draw_batch *batches;
+    size_t batches_size;
+    bool success;
+    command_state state;
+} record_worker;
+
+// worker 0 records on the calling thread, the rest run on their own threads
+typedef struct record_worker_pool {
+    record_worker workers[MAX_RECORD_WORKERS];
+    uint32_t workers_size;
+
+    SDL_sem *done;
+    const record_target *target;
+    bool quit;
+} record_worker_pool;
+
+void init_record_worker_pool(record_worker_pool *p);
+bool create_record_worker_pool(record_worker_pool *p, uint32_t workers_size);
+bool record_draws_record_worker_pool(record_worker_pool *p, const record_target *target,
+    const draw_batch *batches, size_t batches_size, VkCommandBuffer primary_command_buffer,
+    command_state_counters *counters);
+void destroy_record_worker_pool(record_worker_pool *p);
+
+extern record_worker_pool record_workers;
+
+bool init_record_workers(uint32_t workers_size);
+bool record_draws(const record_target *target, const draw_batch *batches, size_t batches_size,
+    VkCommandBuffer primary_command_buffer, command_state_counters *counters);
+void destroy_record_workers();
+
+#endif // RECORD_WORKERS_H
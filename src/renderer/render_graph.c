@@ -0,0 +1,728 @@
+#include "./render_graph.h"
+
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/tools/tools.h"
+#include "../vulkan/context.h"
+#include "../logger/logger.h"
+#include "./gpu_profiler.h"
+
+#define WRITE_ACCESS_MASK (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | \
+    VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT)
+
+typedef struct render_graph_usage_info {
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    VkImageLayout layout;
+    bool write;
+} render_graph_usage_info;
+
+static const render_graph_usage_info usage_infos[RG_USAGES_SIZE] = {
+    [RG_USAGE_COLOR_ATTACHMENT] = {
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true
+    },
+    [RG_USAGE_DEPTH_ATTACHMENT] = {
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true
+    },
+    [RG_USAGE_DEPTH_SAMPLED] = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false
+    },
+    [RG_USAGE_COMPUTE_READ] = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false
+    },
+    [RG_USAGE_COMPUTE_WRITE] = {
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, true
+    },
+    [RG_USAGE_INDIRECT_READ] = {
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false
+    },
+    [RG_USAGE_TRANSFER_READ] = {
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false
+    },
+    [RG_USAGE_TRANSFER_WRITE] = {
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true
+    },
+    [RG_USAGE_HOST_READ] = {
+        VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false
+    },
+    // presentation waits on the submit semaphore, only the layout matters
+    [RG_USAGE_PRESENT] = {
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false
+    }
+};
+
+static void init_state(render_graph_state *s, VkImageLayout layout) {
+    s->layout = layout;
+    s->write_stages = 0;
+    s->write_access = 0;
+    s->read_stages = 0;
+    s->visible_stages = 0;
+    s->visible_access = 0;
+}
+
+static void init_transient(render_graph_transient *t) {
+    t->name = NULL;
+    t->first_pass = RENDER_GRAPH_NONE;
+    t->last_pass = RENDER_GRAPH_NONE;
+    t->image = VK_NULL_HANDLE;
+    t->view = VK_NULL_HANDLE;
+    t->offset = 0;
+    t->size = 0;
+    t->stages = 0;
+    t->write_access = 0;
+}
+
+void init_render_graph(render_graph *g) {
+    g->passes_size = 0;
+    g->resources_size = 0;
+    g->image_barriers_size = 0;
+    g->transients_size = 0;
+    g->declared_size = 0;
+    for (size_t i = 0; i < RENDER_GRAPH_MAX_TRANSIENTS; i++) {
+        init_transient(&g->transients[i]);
+        init_transient(&g->declared[i]);
+    }
+    init_vk_allocation(&g->transient_allocation);
+    g->compiled = false;
+    g->valid = true;
+}
+
+void reset_render_graph(render_graph *g) {
+    g->passes_size = 0;
+    g->resources_size = 0;
+    g->image_barriers_size = 0;
+    g->declared_size = 0;
+    g->compiled = false;
+    g->valid = true;
+}
+
+static uint32_t add_resource(render_graph *g, const char *name) {
+    if (g->resources_size >= RENDER_GRAPH_MAX_RESOURCES) {
+        log_error("No room for render graph resource %s", name);
+        g->valid = false;
+        return RENDER_GRAPH_NONE;
+    }
+    render_graph_resource *r = &g->resources[g->resources_size];
+    r->name = name;
+    r->is_image = false;
+    r->image = VK_NULL_HANDLE;
+    r->view = VK_NULL_HANDLE;
+    r->buffer = VK_NULL_HANDLE;
+    r->aspect = 0;
+    r->tracked_layout = NULL;
+    r->initial_stages = 0;
+    r->transient = RENDER_GRAPH_NONE;
+    r->output = false;
+    r->has_final_usage = false;
+    r->final_usage = RG_USAGE_COMPUTE_READ;
+    init_state(&r->state, VK_IMAGE_LAYOUT_UNDEFINED);
+
+    return g->resources_size++;
+}
+
+uint32_t import_image_render_graph(render_graph *g, const char *name, VkImage image, VkImageView view,
+    VkImageAspectFlags aspect, VkImageLayout *tracked_layout)
+{
+    uint32_t resource = add_resource(g, name);
+    if (resource == RENDER_GRAPH_NONE) {
+        return resource;
+    }
+    render_graph_resource *r = &g->resources[resource];
+    r->is_image = true;
+    r->image = image;
+    r->view = view;
+    r->aspect = aspect;
+    r->tracked_layout = tracked_layout;
+
+    return resource;
+}
+
+uint32_t import_buffer_render_graph(render_graph *g, const char *name, VkBuffer buffer) {
+    uint32_t resource = add_resource(g, name);
+    if (resource != RENDER_GRAPH_NONE) {
+        g->resources[resource].buffer = buffer;
+    }
+    return resource;
+}
+
+uint32_t create_image_render_graph(render_graph *g, const char *name, const render_graph_image_desc *desc) {
+    if (g->declared_size >= RENDER_GRAPH_MAX_TRANSIENTS) {
+        log_error("No room for transient image %s", name);
+        g->valid = false;
+        return RENDER_GRAPH_NONE;
+    }
+    uint32_t resource = add_resource(g, name);
+    if (resource == RENDER_GRAPH_NONE) {
+        return resource;
+    }
+    render_graph_transient *t = &g->declared[g->declared_size];
+    init_transient(t);
+    t->name = name;
+    t->desc = *desc;
+
+    render_graph_resource *r = &g->resources[resource];
+    r->is_image = true;
+    r->aspect = desc->aspect;
+    r->transient = g->declared_size++;
+
+    return resource;
+}
+
+void set_initial_stages_render_graph(render_graph *g, uint32_t resource, VkPipelineStageFlags stages) {
+    if (resource < g->resources_size) {
+        g->resources[resource].initial_stages = stages;
+    }
+}
+
+void set_output_render_graph(render_graph *g, uint32_t resource) {
+    if (resource < g->resources_size) {
+        g->resources[resource].output = true;
+    }
+}
+
+void set_final_usage_render_graph(render_graph *g, uint32_t resource, render_graph_usage final_usage) {
+    if (resource < g->resources_size) {
+        g->resources[resource].output = true;
+        g->resources[resource].has_final_usage = true;
+        g->resources[resource].final_usage = final_usage;
+    }
+}
+
+uint32_t add_pass_render_graph(render_graph *g, const char *name, render_graph_execute_function execute,
+    void *data)
+{
+    if (g->passes_size >= RENDER_GRAPH_MAX_PASSES) {
+        log_error("No room for render graph pass %s", name);
+        g->valid = false;
+        return RENDER_GRAPH_NONE;
+    }
+    render_graph_pass *p = &g->passes[g->passes_size];
+    p->name = name;
+    p->execute = execute;
+    p->data = data;
+    p->accesses_size = 0;
+    p->side_effects = false;
+    p->culled = false;
+
+    return g->passes_size++;
+}
+
+void set_side_effects_render_graph(render_graph *g, uint32_t pass) {
+    if (pass < g->passes_size) {
+        g->passes[pass].side_effects = true;
+    }
+}
+
+static bool add_access(render_graph *g, uint32_t pass, uint32_t resource, render_graph_usage usage, bool attachment,
+    VkImageLayout final_layout)
+{
+    if (pass >= g->passes_size || resource >= g->resources_size) {
+        g->valid = false;
+        return false;
+    }
+    render_graph_pass *p = &g->passes[pass];
+    if (p->accesses_size >= RENDER_GRAPH_MAX_PASS_RESOURCES) {
+        log_error("No room for another resource of render graph pass %s", p->name);
+        g->valid = false;
+        return false;
+    }
+    render_graph_access *a = &p->accesses[p->accesses_size++];
+    a->resource = resource;
+    a->usage = usage;
+    a->attachment = attachment;
+    a->final_layout = final_layout;
+
+    return true;
+}
+
+bool use_render_graph(render_graph *g, uint32_t pass, uint32_t resource, render_graph_usage usage) {
+    return add_access(g, pass, resource, usage, false, usage_infos[usage].layout);
+}
+
+bool use_attachment_render_graph(render_graph *g, uint32_t pass, uint32_t resource, render_graph_usage usage,
+    VkImageLayout final_layout)
+{
+    return add_access(g, pass, resource, usage, true, final_layout);
+}
+
+static bool is_write(const render_graph_access *a) {
+    return a->attachment || usage_infos[a->usage].write;
+}
+
+// walks back from the outputs, a pass lives when a later living pass or an output needs what it writes
+static void cull_passes(render_graph *g) {
+    bool needed[RENDER_GRAPH_MAX_RESOURCES];
+    for (uint32_t i = 0; i < g->resources_size; i++) {
+        needed[i] = g->resources[i].output;
+    }
+
+    for (uint32_t i = g->passes_size; i-- > 0;) {
+        render_graph_pass *p = &g->passes[i];
+        bool alive = p->side_effects;
+        for (uint32_t j = 0; j < p->accesses_size && !alive; j++) {
+            alive = is_write(&p->accesses[j]) && needed[p->accesses[j].resource];
+        }
+        p->culled = !alive;
+        if (!alive) {
+            continue;
+        }
+        for (uint32_t j = 0; j < p->accesses_size; j++) {
+            needed[p->accesses[j].resource] = true;
+        }
+    }
+}
+
+static void get_lifetimes(render_graph *g) {
+    for (uint32_t i = 0; i < g->passes_size; i++) {
+        const render_graph_pass *p = &g->passes[i];
+        if (p->culled) {
+            continue;
+        }
+        for (uint32_t j = 0; j < p->accesses_size; j++) {
+            const render_graph_resource *r = &g->resources[p->accesses[j].resource];
+            if (r->transient == RENDER_GRAPH_NONE) {
+                continue;
+            }
+            render_graph_transient *t = &g->declared[r->transient];
+            const render_graph_usage_info *info = &usage_infos[p->accesses[j].usage];
+            if (t->first_pass == RENDER_GRAPH_NONE) {
+                t->first_pass = i;
+            }
+            t->last_pass = i;
+            t->stages |= info->stages;
+            t->write_access |= info->access & WRITE_ACCESS_MASK;
+        }
+    }
+}
+
+static bool same_transients(const render_graph *g) {
+    if (g->declared_size != g->transients_size) {
+        return false;
+    }
+    for (uint32_t i = 0; i < g->declared_size; i++) {
+        const render_graph_transient *a = &g->declared[i], *b = &g->transients[i];
+        bool same = a->desc.format == b->desc.format &&
+            a->desc.extent.width == b->desc.extent.width &&
+            a->desc.extent.height == b->desc.extent.height &&
+            a->desc.usage == b->desc.usage &&
+            a->desc.aspect == b->desc.aspect &&
+            a->first_pass == b->first_pass &&
+            a->last_pass == b->last_pass;
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void destroy_transients(render_graph *g) {
+    for (uint32_t i = 0; i < g->transients_size; i++) {
+        render_graph_transient *t = &g->transients[i];
+        if (t->view) {
+            vkDestroyImageView(context.device, t->view, NULL);
+        }
+        if (t->image) {
+            vkDestroyImage(context.device, t->image, NULL);
+        }
+        init_transient(t);
+    }
+    g->transients_size = 0;
+    if (g->transient_allocation.block) {
+        vk_free_allocation(&g->transient_allocation);
+        init_vk_allocation(&g->transient_allocation);
+    }
+}
+
+static bool overlaps(const render_graph_transient *a, const render_graph_transient *b) {
+    return a->first_pass <= b->last_pass && b->first_pass <= a->last_pass;
+}
+
+// largest first, each at the lowest offset not in use by a transient living at the same time
+static VkDeviceSize place_transients(render_graph *g, const VkDeviceSize *alignments) {
+    uint32_t order[RENDER_GRAPH_MAX_TRANSIENTS];
+    uint32_t order_size = 0;
+    for (uint32_t i = 0; i < g->transients_size; i++) {
+        if (g->transients[i].image) {
+            order[order_size++] = i;
+        }
+    }
+    for (uint32_t i = 1; i < order_size; i++) {
+        uint32_t current = order[i];
+        uint32_t j = i;
+        for (; j > 0 && g->transients[order[j - 1]].size < g->transients[current].size; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = current;
+    }
+
+    VkDeviceSize total = 0;
+    for (uint32_t i = 0; i < order_size; i++) {
+        render_graph_transient *t = &g->transients[order[i]];
+        VkDeviceSize alignment = alignments[order[i]];
+        VkDeviceSize offset = 0;
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            for (uint32_t j = 0; j < i; j++) {
+                const render_graph_transient *placed = &g->transients[order[j]];
+                bool collides = overlaps(t, placed) &&
+                    offset < placed->offset + placed->size && placed->offset < offset + t->size;
+                if (collides) {
+                    offset = (placed->offset + placed->size + alignment - 1) / alignment * alignment;
+                    moved = true;
+                }
+            }
+        }
+        t->offset = offset;
+        if (offset + t->size > total) {
+            total = offset + t->size;
+        }
+    }
+
+    return total;
+}
+
+static bool create_transients(render_graph *g) {
+    if (g->transients_size > 0) {
+        // only when the frame structure changes, the images may still be in use by frames in flight
+        vkDeviceWaitIdle(context.device);
+    }
+    destroy_transients(g);
+
+    VkDeviceSize alignments[RENDER_GRAPH_MAX_TRANSIENTS];
+    VkDeviceSize max_alignment = 1;
+    uint32_t memory_type_bits = UINT32_MAX;
+    for (uint32_t i = 0; i < g->declared_size; i++) {
+        render_graph_transient *t = &g->transients[i];
+        *t = g->declared[i];
+        t->image = VK_NULL_HANDLE;
+        t->view = VK_NULL_HANDLE;
+        g->transients_size++;
+        // culled before it was ever used
+        if (t->first_pass == RENDER_GRAPH_NONE) {
+            continue;
+        }
+
+        VkImageCreateInfo image_info = {
+            .sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .pNext                 = NULL,
+            .flags                 = 0,
+            .imageType             = VK_IMAGE_TYPE_2D,
+            .format                = t->desc.format,
+            .extent                = { t->desc.extent.width, t->desc.extent.height, 1 },
+            .mipLevels             = 1,
+            .arrayLayers           = 1,
+            .samples               = VK_SAMPLE_COUNT_1_BIT,
+            .tiling                = VK_IMAGE_TILING_OPTIMAL,
+            .usage                 = t->desc.usage,
+            .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices   = NULL,
+            .initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED
+        };
+        CHECK_VK(vkCreateImage(context.device, &image_info, NULL, &t->image));
+
+        VkMemoryRequirements memory_requirements;
+        vkGetImageMemoryRequirements(context.device, t->image, &memory_requirements);
+        t->size = memory_requirements.size;
+        alignments[i] = memory_requirements.alignment;
+        if (memory_requirements.alignment > max_alignment) {
+            max_alignment = memory_requirements.alignment;
+        }
+        memory_type_bits &= memory_requirements.memoryTypeBits;
+    }
+
+    VkDeviceSize total = place_transients(g, alignments);
+    if (total == 0) {
+        return true;
+    }
+
+    bool success = vk_allocate(&g->transient_allocation, (uint32_t) total, (uint32_t) max_alignment, memory_type_bits,
+        VULKAN_MEMORY_USAGE_GPU_ONLY, VULKAN_ALLOCATION_TYPE_IMAGE_OPTIMAL);
+    if (!success) {
+        log_error("Unable to allocate the transient images");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < g->transients_size; i++) {
+        render_graph_transient *t = &g->transients[i];
+        if (!t->image) {
+            continue;
+        }
+        CHECK_VK(vkBindImageMemory(context.device, t->image, g->transient_allocation.device_memory,
+            g->transient_allocation.offset + t->offset));
+
+        VkImageViewCreateInfo view_info = {
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .pNext            = NULL,
+            .flags            = 0,
+            .image            = t->image,
+            .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+            .format           = t->desc.format,
+            .components       = {
+                .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+                .a = VK_COMPONENT_SWIZZLE_IDENTITY
+            },
+            .subresourceRange = {
+                .aspectMask     = t->desc.aspect,
+                .baseMipLevel   = 0,
+                .levelCount     = 1,
+                .baseArrayLayer = 0,
+                .layerCount     = 1
+            }
+        };
+        CHECK_VK(vkCreateImageView(context.device, &view_info, NULL, &t->view));
+    }
+
+    return true;
+}
+
+// a transient starts undefined, after every use of the memory it shares, here or in the previous frame
+static void init_transient_state(const render_graph *g, const render_graph_transient *t, render_graph_state *s) {
+    init_state(s, VK_IMAGE_LAYOUT_UNDEFINED);
+    for (uint32_t i = 0; i < g->transients_size; i++) {
+        const render_graph_transient *other = &g->transients[i];
+        bool shares = other->image && other->offset < t->offset + t->size && t->offset < other->offset + other->size;
+        if (shares) {
+            s->write_stages |= other->stages;
+            s->write_access |= other->write_access;
+        }
+    }
+}
+
+static bool add_barrier(render_graph *g, render_graph_barriers *b, render_graph_resource *r,
+    render_graph_usage usage, bool attachment, VkImageLayout final_layout)
+{
+    const render_graph_usage_info *info = &usage_infos[usage];
+    render_graph_state *s = &r->state;
+    VkPipelineStageFlags previous_stages = s->write_stages | s->read_stages;
+    bool write = attachment || info->write;
+    // render passes move their attachments out of whatever layout they are in
+    bool transition = r->is_image && !attachment && s->layout != info->layout;
+
+    if (transition) {
+        if (g->image_barriers_size >= RENDER_GRAPH_MAX_IMAGE_BARRIERS) {
+            log_error("No room for another render graph image barrier");
+            return false;
+        }
+        VkImageMemoryBarrier *barrier = &g->image_barriers[g->image_barriers_size++];
+        barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier->pNext = NULL;
+        barrier->srcAccessMask = s->write_access;
+        barrier->dstAccessMask = info->access;
+        barrier->oldLayout = s->layout;
+        barrier->newLayout = info->layout;
+        barrier->srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier->dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier->image = r->image;
+        barrier->subresourceRange.aspectMask = r->aspect;
+        barrier->subresourceRange.baseMipLevel = 0;
+        barrier->subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        barrier->subresourceRange.baseArrayLayer = 0;
+        barrier->subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        b->image_barriers_size++;
+        b->src_stages |= previous_stages;
+        b->dst_stages |= info->stages;
+    } else if (write && previous_stages) {
+        // after reads only the execution has to be ordered
+        b->src_stages |= previous_stages;
+        b->dst_stages |= info->stages;
+        if (s->write_access) {
+            b->src_access |= s->write_access;
+            b->dst_access |= info->access;
+        }
+    } else if (!write && s->write_stages && info->access &&
+        ((info->stages & ~s->visible_stages) || (info->access & ~s->visible_access)))
+    {
+        b->src_stages |= s->write_stages;
+        b->src_access |= s->write_access;
+        b->dst_stages |= info->stages;
+        b->dst_access |= info->access;
+    }
+
+    if (write || transition) {
+        s->write_stages = write ? info->stages : 0;
+        s->write_access = write ? info->access & WRITE_ACCESS_MASK : 0;
+        s->read_stages = write ? 0 : info->stages;
+        s->visible_stages = info->stages;
+        s->visible_access = info->access;
+    } else {
+        s->read_stages |= info->stages;
+        s->visible_stages |= info->stages;
+        s->visible_access |= info->access;
+    }
+    s->layout = r->is_image ? (attachment ? final_layout : info->layout) : s->layout;
+
+    return true;
+}
+
+static void init_barriers(render_graph *g, render_graph_barriers *b) {
+    b->src_stages = 0;
+    b->dst_stages = 0;
+    b->src_access = 0;
+    b->dst_access = 0;
+    b->image_barriers_start = g->image_barriers_size;
+    b->image_barriers_size = 0;
+}
+
+bool compile_render_graph(render_graph *g) {
+    if (!g->valid) {
+        log_error("Render graph declared with errors");
+        return false;
+    }
+
+    cull_passes(g);
+    get_lifetimes(g);
+    if (!same_transients(g) && !create_transients(g)) {
+        return false;
+    }
+    // the stages of this frame, for the next one to wait on
+    for (uint32_t i = 0; i < g->transients_size; i++) {
+        g->transients[i].stages = g->declared[i].stages;
+        g->transients[i].write_access = g->declared[i].write_access;
+    }
+
+    for (uint32_t i = 0; i < g->resources_size; i++) {
+        render_graph_resource *r = &g->resources[i];
+        if (r->transient != RENDER_GRAPH_NONE) {
+            const render_graph_transient *t = &g->transients[r->transient];
+            r->image = t->image;
+            r->view = t->view;
+            init_transient_state(g, t, &r->state);
+        } else {
+            // whoever used it last left it in a known layout with its writes available
+            init_state(&r->state, r->tracked_layout ? *r->tracked_layout : VK_IMAGE_LAYOUT_UNDEFINED);
+            r->state.read_stages = r->initial_stages;
+        }
+    }
+
+    g->image_barriers_size = 0;
+    for (uint32_t i = 0; i < g->passes_size; i++) {
+        render_graph_pass *p = &g->passes[i];
+        init_barriers(g, &p->barriers);
+        if (p->culled) {
+            continue;
+        }
+        for (uint32_t j = 0; j < p->accesses_size; j++) {
+            const render_graph_access *a = &p->accesses[j];
+            if (!add_barrier(g, &p->barriers, &g->resources[a->resource], a->usage, a->attachment,
+                a->final_layout))
+            {
+                return false;
+            }
+        }
+    }
+
+    init_barriers(g, &g->final_barriers);
+    for (uint32_t i = 0; i < g->resources_size; i++) {
+        render_graph_resource *r = &g->resources[i];
+        if (r->has_final_usage &&
+            !add_barrier(g, &g->final_barriers, r, r->final_usage, false, VK_IMAGE_LAYOUT_UNDEFINED))
+        {
+            return false;
+        }
+    }
+
+    g->compiled = true;
+
+    return true;
+}
+
+static void record_barriers(const render_graph *g, VkCommandBuffer command_buffer, const render_graph_barriers *b) {
+    if (b->dst_stages == 0) {
+        return;
+    }
+    VkMemoryBarrier barrier = {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext         = NULL,
+        .srcAccessMask = b->src_access,
+        .dstAccessMask = b->dst_access
+    };
+    bool memory = b->src_access != 0 || b->dst_access != 0;
+    VkPipelineStageFlags src_stages = b->src_stages ? b->src_stages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+    vkCmdPipelineBarrier(command_buffer, src_stages, b->dst_stages, 0, memory ? 1 : 0, memory ? &barrier : NULL,
+        0, NULL, b->image_barriers_size, &g->image_barriers[b->image_barriers_start]);
+}
+
+bool execute_render_graph(render_graph *g, VkCommandBuffer command_buffer) {
+    if (!g->compiled) {
+        log_error("Render graph executed before it was compiled");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < g->passes_size; i++) {
+        const render_graph_pass *p = &g->passes[i];
+        if (p->culled) {
+            continue;
+        }
+        record_barriers(g, command_buffer, &p->barriers);
+        begin_gpu_scope(command_buffer, p->name);
+        bool success = p->execute(command_buffer, p->data);
+        end_gpu_scope(command_buffer);
+        if (!success) {
+            log_error("Unable to record render graph pass %s", p->name);
+            return false;
+        }
+    }
+    record_barriers(g, command_buffer, &g->final_barriers);
+
+    for (uint32_t i = 0; i < g->resources_size; i++) {
+        const render_graph_resource *r = &g->resources[i];
+        if (r->tracked_layout) {
+            *r->tracked_layout = r->state.layout;
+        }
+    }
+
+    return true;
+}
+
+VkImage get_image_render_graph(const render_graph *g, uint32_t resource) {
+    return resource < g->resources_size ? g->resources[resource].image : VK_NULL_HANDLE;
+}
+
+VkImageView get_view_render_graph(const render_graph *g, uint32_t resource) {
+    return resource < g->resources_size ? g->resources[resource].view : VK_NULL_HANDLE;
+}
+
+static void log_barriers(const char *name, const render_graph_barriers *b) {
+    if (b->dst_stages == 0) {
+        log_debug("  %s", name);
+        return;
+    }
+    log_debug("  %s after stages 0x%x -> 0x%x, access 0x%x -> 0x%x, %u image barriers", name, b->src_stages,
+        b->dst_stages, b->src_access, b->dst_access, b->image_barriers_size);
+}
+
+void log_render_graph(const render_graph *g) {
+    log_debug("Render graph, %u passes, %u resources, %u transients", g->passes_size, g->resources_size,
+        g->transients_size);
+    for (uint32_t i = 0; i < g->passes_size; i++) {
+        const render_graph_pass *p = &g->passes[i];
+        if (p->culled) {
+            log_debug("  %s culled", p->name);
+        } else {
+            log_barriers(p->name, &p->barriers);
+        }
+    }
+    log_barriers("end", &g->final_barriers);
+    for (uint32_t i = 0; i < g->transients_size; i++) {
+        const render_graph_transient *t = &g->transients[i];
+        log_debug("  transient %s at %lu, %lu bytes, passes %u to %u", t->name, (unsigned long) t->offset,
+            (unsigned long) t->size, t->first_pass, t->last_pass);
+    }
+}
+
+void destroy_render_graph(render_graph *g) {
+    if (context.device) {
+        destroy_transients(g);
+    }
+    init_render_graph(g);
+}
@@ -0,0 +1,170 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vulkan/memory/memory.h"
+
+#define RENDER_GRAPH_MAX_PASSES         32
+#define RENDER_GRAPH_MAX_RESOURCES      32
+#define RENDER_GRAPH_MAX_PASS_RESOURCES 8
+#define RENDER_GRAPH_MAX_TRANSIENTS     16
+#define RENDER_GRAPH_MAX_IMAGE_BARRIERS 64
+
+#define RENDER_GRAPH_NONE UINT32_MAX
+
+// how a pass uses a resource, each implies the stages, accesses and image layout of the use
+typedef enum render_graph_usage {
+    RG_USAGE_COLOR_ATTACHMENT,
+    RG_USAGE_DEPTH_ATTACHMENT,
+    RG_USAGE_DEPTH_SAMPLED,
+    RG_USAGE_COMPUTE_READ,
+    RG_USAGE_COMPUTE_WRITE,
+    RG_USAGE_INDIRECT_READ,
+    RG_USAGE_TRANSFER_READ,
+    RG_USAGE_TRANSFER_WRITE,
+    RG_USAGE_HOST_READ,
+    RG_USAGE_PRESENT,
+    RG_USAGES_SIZE
+} render_graph_usage;
+
+typedef bool (*render_graph_execute_function)(VkCommandBuffer command_buffer, void *data);
+
+typedef struct render_graph_image_desc {
+    VkFormat format;
+    VkExtent2D extent;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspect;
+} render_graph_image_desc;
+
+// an image created by the graph, it shares memory with the transients whose passes do not overlap
+typedef struct render_graph_transient {
+    const char *name;
+    render_graph_image_desc desc;
+    uint32_t first_pass;
+    uint32_t last_pass;
+    VkImage image;
+    VkImageView view;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    VkPipelineStageFlags stages;
+    VkAccessFlags write_access;
+} render_graph_transient;
+
+typedef struct render_graph_state {
+    VkImageLayout layout;
+    // the last write not yet made available, and the reads after it
+    VkPipelineStageFlags write_stages;
+    VkAccessFlags write_access;
+    VkPipelineStageFlags read_stages;
+    // readers the last write was already made visible to
+    VkPipelineStageFlags visible_stages;
+    VkAccessFlags visible_access;
+} render_graph_state;
+
+typedef struct render_graph_resource {
+    const char *name;
+    bool is_image;
+    VkImage image;
+    VkImageView view;
+    VkBuffer buffer;
+    VkImageAspectFlags aspect;
+    // imported images have their layout tracked by their owner, it is updated once the graph is executed
+    VkImageLayout *tracked_layout;
+    // stages outside the graph its first use waits for, like those of a semaphore wait
+    VkPipelineStageFlags initial_stages;
+    uint32_t transient;
+    // outputs keep their writers alive, some are also moved into the usage of whoever reads them next
+    bool output;
+    bool has_final_usage;
+    render_graph_usage final_usage;
+    render_graph_state state;
+} render_graph_resource;
+
+typedef struct render_graph_access {
+    uint32_t resource;
+    render_graph_usage usage;
+    // render pass attachments are transitioned by the render pass, from undefined to this layout
+    bool attachment;
+    VkImageLayout final_layout;
+} render_graph_access;
+
+// all barriers ahead of a pass, recorded as a single vkCmdPipelineBarrier
+typedef struct render_graph_barriers {
+    VkPipelineStageFlags src_stages;
+    VkPipelineStageFlags dst_stages;
+    VkAccessFlags src_access;
+    VkAccessFlags dst_access;
+    uint32_t image_barriers_start;
+    uint32_t image_barriers_size;
+} render_graph_barriers;
+
+typedef struct render_graph_pass {
+    const char *name;
+    render_graph_execute_function execute;
+    void *data;
+    render_graph_access accesses[RENDER_GRAPH_MAX_PASS_RESOURCES];
+    uint32_t accesses_size;
+    // writes something the graph does not know about, it is never culled
+    bool side_effects;
+    bool culled;
+    render_graph_barriers barriers;
+} render_graph_pass;
+
+// declared again every frame, compiled, then recorded into one command buffer
+typedef struct render_graph {
+    render_graph_pass passes[RENDER_GRAPH_MAX_PASSES];
+    uint32_t passes_size;
+    render_graph_resource resources[RENDER_GRAPH_MAX_RESOURCES];
+    uint32_t resources_size;
+
+    VkImageMemoryBarrier image_barriers[RENDER_GRAPH_MAX_IMAGE_BARRIERS];
+    uint32_t image_barriers_size;
+    render_graph_barriers final_barriers;
+
+    // kept between frames as long as the transients declared and their lifetimes stay the same
+    render_graph_transient transients[RENDER_GRAPH_MAX_TRANSIENTS];
+    uint32_t transients_size;
+    render_graph_transient declared[RENDER_GRAPH_MAX_TRANSIENTS];
+    uint32_t declared_size;
+    vk_allocation transient_allocation;
+
+    bool compiled;
+    bool valid;
+} render_graph;
+
+void init_render_graph(render_graph *g);
+// forgets the passes and resources of the last frame, keeps the transient images
+void reset_render_graph(render_graph *g);
+
+uint32_t import_image_render_graph(render_graph *g, const char *name, VkImage image, VkImageView view,
+    VkImageAspectFlags aspect, VkImageLayout *tracked_layout);
+uint32_t import_buffer_render_graph(render_graph *g, const char *name, VkBuffer buffer);
+uint32_t create_image_render_graph(render_graph *g, const char *name, const render_graph_image_desc *desc);
+// the first barrier of an imported resource waits for these stages, to chain with a semaphore the submit waits on
+void set_initial_stages_render_graph(render_graph *g, uint32_t resource, VkPipelineStageFlags stages);
+// makes the resource an output of the frame
+void set_output_render_graph(render_graph *g, uint32_t resource);
+// an output left in the given usage at the end of the graph, for whoever reads it next
+void set_final_usage_render_graph(render_graph *g, uint32_t resource, render_graph_usage final_usage);
+
+// names are string literals, they also name the GPU profiler scope of the pass
+uint32_t add_pass_render_graph(render_graph *g, const char *name, render_graph_execute_function execute,
+    void *data);
+void set_side_effects_render_graph(render_graph *g, uint32_t pass);
+bool use_render_graph(render_graph *g, uint32_t pass, uint32_t resource, render_graph_usage usage);
+bool use_attachment_render_graph(render_graph *g, uint32_t pass, uint32_t resource, render_graph_usage usage,
+    VkImageLayout final_layout);
+
+// culls the passes no output depends on, places the transients and synthesizes the barriers
+bool compile_render_graph(render_graph *g);
+bool execute_render_graph(render_graph *g, VkCommandBuffer command_buffer);
+// valid while the graph executes, for transients created by it
+VkImage get_image_render_graph(const render_graph *g, uint32_t resource);
+VkImageView get_view_render_graph(const render_graph *g, uint32_t resource);
+void log_render_graph(const render_graph *g);
+void destroy_render_graph(render_graph *g);
+
+#endif // RENDER_GRAPH_H
@@ -0,0 +1,628 @@
+#include "./render_queue.h"
+
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/context.h"
+#include "../vulkan/buffers/uniform_ring.h"
+#include "../utils/heap.h"
+#include "../logger/logger.h"
+#include "./shaders/shader_manager.h"
+#include "./render_state.h"
+#include "./config.h"
+
+#define SORT_RADIX_BITS 8
+#define SORT_RADIX_SIZE (1 << SORT_RADIX_BITS)
+
+// the draw count sits in front of the indirect commands of a batch
+#define BATCH_COUNT_SIZE 16
+#define MAX_BATCH_INSTANCES 1024
+
+static void set_sort_key_bits(uint64_t *key, uint32_t shift, uint32_t bits, uint64_t value) {
+    uint64_t mask = ((UINT64_C(1) << bits) - 1) << shift;
+    *key = (*key & ~mask) | ((value << shift) & mask);
+}
+
+void init_draw_packet(draw_packet *packet) {
+    packet->sort_key = 0;
+    packet->pipeline = VK_NULL_HANDLE;
+    packet->pipeline_layout = VK_NULL_HANDLE;
+    packet->descriptor_set = VK_NULL_HANDLE;
+    packet->dynamic_offset = 0;
+    packet->dynamic_offsets_size = 0;
+    packet->push_constants_stages = 0;
+    packet->push_constants_range = 0;
+    packet->push_constants_in_ring = false;
+    packet->push_constants_offset = 0;
+    packet->depth_pipeline = VK_NULL_HANDLE;
+    packet->depth_pipeline_layout = VK_NULL_HANDLE;
+    packet->depth_descriptor_set = VK_NULL_HANDLE;
+    packet->depth_push_constants_stages = 0;
+    packet->draw_data_range = 0;
+    packet->instance_data_range = 0;
+    packet->instance_count = 0;
+    packet->instance_offset = 0;
+    packet->vertex_buffer = VK_NULL_HANDLE;
+    packet->vertex_offset = 0;
+    packet->index_buffer = VK_NULL_HANDLE;
+    packet->index_offset = 0;
+    packet->index_type = VK_INDEX_TYPE_UINT32;
+    packet->index_count = 0;
+    packet->first_index = 0;
+    packet->base_vertex = 0;
+    packet->bounds[0] = 0.0f;
+    packet->bounds[1] = 0.0f;
+    packet->bounds[2] = 0.0f;
+    packet->bounds[3] = -1.0f;
+    packet->data_size = 0;
+}
+
+bool set_program_draw_packet(draw_packet *packet, uint64_t state_bits) {
+    if (ren_pm.current_render_program == -1) {
+        log_error("Unable to set draw packet program - invalid render program index");
+        return false;
+    }
+    render_program *prog = &ren_pm.programs[ren_pm.current_render_program];
+
+    // blended draws and draws that do not write depth are left out of the pre-pass
+    const render_program *depth_prog = NULL;
+    if (render_config.depth_prepass && prog->depth_program != RENDER_PROGRAM_INSTANCE_UNDEFINED &&
+        (state_bits & (RST_SRCBLEND_BITS | RST_DSTBLEND_BITS | RST_DEPTHMASK)) == 0)
+    {
+        int index = find_render_program_instance_program_manager(&ren_pm, prog->depth_program);
+        depth_prog = index != -1 ? &ren_pm.programs[index] : NULL;
+    }
+
+    packet->depth_pipeline = VK_NULL_HANDLE;
+    packet->depth_pipeline_layout = VK_NULL_HANDLE;
+    packet->depth_descriptor_set = VK_NULL_HANDLE;
+    packet->depth_push_constants_stages = 0;
+    if (depth_prog) {
+        pipeline_state depth_ps;
+        if (!get_pipeline_render_program_instance(&depth_ps, depth_prog->instance,
+            state_bits | RST_COLORMASK | RST_ALPHAMASK, &ren_pm))
+        {
+            log_error("Unable to set draw packet program - could not create / get depth pipeline");
+            return false;
+        }
+        packet->depth_pipeline = depth_ps.pipeline;
+        packet->depth_pipeline_layout = depth_prog->pipeline_layout;
+        packet->depth_descriptor_set = depth_prog->uniform_descriptor_set;
+        packet->depth_push_constants_stages = depth_prog->push_constants_stages;
+        state_bits = (state_bits & ~RST_DEPTHFUNC_BITS) | RST_DEPTHFUNC_EQUAL | RST_DEPTHMASK;
+    }
+
+    pipeline_state ps;
+    if (!get_pipeline_render_program_instance(&ps, prog->instance, state_bits, &ren_pm)) {
+        log_error("Unable to set draw packet program - could not create / get pipeline");
+        return false;
+    }
+
+    uint32_t pipeline_index = 0;
+    for (size_t i = 0; i < prog->pipeline_cache_size; i++) {
+        if (prog->pipeline_cache[i].state_bits == state_bits) {
+            pipeline_index = i;
+            break;
+        }
+    }
+
+    set_sort_key_bits(&packet->sort_key, DRAW_SORT_KEY_PROGRAM_SHIFT, DRAW_SORT_KEY_PROGRAM_BITS,
+        ren_pm.current_render_program);
+    set_sort_key_bits(&packet->sort_key, DRAW_SORT_KEY_PIPELINE_SHIFT, DRAW_SORT_KEY_PIPELINE_BITS, pipeline_index);
+
+    packet->pipeline = ps.pipeline;
+    packet->pipeline_layout = prog->pipeline_layout;
+    packet->descriptor_set = prog->uniform_descriptor_set;
+    packet->dynamic_offsets_size = (prog->uniform_block_size > 0 ? 1 : 0) + (prog->draw_data_size > 0 ? 1 : 0) +
+        (prog->push_constants_in_ring ? 1 : 0);
+    packet->push_constants_stages = prog->push_constants_stages;
+    packet->push_constants_range = prog->push_constants_size;
+    packet->push_constants_in_ring = prog->push_constants_in_ring;
+    packet->draw_data_range = prog->draw_data_size;
+    packet->instance_data_range = prog->instance_data_size;
+
+    return true;
+}
+
+bool set_push_constants_draw_packet(draw_packet *packet, const void *data, size_t size) {
+    if (size > packet->push_constants_range || (size & 3) != 0 ||
+        (!packet->push_constants_in_ring && size > MAX_DRAW_PACKET_DATA_SIZE))
+    {
+        log_error("Push constants of %zu bytes do not fit the draw packet program", size);
+        return false;
+    }
+    if (packet->push_constants_in_ring) {
+        // the full block is reserved so the descriptor range never reaches past the ring
+        byte *dest = vk_alloc_uniform(packet->push_constants_range, &packet->push_constants_offset);
+        if (!dest) {
+            return false;
+        }
+        mem_copy(dest, data, size);
+        packet->data_size = 0;
+        return true;
+    }
+    mem_copy(packet->data, data, size);
+    packet->data_size = size;
+
+    return true;
+}
+
+bool set_draw_data_draw_packet(draw_packet *packet, const void *data, size_t size) {
+    if (size > packet->draw_data_range || size > MAX_DRAW_PACKET_DATA_SIZE) {
+        log_error("Draw data of %zu bytes does not fit the draw packet program", size);
+        return false;
+    }
+    mem_copy(packet->data, data, size);
+    packet->data_size = size;
+
+    return true;
+}
+
+bool set_instance_data_draw_packet(draw_packet *packet, const void *data, size_t size) {
+    if (size > packet->instance_data_range || size > MAX_DRAW_PACKET_DATA_SIZE) {
+        log_error("Instance data of %zu bytes does not fit the draw packet program", size);
+        return false;
+    }
+    mem_copy(packet->data, data, size);
+    packet->data_size = size;
+    packet->instance_count = 0;
+
+    return true;
+}
+
+bool set_instances_draw_packet(draw_packet *packet, const void *data, uint32_t instance_count) {
+    if (packet->instance_data_range == 0 || instance_count == 0) {
+        log_error("Unable to set %u instances, the draw packet program is not instanced", instance_count);
+        return false;
+    }
+
+    uint32_t offset = 0;
+    byte *dest = vk_alloc_uniform(packet->instance_data_range * instance_count, &offset);
+    if (!dest) {
+        return false;
+    }
+    mem_copy(dest, data, packet->instance_data_range * instance_count);
+    packet->instance_offset = get_buffer_offset(&uniform_ring.buffer) + offset;
+    packet->instance_count = instance_count;
+    packet->data_size = 0;
+
+    return true;
+}
+
+void set_static_mesh_draw_packet(draw_packet *packet, const static_mesh *mesh) {
+    set_sort_key_bits(&packet->sort_key, DRAW_SORT_KEY_MESH_SHIFT, DRAW_SORT_KEY_MESH_BITS,
+        mesh - vertex_cache.static_meshes);
+
+    // the whole static buffer stays bound, meshes are selected by their first index and base vertex
+    packet->vertex_buffer = vertex_cache.static_buffer.buffer;
+    packet->vertex_offset = 0;
+    packet->index_buffer = vertex_cache.static_buffer.buffer;
+    packet->index_offset = 0;
+    packet->index_type = mesh->index_type;
+    packet->index_count = mesh->index_count;
+    packet->first_index = mesh->first_index;
+    packet->base_vertex = mesh->base_vertex;
+    mem_copy(packet->bounds, mesh->bounds, sizeof(packet->bounds));
+}
+
+void set_material_draw_packet(draw_packet *packet, uint32_t material) {
+    set_sort_key_bits(&packet->sort_key, DRAW_SORT_KEY_MATERIAL_SHIFT, DRAW_SORT_KEY_MATERIAL_BITS, material);
+}
+
+void set_depth_draw_packet(draw_packet *packet, float depth) {
+    depth = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+    uint64_t max_depth = (UINT64_C(1) << DRAW_SORT_KEY_DEPTH_BITS) - 1;
+    set_sort_key_bits(&packet->sort_key, DRAW_SORT_KEY_DEPTH_SHIFT, DRAW_SORT_KEY_DEPTH_BITS,
+        (uint64_t) (depth * max_depth));
+}
+
+static void bind_draw_packet(const draw_packet *packet, uint32_t draw_data_offset, bool depth,
+    command_state *state)
+{
+    VkPipelineLayout pipeline_layout = depth ? packet->depth_pipeline_layout : packet->pipeline_layout;
+    const VkDescriptorSet *descriptor_set = depth ? &packet->depth_descriptor_set : &packet->descriptor_set;
+
+    bind_pipeline_command_state(state, VK_PIPELINE_BIND_POINT_GRAPHICS,
+        depth ? packet->depth_pipeline : packet->pipeline);
+    if (*descriptor_set) {
+        // the uniform block comes first, then the per-draw data block and the push constants in the ring
+        uint32_t dynamic_offsets[3];
+        uint32_t dynamic_offsets_size = 0;
+        uint32_t blocks = (packet->draw_data_range > 0 ? 1 : 0) + (packet->push_constants_in_ring ? 1 : 0);
+        if (packet->dynamic_offsets_size > blocks) {
+            dynamic_offsets[dynamic_offsets_size++] = packet->dynamic_offset;
+        }
+        if (packet->draw_data_range > 0) {
+            dynamic_offsets[dynamic_offsets_size++] = draw_data_offset;
+        }
+        if (packet->push_constants_in_ring) {
+            dynamic_offsets[dynamic_offsets_size++] = packet->push_constants_offset;
+        }
+        bind_descriptor_sets_command_state(state, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 1,
+            descriptor_set, dynamic_offsets_size, dynamic_offsets);
+    }
+    bind_vertex_buffers_command_state(state, 0, 1, &packet->vertex_buffer, &packet->vertex_offset);
+    bind_index_buffer_command_state(state, packet->index_buffer, packet->index_offset, packet->index_type);
+}
+
+static void record_direct_batch(const draw_batch *batch, bool depth, command_state *state) {
+    for (size_t i = 0; i < batch->packets_size; i++) {
+        const draw_packet *packet = &batch->packets[i];
+        if (depth && !packet->depth_pipeline) {
+            continue;
+        }
+
+        bind_draw_packet(packet, 0, depth, state);
+        if (packet->data_size > 0) {
+            push_constants_command_state(state, depth ? packet->depth_pipeline_layout : packet->pipeline_layout,
+                depth ? packet->depth_push_constants_stages : packet->push_constants_stages,
+                packet->data_size, packet->data);
+        }
+
+        draw_indexed_command_state(state, packet->index_count, 1, packet->first_index, packet->base_vertex, 0);
+    }
+}
+
+static bool has_draw_indirect_count() {
+    return context.draw_indirect_count && vkCmdDrawIndexedIndirectCountKHR;
+}
+
+// the packets of indirect and instanced batches share their programs, the first one stands for all of them
+static void record_indirect_batch(const draw_batch *batch, bool depth, command_state *state) {
+    if (depth && !batch->packets->depth_pipeline) {
+        return;
+    }
+    bind_draw_packet(batch->packets, batch->draw_data_offset, depth, state);
+
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (has_draw_indirect_count()) {
+        draw_indexed_indirect_count_command_state(state, batch->indirect_buffer, batch->commands_offset,
+            batch->indirect_buffer, batch->count_offset, batch->packets_size, stride);
+    } else if (context.enabled_features.multiDrawIndirect) {
+        draw_indexed_indirect_command_state(state, batch->indirect_buffer, batch->commands_offset,
+            batch->packets_size, stride);
+    } else {
+        for (uint32_t i = 0; i < batch->packets_size; i++) {
+            draw_indexed_indirect_command_state(state, batch->indirect_buffer, batch->commands_offset + i * stride,
+                1, stride);
+        }
+    }
+}
+
+static void record_instanced_batch(const draw_batch *batch, bool depth, command_state *state) {
+    const draw_packet *packet = batch->packets;
+    if (depth && !packet->depth_pipeline) {
+        return;
+    }
+
+    bind_draw_packet(packet, 0, depth, state);
+    bind_vertex_buffers_command_state(state, 1, 1, &uniform_ring.buffer.buffer, &batch->instance_offset);
+    draw_indexed_command_state(state, packet->index_count, batch->instance_count, packet->first_index,
+        packet->base_vertex, 0);
+}
+
+static void record_batches(const draw_batch *batches, size_t batches_size, bool depth, command_state *state) {
+    for (size_t i = 0; i < batches_size; i++) {
+        switch (batches[i].type) {
+            case DRAW_BATCH_DIRECT:
+                record_direct_batch(&batches[i], depth, state);
+                break;
+            case DRAW_BATCH_INDIRECT:
+                record_indirect_batch(&batches[i], depth, state);
+                break;
+            case DRAW_BATCH_INSTANCED:
+                record_instanced_batch(&batches[i], depth, state);
+                break;
+        }
+    }
+}
+
+void record_draw_batches(const draw_batch *batches, size_t batches_size, command_state *state) {
+    record_batches(batches, batches_size, false, state);
+}
+
+void record_depth_batches(const draw_batch *batches, size_t batches_size, command_state *state) {
+    record_batches(batches, batches_size, true, state);
+}
+
+void init_render_queue(render_queue *q) {
+    q->packets = NULL;
+    q->size = 0;
+    q->max_size = 0;
+    q->sorted_packets = NULL;
+    q->sort_keys = NULL;
+    q->sort_indices = NULL;
+    q->batches = NULL;
+    q->batches_size = 0;
+    q->cull_objects = 0;
+    q->cull_objects_size = 0;
+    q->cull_compact = false;
+}
+
+bool alloc_render_queue(render_queue *q, size_t max_size) {
+    if (max_size > UINT32_MAX) {
+        log_error("Render queue can hold at most %u packets", UINT32_MAX);
+        return false;
+    }
+
+    q->packets = mem_alloc(sizeof(draw_packet) * max_size);
+    CHECK_ALLOC(q->packets, "Unable to allocate render queue");
+    q->sorted_packets = mem_alloc(sizeof(draw_packet) * max_size);
+    CHECK_ALLOC(q->sorted_packets, "Unable to allocate render queue");
+
+    // two halves, the radix passes ping-pong between them
+    q->sort_keys = mem_alloc(sizeof(uint64_t) * max_size * 2);
+    CHECK_ALLOC(q->sort_keys, "Unable to allocate render queue sort keys");
+    q->sort_indices = mem_alloc(sizeof(uint32_t) * max_size * 2);
+    CHECK_ALLOC(q->sort_indices, "Unable to allocate render queue sort indices");
+    q->batches = mem_alloc(sizeof(draw_batch) * max_size);
+    CHECK_ALLOC(q->batches, "Unable to allocate render queue batches");
+
+    q->size = 0;
+    q->max_size = max_size;
+
+    return true;
+}
+
+bool add_render_queue(render_queue *q, const draw_packet *packet) {
+    if (q->size >= q->max_size) {
+        log_error("Render queue is full, max size: %zu", q->max_size);
+        return false;
+    }
+    q->packets[q->size++] = *packet;
+
+    return true;
+}
+
+void sort_render_queue(render_queue *q) {
+    if (q->size < 2) {
+        return;
+    }
+
+    uint64_t *keys = q->sort_keys;
+    uint32_t *indices = q->sort_indices;
+    uint64_t *keys_tmp = &q->sort_keys[q->max_size];
+    uint32_t *indices_tmp = &q->sort_indices[q->max_size];
+
+    uint64_t key_or = 0;
+    uint64_t key_and = UINT64_MAX;
+    bool sorted = true;
+    for (size_t i = 0; i < q->size; i++) {
+        keys[i] = q->packets[i].sort_key;
+        indices[i] = i;
+        key_or |= keys[i];
+        key_and &= keys[i];
+        sorted = sorted && (i == 0 || keys[i - 1] <= keys[i]);
+    }
+    if (sorted) {
+        return;
+    }
+
+    // least significant digit first, digits that are equal in every key are skipped
+    uint64_t varying_bits = key_or ^ key_and;
+    for (uint32_t shift = 0; shift < 64; shift += SORT_RADIX_BITS) {
+        if (((varying_bits >> shift) & (SORT_RADIX_SIZE - 1)) == 0) {
+            continue;
+        }
+
+        size_t offsets[SORT_RADIX_SIZE] = { 0 };
+        for (size_t i = 0; i < q->size; i++) {
+            offsets[(keys[i] >> shift) & (SORT_RADIX_SIZE - 1)]++;
+        }
+        size_t sum = 0;
+        for (size_t i = 0; i < SORT_RADIX_SIZE; i++) {
+            size_t count = offsets[i];
+            offsets[i] = sum;
+            sum += count;
+        }
+        for (size_t i = 0; i < q->size; i++) {
+            size_t dest = offsets[(keys[i] >> shift) & (SORT_RADIX_SIZE - 1)]++;
+            keys_tmp[dest] = keys[i];
+            indices_tmp[dest] = indices[i];
+        }
+
+        uint64_t *keys_swap = keys;
+        keys = keys_tmp;
+        keys_tmp = keys_swap;
+        uint32_t *indices_swap = indices;
+        indices = indices_tmp;
+        indices_tmp = indices_swap;
+    }
+
+    for (size_t i = 0; i < q->size; i++) {
+        q->sorted_packets[i] = q->packets[indices[i]];
+    }
+
+    draw_packet *packets = q->packets;
+    q->packets = q->sorted_packets;
+    q->sorted_packets = packets;
+}
+
+static bool is_batch_compatible(const draw_packet *a, const draw_packet *b) {
+    return a->pipeline == b->pipeline && a->depth_pipeline == b->depth_pipeline &&
+        a->descriptor_set == b->descriptor_set && a->dynamic_offset == b->dynamic_offset &&
+        a->push_constants_offset == b->push_constants_offset &&
+        a->vertex_buffer == b->vertex_buffer && a->vertex_offset == b->vertex_offset &&
+        a->index_buffer == b->index_buffer && a->index_offset == b->index_offset && a->index_type == b->index_type;
+}
+
+static byte* alloc_batch_commands(uint32_t draws, uint32_t *offset) {
+    return vk_alloc_uniform(BATCH_COUNT_SIZE + sizeof(VkDrawIndexedIndirectCommand) * draws, offset);
+}
+
+static void write_cull_objects(const draw_batch *batch, uint32_t commands_offset, uint32_t culled_offset,
+    uint32_t *objects)
+{
+    uint32_t draw_data_range = batch->packets[0].draw_data_range;
+    uint32_t command_words = sizeof(VkDrawIndexedIndirectCommand) / sizeof(uint32_t);
+    for (uint32_t i = 0; i < batch->packets_size; i++) {
+        uint32_t *object = &objects[i * CULL_OBJECT_WORDS];
+        mem_copy(object, batch->packets[i].bounds, 4 * sizeof(float));
+        object[4] = (batch->draw_data_offset + i * draw_data_range) / sizeof(uint32_t);
+        object[5] = (commands_offset + BATCH_COUNT_SIZE) / sizeof(uint32_t) + i * command_words;
+        object[6] = (culled_offset + BATCH_COUNT_SIZE) / sizeof(uint32_t);
+        object[7] = culled_offset / sizeof(uint32_t);
+    }
+}
+
+static bool is_same_mesh(const draw_packet *a, const draw_packet *b) {
+    return a->index_count == b->index_count && a->first_index == b->first_index && a->base_vertex == b->base_vertex;
+}
+
+static bool write_instanced_batch(draw_batch *batch) {
+    const draw_packet *first = batch->packets;
+    if (first->instance_count > 0) {
+        batch->instance_offset = first->instance_offset;
+        batch->instance_count = first->instance_count;
+        return true;
+    }
+
+    uint32_t range = first->instance_data_range;
+    uint32_t offset = 0;
+    byte *instances = vk_alloc_uniform(range * batch->packets_size, &offset);
+    if (!instances) {
+        return false;
+    }
+    for (uint32_t i = 0; i < batch->packets_size; i++) {
+        mem_copy(instances + i * range, batch->packets[i].data, batch->packets[i].data_size);
+    }
+    batch->instance_offset = get_buffer_offset(&uniform_ring.buffer) + offset;
+    batch->instance_count = batch->packets_size;
+
+    return true;
+}
+
+static bool is_batch_member(const draw_batch *batch, const draw_packet *packet) {
+    const draw_packet *first = batch->packets;
+    switch (batch->type) {
+        case DRAW_BATCH_INDIRECT:
+            return is_batch_compatible(first, packet);
+        case DRAW_BATCH_INSTANCED:
+            return first->instance_count == 0 && packet->instance_count == 0 &&
+                is_batch_compatible(first, packet) && is_same_mesh(first, packet);
+        default:
+            return packet->draw_data_range == 0 && packet->instance_data_range == 0;
+    }
+}
+
+static bool write_indirect_batch(draw_batch *batch, render_queue *q, uint32_t *cull_objects) {
+    uint32_t draw_data_range = batch->packets[0].draw_data_range;
+    byte *draw_data = vk_alloc_uniform(draw_data_range * batch->packets_size, &batch->draw_data_offset);
+    uint32_t commands_offset = 0;
+    byte *commands = alloc_batch_commands(batch->packets_size, &commands_offset);
+    if (!draw_data || !commands) {
+        return false;
+    }
+
+    *(uint32_t *) commands = batch->packets_size;
+    VkDrawIndexedIndirectCommand *command = (VkDrawIndexedIndirectCommand *) (commands + BATCH_COUNT_SIZE);
+    for (uint32_t i = 0; i < batch->packets_size; i++) {
+        const draw_packet *packet = &batch->packets[i];
+        // the first instance indexes the per-draw data in the shader
+        command[i].indexCount = packet->index_count;
+        command[i].instanceCount = 1;
+        command[i].firstIndex = packet->first_index;
+        command[i].vertexOffset = packet->base_vertex;
+        command[i].firstInstance = i;
+        mem_copy(draw_data + i * draw_data_range, packet->data, packet->data_size);
+    }
+
+    // culled batches draw from a second copy the culling pass fills from the first
+    uint32_t draw_offset = commands_offset;
+    if (cull_objects) {
+        byte *culled = alloc_batch_commands(batch->packets_size, &draw_offset);
+        if (!culled) {
+            return false;
+        }
+        *(uint32_t *) culled = q->cull_compact ? 0 : batch->packets_size;
+        write_cull_objects(batch, commands_offset, draw_offset,
+            &cull_objects[q->cull_objects_size * CULL_OBJECT_WORDS]);
+        q->cull_objects_size += batch->packets_size;
+    }
+
+    batch->indirect_buffer = uniform_ring.buffer.buffer;
+    batch->count_offset = get_buffer_offset(&uniform_ring.buffer) + draw_offset;
+    batch->commands_offset = batch->count_offset + BATCH_COUNT_SIZE;
+
+    return true;
+}
+
+bool build_batches_render_queue(render_queue *q, bool cull) {
+    // without a first instance the shader can not tell draws apart, every draw gets its own data block
+    uint32_t max_indirect_draws = context.enabled_features.drawIndirectFirstInstance ? MAX_INDIRECT_BATCH_DRAWS : 1;
+
+    // sized for every packet, only the indirect ones are filled
+    uint32_t *cull_objects = NULL;
+    q->cull_objects = 0;
+    q->cull_objects_size = 0;
+    q->cull_compact = cull && has_draw_indirect_count();
+    if (cull && q->size > 0) {
+        uint32_t cull_objects_offset = 0;
+        cull_objects = (uint32_t *) vk_alloc_uniform(q->size * CULL_OBJECT_WORDS * sizeof(uint32_t),
+            &cull_objects_offset);
+        if (!cull_objects) {
+            log_error("Unable to allocate culling inputs of the render queue");
+            return false;
+        }
+        q->cull_objects = cull_objects_offset / sizeof(uint32_t);
+    }
+
+    q->batches_size = 0;
+    size_t i = 0;
+    while (i < q->size) {
+        const draw_packet *first = &q->packets[i];
+        draw_batch *batch = &q->batches[q->batches_size++];
+        batch->packets = first;
+        batch->type = first->draw_data_range > 0 ? DRAW_BATCH_INDIRECT :
+            first->instance_data_range > 0 ? DRAW_BATCH_INSTANCED : DRAW_BATCH_DIRECT;
+        batch->instance_offset = 0;
+        batch->instance_count = 0;
+        batch->draw_data_offset = 0;
+        batch->indirect_buffer = VK_NULL_HANDLE;
+        batch->commands_offset = 0;
+        batch->count_offset = 0;
+
+        // direct runs are capped too so the record workers can split them
+        uint32_t max_draws = batch->type == DRAW_BATCH_INDIRECT ? max_indirect_draws :
+            batch->type == DRAW_BATCH_INSTANCED ? MAX_BATCH_INSTANCES : MAX_INDIRECT_BATCH_DRAWS;
+        size_t end = i + 1;
+        while (end < q->size && end - i < max_draws && is_batch_member(batch, &q->packets[end])) {
+            end++;
+        }
+        batch->packets_size = end - i;
+        i = end;
+
+        if (batch->type == DRAW_BATCH_INDIRECT && !write_indirect_batch(batch, q, cull_objects)) {
+            log_error("Unable to write indirect draws of the render queue");
+            return false;
+        }
+        if (batch->type == DRAW_BATCH_INSTANCED && !write_instanced_batch(batch)) {
+            log_error("Unable to write instances of the render queue");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void clear_render_queue(render_queue *q) {
+    q->size = 0;
+    q->batches_size = 0;
+}
+
+void destroy_render_queue(render_queue *q) {
+    if (q->packets) {
+        mem_free(q->packets);
+    }
+    if (q->sorted_packets) {
+        mem_free(q->sorted_packets);
+    }
+    if (q->sort_keys) {
+        mem_free(q->sort_keys);
+    }
+    if (q->sort_indices) {
+        mem_free(q->sort_indices);
+    }
+    if (q->batches) {
+        mem_free(q->batches);
+    }
+    init_render_queue(q);
+}
@@ -0,0 +1,143 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../vertex_management/vertex_manager.h"
+#include "./command_state.h"
+
+// the minimum maxPushConstantsSize every implementation has to support
+#define MAX_DRAW_PACKET_DATA_SIZE 128
+
+// local sphere, draw data, source command, destination commands and draw count, see cull.comp
+#define CULL_OBJECT_WORDS 8
+
+// sort key layout, most significant field first:
+// program (6) | pipeline (6) | material (12) | mesh (10) | depth (30)
+#define DRAW_SORT_KEY_DEPTH_SHIFT    0
+#define DRAW_SORT_KEY_DEPTH_BITS     30
+#define DRAW_SORT_KEY_MESH_SHIFT     30
+#define DRAW_SORT_KEY_MESH_BITS      10
+#define DRAW_SORT_KEY_MATERIAL_SHIFT 40
+#define DRAW_SORT_KEY_MATERIAL_BITS  12
+#define DRAW_SORT_KEY_PIPELINE_SHIFT 52
+#define DRAW_SORT_KEY_PIPELINE_BITS  6
+#define DRAW_SORT_KEY_PROGRAM_SHIFT  58
+#define DRAW_SORT_KEY_PROGRAM_BITS   6
+
+// everything is resolved on the submitting thread so recording only reads the packet
+typedef struct draw_packet {
+    uint64_t sort_key;
+
+    VkPipeline pipeline;
+    VkPipelineLayout pipeline_layout;
+
+    VkDescriptorSet descriptor_set;
+    uint32_t dynamic_offset;
+    uint32_t dynamic_offsets_size;
+
+    VkShaderStageFlags push_constants_stages;
+    uint32_t push_constants_range;
+    // push constants too large for the device are already in the uniform ring, bound after the draw data block
+    bool push_constants_in_ring;
+    uint32_t push_constants_offset;
+    // the depth program drawn by the depth pre-pass, null when the packet is drawn in a single pass
+    VkPipeline depth_pipeline;
+    VkPipelineLayout depth_pipeline_layout;
+    VkDescriptorSet depth_descriptor_set;
+    VkShaderStageFlags depth_push_constants_stages;
+    // programs with per-draw data are drawn indirectly in batches
+    uint32_t draw_data_range;
+    // programs with per-instance attributes merge draws of the same mesh into one instanced draw
+    uint32_t instance_data_range;
+    // instances already in the uniform ring, such packets are never merged
+    uint32_t instance_count;
+    VkDeviceSize instance_offset;
+
+    VkBuffer vertex_buffer;
+    VkDeviceSize vertex_offset;
+    VkBuffer index_buffer;
+    VkDeviceSize index_offset;
+    VkIndexType index_type;
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    // local space center and radius, a negative radius is never culled
+    float bounds[4];
+
+    // push constants, or the per-draw data of indirect and instanced programs
+    uint32_t data_size;
+    unsigned char data[MAX_DRAW_PACKET_DATA_SIZE];
+} draw_packet;
+
+typedef enum draw_batch_type {
+    DRAW_BATCH_DIRECT,
+    DRAW_BATCH_INDIRECT,
+    DRAW_BATCH_INSTANCED
+} draw_batch_type;
+
+// consecutive packets recorded together, indirect and instanced batches share all state but the per-draw data
+typedef struct draw_batch {
+    const draw_packet *packets;
+    uint32_t packets_size;
+    draw_batch_type type;
+
+    VkDeviceSize instance_offset;
+    uint32_t instance_count;
+
+    uint32_t draw_data_offset;
+    VkBuffer indirect_buffer;
+    VkDeviceSize commands_offset;
+    VkDeviceSize count_offset;
+} draw_batch;
+
+typedef struct render_queue {
+    draw_packet *packets;
+    size_t size;
+    size_t max_size;
+
+    draw_packet *sorted_packets;
+    uint64_t *sort_keys;
+    uint32_t *sort_indices;
+
+    draw_batch *batches;
+    size_t batches_size;
+
+    // per-draw inputs of the culling pass, in words from the start of the uniform ring
+    uint32_t cull_objects;
+    uint32_t cull_objects_size;
+    // culled draws are removed from the commands instead of drawn with no instances
+    bool cull_compact;
+} render_queue;
+
+void init_draw_packet(draw_packet *packet);
+// with render_config.depth_prepass, opaque packets of programs with a depth program are drawn with depth tested
+// for equality and not written, after their depth program laid it down
+bool set_program_draw_packet(draw_packet *packet, uint64_t state_bits);
+bool set_push_constants_draw_packet(draw_packet *packet, const void *data, size_t size);
+bool set_draw_data_draw_packet(draw_packet *packet, const void *data, size_t size);
+// a single instance, merged with the packets of the same mesh when the batches are built
+bool set_instance_data_draw_packet(draw_packet *packet, const void *data, size_t size);
+// copies every instance to the uniform ring right away, data holds one program instance block per instance
+bool set_instances_draw_packet(draw_packet *packet, const void *data, uint32_t instance_count);
+void set_static_mesh_draw_packet(draw_packet *packet, const static_mesh *mesh);
+void set_material_draw_packet(draw_packet *packet, uint32_t material);
+// depth is normalized to [0, 1], nearer draws sort first
+void set_depth_draw_packet(draw_packet *packet, float depth);
+void record_draw_batches(const draw_batch *batches, size_t batches_size, command_state *state);
+// the depth pre-pass, recorded before the draws of the same batches in the same subpass
+void record_depth_batches(const draw_batch *batches, size_t batches_size, command_state *state);
+
+void init_render_queue(render_queue *q);
+bool alloc_render_queue(render_queue *q, size_t max_size);
+bool add_render_queue(render_queue *q, const draw_packet *packet);
+void sort_render_queue(render_queue *q);
+// writes the indirect commands, per-draw data and instances of every batch to the uniform ring, culled batches draw
+// from commands written by the culling pass, which reads the model matrix from the start of the draw data
+bool build_batches_render_queue(render_queue *q, bool cull);
+void clear_render_queue(render_queue *q);
+void destroy_render_queue(render_queue *q);
+
+#endif // RENDER_QUEUE_H
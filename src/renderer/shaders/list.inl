@@ -9,6 +9,47 @@
         .instance = SHADER_INSTANCE_LAMBERT_DIFFUSE,         \
         .name = "diffuse", .directory = "basic",             \
         .type_bits = SHADER_TYPE_GROUP_GRAPHICS              \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_LAMBERT_DIFFUSE_INDIRECT,\
+        .name = "diffuse_indirect", .directory = "basic",    \
+        .type_bits = SHADER_TYPE_VERTEX                      \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_LAMBERT_DIFFUSE_INSTANCED,\
+        .name = "diffuse_instanced", .directory = "basic",   \
+        .type_bits = SHADER_TYPE_VERTEX                      \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_CULL,                    \
+        .name = "cull", .directory = "basic",                \
+        .type_bits = SHADER_TYPE_COMPUTE                     \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_CULL_BINDLESS,           \
+        .name = "cull_bindless", .directory = "basic",       \
+        .type_bits = SHADER_TYPE_COMPUTE,                    \
+        .bindless = true                                     \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_HIZ,                     \
+        .name = "hiz", .directory = "basic",                 \
+        .type_bits = SHADER_TYPE_COMPUTE                     \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_DEPTH,                   \
+        .name = "depth", .directory = "basic",               \
+        .type_bits = SHADER_TYPE_VERTEX                      \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_DEPTH_INDIRECT,          \
+        .name = "depth_indirect", .directory = "basic",      \
+        .type_bits = SHADER_TYPE_VERTEX                      \
+    },                                                       \
+    {                                                        \
+        .instance = SHADER_INSTANCE_DEPTH_INSTANCED,         \
+        .name = "depth_instanced", .directory = "basic",     \
+        .type_bits = SHADER_TYPE_VERTEX                      \
     }                                                        \
 }
 #endif // SHADER_LIST
@@ -27,6 +68,7 @@
             comp: SHADER_INSTANCE_UNDEFINED                  \
         },                                                   \
         .vertex_layout = VERTEX_LAYOUT_NO_VERTICES,          \
+        .depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED,  \
         .preconfigured_pipelines = {                         \
             1, RST_BASIC_3D                                  \
         }                                                    \
@@ -42,10 +84,168 @@
             tese: SHADER_INSTANCE_UNDEFINED,                 \
             comp: SHADER_INSTANCE_UNDEFINED                  \
         },                                                   \
-        .vertex_layout = VERTEX_LAYOUT_POS_NOR_UV_3,         \
+        .vertex_layout = VERTEX_LAYOUT_POS16_NOR_UV_PACKED,  \
+        .uniform_block_size = 16 * sizeof(float),            \
+        .push_constants_size = 16 * sizeof(float),           \
+        .depth_program = RENDER_PROGRAM_INSTANCE_DEPTH,      \
+        .preconfigured_pipelines = {                         \
+            1, RST_BASIC_3D                                  \
+        }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "diffuse_indirect",                          \
+        .instance = RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INDIRECT, \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_LAMBERT_DIFFUSE_INDIRECT,  \
+            frag: SHADER_INSTANCE_LAMBERT_DIFFUSE,           \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_UNDEFINED                  \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_POS16_NOR_UV_PACKED,  \
+        .uniform_block_size = 16 * sizeof(float),            \
+        .draw_data_size = 20 * sizeof(float),                \
+        .depth_program = RENDER_PROGRAM_INSTANCE_DEPTH_INDIRECT, \
         .preconfigured_pipelines = {                         \
             1, RST_BASIC_3D                                  \
         }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "diffuse_instanced",                         \
+        .instance = RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INSTANCED, \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_LAMBERT_DIFFUSE_INSTANCED, \
+            frag: SHADER_INSTANCE_LAMBERT_DIFFUSE,           \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_UNDEFINED                  \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_POS16_NOR_UV_PACKED_INSTANCED, \
+        .uniform_block_size = 16 * sizeof(float),            \
+        .instance_data_size = 20 * sizeof(float),            \
+        .depth_program = RENDER_PROGRAM_INSTANCE_DEPTH_INSTANCED, \
+        .preconfigured_pipelines = {                         \
+            1, RST_BASIC_3D                                  \
+        }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "cull",                                      \
+        .instance = RENDER_PROGRAM_INSTANCE_CULL,            \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_UNDEFINED,                 \
+            frag: SHADER_INSTANCE_UNDEFINED,                 \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_CULL                       \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_NO_VERTICES,          \
+        .uniform_block_size = 64 * sizeof(float),            \
+        .storage_ring = true,                                \
+        .sampled_images = 1,                                 \
+        .depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED,  \
+        .preconfigured_pipelines = {                         \
+            1, RST_DEFAULT                                   \
+        }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "cull_bindless",                             \
+        .instance = RENDER_PROGRAM_INSTANCE_CULL_BINDLESS,   \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_UNDEFINED,                 \
+            frag: SHADER_INSTANCE_UNDEFINED,                 \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_CULL_BINDLESS              \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_NO_VERTICES,          \
+        .uniform_block_size = 64 * sizeof(float),            \
+        .storage_ring = true,                                \
+        .bindless = true,                                    \
+        .depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED,  \
+        .preconfigured_pipelines = {                         \
+            1, RST_DEFAULT                                   \
+        }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "hiz",                                       \
+        .instance = RENDER_PROGRAM_INSTANCE_HIZ,             \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_UNDEFINED,                 \
+            frag: SHADER_INSTANCE_UNDEFINED,                 \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_HIZ                        \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_NO_VERTICES,          \
+        .push_constants_size = 4 * sizeof(int32_t),          \
+        .sampled_images = 1,                                 \
+        .storage_images = 1,                                 \
+        .depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED,  \
+        .preconfigured_pipelines = {                         \
+            1, RST_DEFAULT                                   \
+        }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "depth",                                     \
+        .instance = RENDER_PROGRAM_INSTANCE_DEPTH,           \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_DEPTH,                     \
+            frag: SHADER_INSTANCE_UNDEFINED,                 \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_UNDEFINED                  \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_POS_PACKED,           \
+        .uniform_block_size = 16 * sizeof(float),            \
+        .push_constants_size = 16 * sizeof(float),           \
+        .depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED,  \
+        .preconfigured_pipelines = {                         \
+            1, RST_BASIC_3D | RST_COLORMASK | RST_ALPHAMASK  \
+        }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "depth_indirect",                            \
+        .instance = RENDER_PROGRAM_INSTANCE_DEPTH_INDIRECT,  \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_DEPTH_INDIRECT,            \
+            frag: SHADER_INSTANCE_UNDEFINED,                 \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_UNDEFINED                  \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_POS_PACKED,           \
+        .uniform_block_size = 16 * sizeof(float),            \
+        .draw_data_size = 20 * sizeof(float),                \
+        .depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED,  \
+        .preconfigured_pipelines = {                         \
+            1, RST_BASIC_3D | RST_COLORMASK | RST_ALPHAMASK  \
+        }                                                    \
+    },                                                       \
+    {                                                        \
+        .name = "depth_instanced",                           \
+        .instance = RENDER_PROGRAM_INSTANCE_DEPTH_INSTANCED, \
+        .shader_instances = {                                \
+            vert: SHADER_INSTANCE_DEPTH_INSTANCED,           \
+            frag: SHADER_INSTANCE_UNDEFINED,                 \
+            geom: SHADER_INSTANCE_UNDEFINED,                 \
+            tesc: SHADER_INSTANCE_UNDEFINED,                 \
+            tese: SHADER_INSTANCE_UNDEFINED,                 \
+            comp: SHADER_INSTANCE_UNDEFINED                  \
+        },                                                   \
+        .vertex_layout = VERTEX_LAYOUT_POS_PACKED_INSTANCED, \
+        .uniform_block_size = 16 * sizeof(float),            \
+        .instance_data_size = 20 * sizeof(float),            \
+        .depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED,  \
+        .preconfigured_pipelines = {                         \
+            1, RST_BASIC_3D | RST_COLORMASK | RST_ALPHAMASK  \
+        }                                                    \
     }                                                        \
 }
 #endif // RENDER_PROGRAM_LIST
@@ -29,6 +29,14 @@ typedef enum shader_instance_type {
     SHADER_INSTANCE_UNDEFINED = -1,
     SHADER_INSTANCE_TEST,
     SHADER_INSTANCE_LAMBERT_DIFFUSE,
+    SHADER_INSTANCE_LAMBERT_DIFFUSE_INDIRECT,
+    SHADER_INSTANCE_LAMBERT_DIFFUSE_INSTANCED,
+    SHADER_INSTANCE_CULL,
+    SHADER_INSTANCE_CULL_BINDLESS,
+    SHADER_INSTANCE_HIZ,
+    SHADER_INSTANCE_DEPTH,
+    SHADER_INSTANCE_DEPTH_INDIRECT,
+    SHADER_INSTANCE_DEPTH_INSTANCED,
     SHADER_INSTANCES_TOTAL
 } shader_instance_type;
 
@@ -37,6 +45,8 @@ typedef struct shader_config {
     char *name;
     char *directory;
     uint32_t type_bits;
+    // declares the bindless table, only loaded when the device has descriptor indexing
+    bool bindless;
 } shader_config;
 
 typedef enum render_param {
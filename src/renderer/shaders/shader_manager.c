@@ -1,12 +1,16 @@
 #include "./shader_manager.h"
 
 #include "../../logger/logger.h"
+#include "../../profiler/cpu_profiler.h"
 #include "../../string/string.h"
 #include "../../utils/heap.h"
 #include "../../vulkan/gpu_info.h"
 #include "../../vulkan/context.h"
 #include "../../vulkan/tools/tools.h"
 #include "../../vulkan/functions/functions.h"
+#include "../../vulkan/buffers/uniform_ring.h"
+#include "../../vulkan/descriptors/bindless.h"
+#include "../../vertex_management/vertex_packing.h"
 #include "../config.h"
 #include "../render_state.h"
 #include "./list.inl"
@@ -64,6 +68,9 @@ static bool init_shaders(render_program_manager *m) {
     bool success = true;
     for (size_t i = 0; i < n && success; i++) {
         const shader_config *sc = &shader_list[i];
+        if (sc->bindless && !context.bindless) {
+            continue;
+        }
         char shader_path[MAX_PATH_LENGTH];
         for (size_t j = 0; j < shader_types_size && success; j++) {
             if (sc->type_bits & shader_types[j]) {
@@ -85,6 +92,51 @@ static bool create_descriptor_set_layout(render_program_manager *m, render_progr
     };
 
     uint32_t bindings_count = 0;
+    if (prog->uniform_block_size > 0) {
+        VkDescriptorSetLayoutBinding binding = {
+            .binding = bindings_count,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .descriptorCount = 1,
+            .stageFlags = get_shader_stages_render_program(prog),
+            .pImmutableSamplers = NULL
+        };
+        layout_bindings[bindings_count] = binding;
+        bindings_count++;
+    }
+    if (prog->draw_data_size > 0) {
+        VkDescriptorSetLayoutBinding binding = {
+            .binding = bindings_count,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+            .descriptorCount = 1,
+            .stageFlags = get_shader_stages_render_program(prog),
+            .pImmutableSamplers = NULL
+        };
+        layout_bindings[bindings_count] = binding;
+        bindings_count++;
+    }
+    if (prog->push_constants_in_ring) {
+        VkDescriptorSetLayoutBinding binding = {
+            .binding = bindings_count,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .descriptorCount = 1,
+            .stageFlags = prog->push_constants_stages,
+            .pImmutableSamplers = NULL
+        };
+        layout_bindings[bindings_count] = binding;
+        bindings_count++;
+    }
+    if (prog->storage_ring) {
+        VkDescriptorSetLayoutBinding binding = {
+            .binding = bindings_count,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = get_shader_stages_render_program(prog),
+            .pImmutableSamplers = NULL
+        };
+        layout_bindings[bindings_count] = binding;
+        bindings_count++;
+    }
+
     for (size_t i = 0; i < SHADER_TYPES_COUNT; i++) {
         int index = shader_array[i].index;
         shader_type type = shader_array[i].type;
@@ -93,7 +145,7 @@ static bool create_descriptor_set_layout(render_program_manager *m, render_progr
             continue;
 
         shader *shader = &m->shaders[index];
-        for (size_t j = 0; j < shader->bindings_size; i++) {
+        for (size_t j = 0; j < shader->bindings_size; j++) {
             VkDescriptorSetLayoutBinding binding = {
                 .binding = bindings_count,
                 .descriptorType = get_descriptor_type(shader->bindings[j]),
@@ -118,21 +170,220 @@ static bool create_descriptor_set_layout(render_program_manager *m, render_progr
     return true;
 }
 
+static bool create_image_descriptor_set_layout(render_program *prog) {
+    uint32_t bindings_count = prog->sampled_images + prog->storage_images;
+    if (prog->bindless) {
+        if (bindings_count > 0) {
+            log_error("Render program %s takes images through the bindless table only", prog->name);
+            return false;
+        }
+        return true;
+    }
+    if (bindings_count == 0) {
+        return true;
+    }
+    if (bindings_count > MAX_PROGRAM_IMAGES) {
+        log_error("Render program %s uses too many images: %u > %d", prog->name, bindings_count, MAX_PROGRAM_IMAGES);
+        return false;
+    }
+
+    VkDescriptorSetLayoutBinding layout_bindings[MAX_PROGRAM_IMAGES];
+    for (uint32_t i = 0; i < bindings_count; i++) {
+        VkDescriptorSetLayoutBinding binding = {
+            .binding = i,
+            .descriptorType = i < prog->sampled_images ?
+                VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 1,
+            .stageFlags = get_shader_stages_render_program(prog),
+            .pImmutableSamplers = NULL
+        };
+        layout_bindings[i] = binding;
+    }
+
+    VkDescriptorSetLayoutCreateInfo descriptor_set_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .bindingCount = bindings_count,
+        .pBindings = layout_bindings
+    };
+    CHECK_VK(vkCreateDescriptorSetLayout(context.device, &descriptor_set_info, NULL,
+        &prog->image_descriptor_set_layout));
+
+    return true;
+}
+
 static bool create_pipeline_layout(render_program *prog) {
+    bool push_constants = prog->push_constants_size > 0 && !prog->push_constants_in_ring;
+    VkPushConstantRange push_constant_range = {
+        .stageFlags = prog->push_constants_stages,
+        .offset = 0,
+        .size = prog->push_constants_size
+    };
+
+    VkDescriptorSetLayout set_layouts[2] = { prog->descriptor_set_layout,
+        prog->bindless ? bindless_descriptors.layout : prog->image_descriptor_set_layout };
+
     VkPipelineLayoutCreateInfo pipeline_layout_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .setLayoutCount = 1,
-        .pSetLayouts = &prog->descriptor_set_layout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = NULL
+        .setLayoutCount = set_layouts[1] ? 2 : 1,
+        .pSetLayouts = set_layouts,
+        .pushConstantRangeCount = push_constants ? 1 : 0,
+        .pPushConstantRanges = push_constants ? &push_constant_range : NULL
     };
     CHECK_VK(vkCreatePipelineLayout(context.device, &pipeline_layout_info, NULL, &prog->pipeline_layout));
 
     return true;
 }
 
+static bool create_uniform_descriptor_set(render_program_manager *m, render_program *prog) {
+    if (prog->uniform_block_size == 0 && prog->draw_data_size == 0 && !prog->push_constants_in_ring &&
+        !prog->storage_ring)
+    {
+        return true;
+    }
+
+    const gpu_info *gpu = &context.gpus[context.selected_gpu];
+    if (prog->uniform_block_size > gpu->props.limits.maxUniformBufferRange ||
+        prog->uniform_block_size > UNIFORM_RING_TAIL_SIZE)
+    {
+        log_error("Uniform block of render program %s is too large: %u > %u", prog->name, prog->uniform_block_size,
+            gpu->props.limits.maxUniformBufferRange);
+        return false;
+    }
+    if (prog->push_constants_in_ring && (prog->push_constants_size > gpu->props.limits.maxUniformBufferRange ||
+        prog->push_constants_size > UNIFORM_RING_TAIL_SIZE))
+    {
+        log_error("Push constants of render program %s are too large for the uniform ring: %u", prog->name,
+            prog->push_constants_size);
+        return false;
+    }
+    uint32_t draw_data_range = prog->draw_data_size * MAX_INDIRECT_BATCH_DRAWS;
+    if (draw_data_range > gpu->props.limits.maxStorageBufferRange || draw_data_range > UNIFORM_RING_TAIL_SIZE) {
+        log_error("Draw data of render program %s is too large: %u bytes per draw", prog->name,
+            prog->draw_data_size);
+        return false;
+    }
+    VkDeviceSize ring_range = uniform_ring.frame_size * context.frames_in_flight;
+    if (prog->storage_ring && ring_range > gpu->props.limits.maxStorageBufferRange) {
+        log_error("Uniform ring of %llu bytes can not be bound as storage by render program %s",
+            (unsigned long long) ring_range, prog->name);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = NULL,
+        .descriptorPool = m->program_descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &prog->descriptor_set_layout
+    };
+    CHECK_VK(vkAllocateDescriptorSets(context.device, &alloc_info, &prog->uniform_descriptor_set));
+
+    VkDescriptorBufferInfo buffer_infos[4];
+    VkWriteDescriptorSet writes[4];
+    uint32_t writes_size = 0;
+
+    if (prog->uniform_block_size > 0) {
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = uniform_ring.buffer.buffer,
+            .offset = get_buffer_offset(&uniform_ring.buffer),
+            .range = prog->uniform_block_size
+        };
+        buffer_infos[writes_size] = buffer_info;
+
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = NULL,
+            .dstSet = prog->uniform_descriptor_set,
+            .dstBinding = writes_size,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .pImageInfo = NULL,
+            .pBufferInfo = &buffer_infos[writes_size],
+            .pTexelBufferView = NULL
+        };
+        writes[writes_size++] = write;
+    }
+
+    if (prog->draw_data_size > 0) {
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = uniform_ring.buffer.buffer,
+            .offset = get_buffer_offset(&uniform_ring.buffer),
+            .range = draw_data_range
+        };
+        buffer_infos[writes_size] = buffer_info;
+
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = NULL,
+            .dstSet = prog->uniform_descriptor_set,
+            .dstBinding = writes_size,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+            .pImageInfo = NULL,
+            .pBufferInfo = &buffer_infos[writes_size],
+            .pTexelBufferView = NULL
+        };
+        writes[writes_size++] = write;
+    }
+
+    if (prog->push_constants_in_ring) {
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = uniform_ring.buffer.buffer,
+            .offset = get_buffer_offset(&uniform_ring.buffer),
+            .range = prog->push_constants_size
+        };
+        buffer_infos[writes_size] = buffer_info;
+
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = NULL,
+            .dstSet = prog->uniform_descriptor_set,
+            .dstBinding = writes_size,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .pImageInfo = NULL,
+            .pBufferInfo = &buffer_infos[writes_size],
+            .pTexelBufferView = NULL
+        };
+        writes[writes_size++] = write;
+    }
+
+    // addressed with the dynamic offsets handed out by the ring, so it starts at the ring and has none of its own
+    if (prog->storage_ring) {
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = uniform_ring.buffer.buffer,
+            .offset = get_buffer_offset(&uniform_ring.buffer),
+            .range = ring_range
+        };
+        buffer_infos[writes_size] = buffer_info;
+
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = NULL,
+            .dstSet = prog->uniform_descriptor_set,
+            .dstBinding = writes_size,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pImageInfo = NULL,
+            .pBufferInfo = &buffer_infos[writes_size],
+            .pTexelBufferView = NULL
+        };
+        writes[writes_size++] = write;
+    }
+
+    vkUpdateDescriptorSets(context.device, writes_size, writes, 0, NULL);
+
+    return true;
+}
+
 static bool create_pipeline(VkPipeline *pipeline, uint64_t state_bits, render_program_manager *m, render_program *prog) {
     vertex_layout *layout = &vertex_layouts[prog->vertex_layout];
 
@@ -258,6 +509,39 @@ static bool create_pipeline(VkPipeline *pipeline, uint64_t state_bits, render_pr
     return true;
 }
 
+static bool create_compute_pipeline(VkPipeline *pipeline, render_program_manager *m, render_program *prog) {
+    shader *s = &m->shaders[prog->shader_indices.comp];
+
+    VkPipelineShaderStageCreateInfo shader_stage_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+        .module = s->module,
+        .pName = "main",
+        .pSpecializationInfo = NULL
+    };
+
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .stage = shader_stage_info,
+        .layout = prog->pipeline_layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = 0
+    };
+
+    *pipeline = VK_NULL_HANDLE;
+    CHECK_VK(vkCreateComputePipelines(context.device, context.pipeline_cache, 1, &pipeline_info, NULL, pipeline));
+
+    return true;
+}
+
+static VkPipelineBindPoint get_bind_point_render_program(const render_program *prog) {
+    return prog->shader_indices.comp == -1 ? VK_PIPELINE_BIND_POINT_GRAPHICS : VK_PIPELINE_BIND_POINT_COMPUTE;
+}
+
 static bool get_pipeline_render_program(pipeline_state *dest, render_program *prog, uint64_t state_bits,
     render_program_manager *m)
 {
@@ -270,8 +554,11 @@ static bool get_pipeline_render_program(pipeline_state *dest, render_program *pr
         }
     }
 
+    // compute pipelines have no fixed function state, the bits only key the cache
     VkPipeline pipeline = VK_NULL_HANDLE;
-    bool success = create_pipeline(&pipeline, state_bits, m, prog);
+    bool success = prog->shader_indices.comp != -1 ?
+        create_compute_pipeline(&pipeline, m, prog) :
+        create_pipeline(&pipeline, state_bits, m, prog);
     if (!success) {
         log_error("Unable to create pipeline for render program %s", prog->name);
         return false;
@@ -312,7 +599,11 @@ bool get_pipeline_render_program_instance(pipeline_state *dest, render_program_i
     }
     render_program *prog = &m->programs[index];
 
-    return get_pipeline_render_program(dest, prog, state_bits, m);
+    begin_cpu_zone("pipeline_lookup");
+    bool success = get_pipeline_render_program(dest, prog, state_bits, m);
+    end_cpu_zone();
+
+    return success;
 }
 
 static bool init_render_program_from_config(render_program *prog, const render_program_config *rp_conf,
@@ -336,10 +627,29 @@ static bool init_render_program_from_config(render_program *prog, const render_p
         find_shader_instance_program_manager(m, rp_conf->shader_instances.comp, SHADER_TYPE_COMPUTE) : -1;
 
     prog->vertex_layout = rp_conf->vertex_layout;
+    prog->uniform_block_size = rp_conf->uniform_block_size;
+    prog->push_constants_size = ALIGN(rp_conf->push_constants_size, 4);
+    prog->push_constants_stages = get_shader_stages_render_program(prog);
+    // the range has to match the shader's block, a smaller one would make the layout invalid for it
+    uint32_t max_push_constants_size = context.gpus[context.selected_gpu].props.limits.maxPushConstantsSize;
+    prog->push_constants_in_ring = prog->push_constants_size > max_push_constants_size;
+    if (prog->push_constants_in_ring) {
+        log_warning("Push constants of render program %s do not fit (%u > %u), they go through the uniform ring",
+            rp_conf->name, prog->push_constants_size, max_push_constants_size);
+    }
+    prog->draw_data_size = rp_conf->draw_data_size;
+    prog->instance_data_size = rp_conf->instance_data_size;
+    prog->storage_ring = rp_conf->storage_ring;
+    prog->sampled_images = rp_conf->sampled_images;
+    prog->storage_images = rp_conf->storage_images;
+    prog->bindless = rp_conf->bindless;
+    prog->depth_program = rp_conf->depth_program;
 
     bool success = string_copy(prog->name, MAX_SHADER_NAME_SIZE, rp_conf->name) &&
         create_descriptor_set_layout(m, prog) &&
-        create_pipeline_layout(prog);
+        create_image_descriptor_set_layout(prog) &&
+        create_pipeline_layout(prog) &&
+        create_uniform_descriptor_set(m, prog);
 
     pipeline_state tmp;
     for (size_t i = 1; i < rp_conf->preconfigured_pipelines[0] && success; i++) {
@@ -368,6 +678,31 @@ static bool add_program_to_render_program_manager(render_program_manager *m, con
     return true;
 }
 
+// the packet of a program is drawn with its depth program as it is, both have to take the same inputs
+static bool check_depth_program(render_program_manager *m, const render_program *prog) {
+    if (prog->depth_program == RENDER_PROGRAM_INSTANCE_UNDEFINED) {
+        return true;
+    }
+    int index = find_render_program_instance_program_manager(m, prog->depth_program);
+    if (index == -1) {
+        log_error("Depth program of render program %s not found", prog->name);
+        return false;
+    }
+
+    const render_program *depth = &m->programs[index];
+    if (depth->shader_indices.frag != -1 || depth->depth_program != RENDER_PROGRAM_INSTANCE_UNDEFINED ||
+        depth->uniform_block_size != prog->uniform_block_size ||
+        depth->push_constants_size != prog->push_constants_size ||
+        depth->draw_data_size != prog->draw_data_size ||
+        depth->instance_data_size != prog->instance_data_size)
+    {
+        log_error("Render program %s does not match the inputs of %s", depth->name, prog->name);
+        return false;
+    }
+
+    return true;
+}
+
 static bool init_render_programs(render_program_manager *m) {
     m->programs_size = 0;
     m->programs = mem_alloc(MAX_RENDER_PROGRAMS * sizeof(render_program));
@@ -381,8 +716,15 @@ static bool init_render_programs(render_program_manager *m) {
 
     bool success = true;
     for (size_t i = 0; i < n && success; i++) {
+        // without the table the pass uses the program it is a variant of
+        if (render_program_list[i].bindless && !context.bindless) {
+            continue;
+        }
         success &= add_program_to_render_program_manager(m, &render_program_list[i]);
     }
+    for (size_t i = 0; i < m->programs_size && success; i++) {
+        success &= check_depth_program(m, &m->programs[i]);
+    }
 
     return success;
 }
@@ -452,21 +794,85 @@ static bool create_vertex_descriptions() {
         layout->attribute_desc[2].offset = 3 * sizeof(float) + 3 * sizeof(float);
     }
 
+    {
+        vertex_layout *layout = &vertex_layouts[VERTEX_LAYOUT_POS16_NOR_UV_PACKED];
+        layout->input_state = vertex_input_info;
+        layout->binding_desc_size = 1;
+        layout->binding_desc[0].binding = 0;
+        layout->binding_desc[0].stride = sizeof(packed_vertex_pos16);
+        layout->binding_desc[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        layout->attribute_desc_size = 3;
+        // position, multiplied by the mesh position scale in the shader
+        layout->attribute_desc[0].location = 0;
+        layout->attribute_desc[0].binding = layout->binding_desc[0].binding,
+        layout->attribute_desc[0].format = vertex_packing.position16,
+        layout->attribute_desc[0].offset = offsetof(packed_vertex_pos16, position);
+        // normal
+        layout->attribute_desc[1].location = 1;
+        layout->attribute_desc[1].binding = layout->binding_desc[0].binding,
+        layout->attribute_desc[1].format = vertex_packing.normal,
+        layout->attribute_desc[1].offset = offsetof(packed_vertex_pos16, normal);
+        // uv
+        layout->attribute_desc[2].location = 2;
+        layout->attribute_desc[2].binding = layout->binding_desc[0].binding,
+        layout->attribute_desc[2].format = vertex_packing.uv,
+        layout->attribute_desc[2].offset = offsetof(packed_vertex_pos16, uv);
+    }
+
+    {
+        vertex_layout *layout = &vertex_layouts[VERTEX_LAYOUT_POS16_NOR_UV_PACKED_INSTANCED];
+        *layout = vertex_layouts[VERTEX_LAYOUT_POS16_NOR_UV_PACKED];
+        layout->binding_desc_size = 2;
+        // model matrix and position scale of every instance, same as the per-draw data of the other programs
+        layout->binding_desc[1].binding = 1;
+        layout->binding_desc[1].stride = 20 * sizeof(float);
+        layout->binding_desc[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        layout->attribute_desc_size = 8;
+        for (uint32_t i = 0; i < 5; i++) {
+            VkVertexInputAttributeDescription *attribute = &layout->attribute_desc[3 + i];
+            attribute->location = 3 + i;
+            attribute->binding = layout->binding_desc[1].binding;
+            attribute->format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attribute->offset = i * 4 * sizeof(float);
+        }
+    }
+
+    {
+        vertex_layout *layout = &vertex_layouts[VERTEX_LAYOUT_POS_PACKED];
+        *layout = vertex_layouts[VERTEX_LAYOUT_POS16_NOR_UV_PACKED];
+        // same stride, normal and uv are skipped
+        layout->attribute_desc_size = 1;
+    }
+
+    {
+        vertex_layout *layout = &vertex_layouts[VERTEX_LAYOUT_POS_PACKED_INSTANCED];
+        *layout = vertex_layouts[VERTEX_LAYOUT_POS16_NOR_UV_PACKED_INSTANCED];
+        // the instance attributes keep their locations
+        for (uint32_t i = 3; i < layout->attribute_desc_size; i++) {
+            layout->attribute_desc[i - 2] = layout->attribute_desc[i];
+        }
+        layout->attribute_desc_size -= 2;
+    }
+
     return true;
 }
 
-static bool create_descriptor_pools(render_program_manager *m) {
-    const gpu_info *gpu = &context.gpus[context.selected_gpu];
-    uint32_t max_uniform_descriptors = gpu->props.limits.maxDescriptorSetUniformBuffers;
-    uint32_t max_sample_descriptors = gpu->props.limits.maxDescriptorSetSampledImages;
+static bool create_program_descriptor_pool(render_program_manager *m) {
     VkDescriptorPoolSize pool_sizes[] = {
+        // the uniform block and the push constants that do not fit the device
+        {
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .descriptorCount = 2 * MAX_RENDER_PROGRAMS
+        },
         {
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = max_uniform_descriptors
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+            .descriptorCount = MAX_RENDER_PROGRAMS
         },
         {
-            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = max_sample_descriptors
+            .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = MAX_RENDER_PROGRAMS
         }
     };
     const size_t num_sizes = sizeof(pool_sizes) / sizeof(VkDescriptorPoolSize);
@@ -475,14 +881,12 @@ static bool create_descriptor_pools(render_program_manager *m) {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .maxSets = MAX_DECRIPTOR_SETS,
+        .maxSets = MAX_RENDER_PROGRAMS,
         .poolSizeCount = num_sizes,
         .pPoolSizes = pool_sizes
     };
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
-        CHECK_VK(vkCreateDescriptorPool(context.device, &pool_info, NULL, &m->descriptor_pools[i]));
-    }
+    CHECK_VK(vkCreateDescriptorPool(context.device, &pool_info, NULL, &m->program_descriptor_pool));
 
     return true;
 }
@@ -505,6 +909,17 @@ uint32_t get_shader_type_bits_render_program(render_program *prog) {
     return result;
 }
 
+VkShaderStageFlags get_shader_stages_render_program(render_program *prog) {
+    uint32_t type_bits = get_shader_type_bits_render_program(prog);
+    VkShaderStageFlags stages = 0;
+    for (size_t i = 0; i < SHADER_TYPES_COUNT; i++) {
+        if (type_bits & shader_types[i]) {
+            stages |= shader_type_to_shader_stage(shader_types[i]);
+        }
+    }
+    return stages;
+}
+
 void init_render_program(render_program *prog) {
     string_copy(prog->name, MAX_SHADER_NAME_SIZE, "");
     prog->instance = RENDER_PROGRAM_INSTANCE_UNDEFINED;
@@ -521,6 +936,25 @@ void init_render_program(render_program *prog) {
     prog->pipeline_layout = VK_NULL_HANDLE;
     prog->descriptor_set_layout = VK_NULL_HANDLE;
 
+    prog->uniform_block_size = 0;
+    prog->uniform_descriptor_set = VK_NULL_HANDLE;
+
+    prog->push_constants_size = 0;
+    prog->push_constants_stages = 0;
+    prog->push_constants_in_ring = false;
+    prog->uniform_offset = 0;
+    prog->push_constants_offset = 0;
+
+    prog->draw_data_size = 0;
+    prog->instance_data_size = 0;
+
+    prog->storage_ring = false;
+    prog->sampled_images = 0;
+    prog->storage_images = 0;
+    prog->image_descriptor_set_layout = VK_NULL_HANDLE;
+    prog->bindless = false;
+    prog->depth_program = RENDER_PROGRAM_INSTANCE_UNDEFINED;
+
     prog->pipeline_cache_size = 0;
     for (size_t i = 0; i < MAX_PIPELINE_CACHE_SIZE; i++) {
         pipeline_state *p = &prog->pipeline_cache[i];
@@ -539,6 +973,10 @@ void destroy_render_program(render_program *prog) {
         vkDestroyDescriptorSetLayout(context.device, prog->descriptor_set_layout, NULL);
         prog->descriptor_set_layout = VK_NULL_HANDLE;
     }
+    if (prog->image_descriptor_set_layout) {
+        vkDestroyDescriptorSetLayout(context.device, prog->image_descriptor_set_layout, NULL);
+        prog->image_descriptor_set_layout = VK_NULL_HANDLE;
+    }
     for (size_t i = 0; i < prog->pipeline_cache_size; i++) {
         pipeline_state *ps = &prog->pipeline_cache[i];
         if (ps->pipeline) {
@@ -552,13 +990,11 @@ bool init_render_program_manager(render_program_manager *m) {
     m->current_frame = 0;
     m->current_descriptor_set = 0;
     m->current_parameter_buffer_offset = 0;
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
-        m->descriptor_pools[i] = VK_NULL_HANDLE;
-    }
-    bool success = init_shaders(m) &&
+    m->program_descriptor_pool = VK_NULL_HANDLE;
+    bool success = create_program_descriptor_pool(m) &&
+        init_shaders(m) &&
         init_render_programs(m) &&
-        create_vertex_descriptions() &&
-        create_descriptor_pools(m);
+        create_vertex_descriptions();
 
     return success;
 }
@@ -600,12 +1036,10 @@ int find_render_program_instance_program_manager(render_program_manager *m, rend
 }
 
 bool start_frame_render_program_manager(render_program_manager *m) {
-    m->current_frame = (m->current_frame + 1) % NUM_FRAME_DATA;
+    m->current_frame = (m->current_frame + 1) % context.frames_in_flight;
     m->current_descriptor_set = 0;
     m->current_parameter_buffer_offset = 0;
 
-    CHECK_VK(vkResetDescriptorPool(context.device, m->descriptor_pools[m->current_frame], 0));
-
     return true;
 }
 
@@ -623,7 +1057,7 @@ bool bind_program_instance_render_program_manager(render_program_manager *m, ren
 }
 
 bool commit_current_program_render_program_manager(render_program_manager *m,
-    uint64_t state_bits, VkCommandBuffer command_buffer)
+    uint64_t state_bits, command_state *state)
 {
     if (m->current_render_program == -1) {
         log_error("Unable to commit current render program - invalid index");
@@ -637,9 +1071,127 @@ bool commit_current_program_render_program_manager(render_program_manager *m,
         return false;
     }
 
-    VkPipelineBindPoint bind_point = prog->shader_indices.comp == -1 ?
-        VK_PIPELINE_BIND_POINT_GRAPHICS : VK_PIPELINE_BIND_POINT_COMPUTE;
-    vkCmdBindPipeline(command_buffer, bind_point, ps.pipeline);
+    bind_pipeline_command_state(state, get_bind_point_render_program(prog), ps.pipeline);
+    if (prog->bindless) {
+        bind_descriptor_sets_command_state(state, get_bind_point_render_program(prog), prog->pipeline_layout, 1, 1,
+            &bindless_descriptors.set, 0, NULL);
+    }
+
+    return true;
+}
+
+// the full block is reserved so the descriptor range never reaches past the ring
+static bool alloc_ring_block(const void *data, size_t size, uint32_t block_size, uint32_t *dynamic_offset) {
+    byte *dest = vk_alloc_uniform(block_size, dynamic_offset);
+    if (!dest) {
+        return false;
+    }
+    mem_copy(dest, data, size);
+
+    return true;
+}
+
+bool alloc_uniform_block_render_program_manager(render_program_manager *m, const void *data, size_t size,
+    uint32_t *dynamic_offset)
+{
+    if (m->current_render_program == -1) {
+        log_error("Unable to allocate uniform block - invalid render program index");
+        return false;
+    }
+    render_program *prog = &m->programs[m->current_render_program];
+    if (!prog->uniform_descriptor_set || size > prog->uniform_block_size) {
+        log_error("Render program %s does not declare a uniform block of %zu bytes", prog->name, size);
+        return false;
+    }
+
+    return alloc_ring_block(data, size, prog->uniform_block_size, dynamic_offset);
+}
+
+// binds set 0 with its dynamic offsets in binding order, the draw data block starts at the first draw
+static void bind_uniform_descriptor_set(render_program *prog, command_state *state) {
+    uint32_t dynamic_offsets[3];
+    uint32_t dynamic_offsets_size = 0;
+    if (prog->uniform_block_size > 0) {
+        dynamic_offsets[dynamic_offsets_size++] = prog->uniform_offset;
+    }
+    if (prog->draw_data_size > 0) {
+        dynamic_offsets[dynamic_offsets_size++] = 0;
+    }
+    if (prog->push_constants_in_ring) {
+        dynamic_offsets[dynamic_offsets_size++] = prog->push_constants_offset;
+    }
+
+    bind_descriptor_sets_command_state(state, get_bind_point_render_program(prog), prog->pipeline_layout, 0, 1,
+        &prog->uniform_descriptor_set, dynamic_offsets_size, dynamic_offsets);
+}
+
+bool bind_uniform_block_render_program_manager(render_program_manager *m, const void *data, size_t size,
+    command_state *state)
+{
+    uint32_t dynamic_offset = 0;
+    if (!alloc_uniform_block_render_program_manager(m, data, size, &dynamic_offset)) {
+        return false;
+    }
+    render_program *prog = &m->programs[m->current_render_program];
+    prog->uniform_offset = dynamic_offset;
+    bind_uniform_descriptor_set(prog, state);
+
+    return true;
+}
+
+VkDescriptorSetLayout get_image_descriptor_set_layout_render_program_manager(render_program_manager *m,
+    render_program_instance instance)
+{
+    int index = find_render_program_instance_program_manager(m, instance);
+    return index == -1 ? VK_NULL_HANDLE : m->programs[index].image_descriptor_set_layout;
+}
+
+bool bind_image_descriptor_set_render_program_manager(render_program_manager *m, VkDescriptorSet descriptor_set,
+    command_state *state)
+{
+    if (m->current_render_program == -1) {
+        log_error("Unable to bind images - invalid render program index");
+        return false;
+    }
+    render_program *prog = &m->programs[m->current_render_program];
+    if (!prog->image_descriptor_set_layout) {
+        log_error("Render program %s does not take any images", prog->name);
+        return false;
+    }
+
+    bind_descriptor_sets_command_state(state, get_bind_point_render_program(prog), prog->pipeline_layout, 1, 1,
+        &descriptor_set, 0, NULL);
+
+    return true;
+}
+
+bool push_constants_render_program_manager(render_program_manager *m, const void *data, size_t size,
+    command_state *state)
+{
+    if (m->current_render_program == -1) {
+        log_error("Unable to push constants - invalid render program index");
+        return false;
+    }
+    render_program *prog = &m->programs[m->current_render_program];
+
+    if (size > prog->push_constants_size) {
+        log_error("Push constants of %zu bytes exceed the %u declared by render program %s", size,
+            prog->push_constants_size, prog->name);
+        return false;
+    }
+    if ((size & 3) != 0) {
+        log_error("Push constants size must be a multiple of 4, got %zu", size);
+        return false;
+    }
+    if (prog->push_constants_in_ring) {
+        if (!alloc_ring_block(data, size, prog->push_constants_size, &prog->push_constants_offset)) {
+            return false;
+        }
+        bind_uniform_descriptor_set(prog, state);
+        return true;
+    }
+
+    push_constants_command_state(state, prog->pipeline_layout, prog->push_constants_stages, size, data);
 
     return true;
 }
@@ -662,11 +1214,9 @@ void destroy_render_program_manager(render_program_manager *m) {
         m->shaders = NULL;
     }
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
-        if (m->descriptor_pools[i]) {
-            vkDestroyDescriptorPool(context.device, m->descriptor_pools[i], NULL);
-            m->descriptor_pools[i] = VK_NULL_HANDLE;
-        }
+    if (m->program_descriptor_pool) {
+        vkDestroyDescriptorPool(context.device, m->program_descriptor_pool, NULL);
+        m->program_descriptor_pool = VK_NULL_HANDLE;
     }
 }
 
@@ -682,8 +1232,28 @@ bool bind_program_instance(render_program_instance instance) {
     return bind_program_instance_render_program_manager(&ren_pm, instance);
 }
 
-bool commit_current_program(uint64_t state_bits, VkCommandBuffer command_buffer) {
-    return commit_current_program_render_program_manager(&ren_pm, state_bits, command_buffer);
+bool commit_current_program(uint64_t state_bits, command_state *state) {
+    return commit_current_program_render_program_manager(&ren_pm, state_bits, state);
+}
+
+bool alloc_uniform_block(const void *data, size_t size, uint32_t *dynamic_offset) {
+    return alloc_uniform_block_render_program_manager(&ren_pm, data, size, dynamic_offset);
+}
+
+bool bind_uniform_block(const void *data, size_t size, command_state *state) {
+    return bind_uniform_block_render_program_manager(&ren_pm, data, size, state);
+}
+
+bool push_constants(const void *data, size_t size, command_state *state) {
+    return push_constants_render_program_manager(&ren_pm, data, size, state);
+}
+
+VkDescriptorSetLayout get_image_descriptor_set_layout(render_program_instance instance) {
+    return get_image_descriptor_set_layout_render_program_manager(&ren_pm, instance);
+}
+
+bool bind_image_descriptor_set(VkDescriptorSet descriptor_set, command_state *state) {
+    return bind_image_descriptor_set_render_program_manager(&ren_pm, descriptor_set, state);
 }
 
 void destroy_ren_pm() {
@@ -8,17 +8,29 @@
 #include "./shader.h"
 #include "../../vulkan/config.h"
 #include "./pipeline_state.h"
+#include "../command_state.h"
 
 #define MAX_SHADERS 64
 #define MAX_RENDER_PROGRAMS 32
 #define MAX_PIPELINE_CACHE_SIZE 64
 #define MAX_VERTEX_BINDING_DESCRIPTORS 8
 #define MAX_VERTEX_ATTRIBUTE_BINDING_DESCRIPTORS 8
+// draws of one indirect batch, sizes the per-draw data range of a program
+#define MAX_INDIRECT_BATCH_DRAWS 512
+#define MAX_PROGRAM_IMAGES 8
 
 typedef enum render_program_instance {
     RENDER_PROGRAM_INSTANCE_UNDEFINED = -1,
     RENDER_PROGRAM_INSTANCE_TEST,
     RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE,
+    RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INDIRECT,
+    RENDER_PROGRAM_INSTANCE_LAMBERT_DIFFUSE_INSTANCED,
+    RENDER_PROGRAM_INSTANCE_CULL,
+    RENDER_PROGRAM_INSTANCE_CULL_BINDLESS,
+    RENDER_PROGRAM_INSTANCE_HIZ,
+    RENDER_PROGRAM_INSTANCE_DEPTH,
+    RENDER_PROGRAM_INSTANCE_DEPTH_INDIRECT,
+    RENDER_PROGRAM_INSTANCE_DEPTH_INSTANCED,
     RENDER_PROGRAM_INSTANCES_TOTAL
 } render_program_instance;
 
@@ -29,6 +41,11 @@ typedef enum vertex_layout_type {
 	VERTEX_LAYOUT_POS_NOR,
     VERTEX_LAYOUT_POS_NOR_UV_3,
     VERTEX_LAYOUT_POS_NOR_UV,
+    VERTEX_LAYOUT_POS16_NOR_UV_PACKED,
+    VERTEX_LAYOUT_POS16_NOR_UV_PACKED_INSTANCED,
+    // the position alone out of the packed vertices, for depth-only programs
+    VERTEX_LAYOUT_POS_PACKED,
+    VERTEX_LAYOUT_POS_PACKED_INSTANCED,
 	VERTEX_LAYOUTS_TOTAL
 } vertex_layout_type;
 
@@ -44,6 +61,15 @@ typedef struct render_program_config {
         shader_instance_type comp;
     } shader_instances;
     vertex_layout_type vertex_layout;
+    uint32_t uniform_block_size;
+    uint32_t push_constants_size;
+    uint32_t draw_data_size;
+    uint32_t instance_data_size;
+    bool storage_ring;
+    uint32_t sampled_images;
+    uint32_t storage_images;
+    bool bindless;
+    render_program_instance depth_program;
     uint64_t preconfigured_pipelines[MAX_PIPELINE_CACHE_SIZE + 1];
 } render_program_config;
 
@@ -65,6 +91,38 @@ typedef struct render_program {
     VkPipelineLayout pipeline_layout;
     VkDescriptorSetLayout descriptor_set_layout;
 
+    uint32_t uniform_block_size;
+    VkDescriptorSet uniform_descriptor_set;
+
+    uint32_t push_constants_size;
+    VkShaderStageFlags push_constants_stages;
+    // a block larger than maxPushConstantsSize is written to the uniform ring on every push instead, the shaders
+    // declare it as a uniform block bound after the draw data one
+    bool push_constants_in_ring;
+    // what set 0 was last bound with, binding it again for one of the blocks keeps the other
+    uint32_t uniform_offset;
+    uint32_t push_constants_offset;
+
+    // per-draw storage block of programs drawn indirectly, bound after the uniform block
+    uint32_t draw_data_size;
+
+    // per-instance vertex attributes of instanced programs, read from binding 1
+    uint32_t instance_data_size;
+
+    // the whole uniform ring as a storage buffer, for passes that address it by offset
+    bool storage_ring;
+
+    // set 1, combined image samplers followed by storage images, filled by the pass using the program
+    uint32_t sampled_images;
+    uint32_t storage_images;
+    VkDescriptorSetLayout image_descriptor_set_layout;
+
+    // set 1 is the bindless table instead, bound with the pipeline, it takes no images of its own
+    bool bindless;
+
+    // drawn by the depth pre-pass in its place, with the same uniform block and per-draw data
+    render_program_instance depth_program;
+
     pipeline_state pipeline_cache[MAX_PIPELINE_CACHE_SIZE];
     size_t pipeline_cache_size;
 } render_program;
@@ -78,7 +136,8 @@ typedef struct render_program_manager {
     render_program *programs;
     size_t programs_size;
 
-    VkDescriptorPool descriptor_pools[NUM_FRAME_DATA];
+    // sets that live as long as their program, per-frame sets come from the descriptor allocator
+    VkDescriptorPool program_descriptor_pool;
     size_t current_frame;
     size_t current_descriptor_set;
     size_t current_parameter_buffer_offset;
@@ -86,6 +145,7 @@ typedef struct render_program_manager {
 
 void init_render_program(render_program *prog);
 uint32_t get_shader_type_bits_render_program(render_program *prog);
+VkShaderStageFlags get_shader_stages_render_program(render_program *prog);
 void destroy_render_program(render_program *prog);
 
 bool init_render_program_manager(render_program_manager *m);
@@ -97,7 +157,17 @@ bool get_pipeline_render_program_instance(pipeline_state *dest, render_program_i
 bool start_frame_render_program_manager(render_program_manager *m);
 bool bind_program_instance_render_program_manager(render_program_manager *m, render_program_instance instance);
 bool commit_current_program_render_program_manager(render_program_manager *m,
-    uint64_t state_bits, VkCommandBuffer command_buffer);
+    uint64_t state_bits, command_state *state);
+bool alloc_uniform_block_render_program_manager(render_program_manager *m, const void *data, size_t size,
+    uint32_t *dynamic_offset);
+bool bind_uniform_block_render_program_manager(render_program_manager *m, const void *data, size_t size,
+    command_state *state);
+bool push_constants_render_program_manager(render_program_manager *m, const void *data, size_t size,
+    command_state *state);
+VkDescriptorSetLayout get_image_descriptor_set_layout_render_program_manager(render_program_manager *m,
+    render_program_instance instance);
+bool bind_image_descriptor_set_render_program_manager(render_program_manager *m, VkDescriptorSet descriptor_set,
+    command_state *state);
 void destroy_render_program_manager(render_program_manager *m);
 
 extern render_program_manager ren_pm;
@@ -105,7 +175,14 @@ extern render_program_manager ren_pm;
 bool init_ren_pm();
 bool start_frame_ren_pm();
 bool bind_program_instance(render_program_instance instance);
-bool commit_current_program(uint64_t state_bits, VkCommandBuffer command_buffer);
+bool commit_current_program(uint64_t state_bits, command_state *state);
+bool alloc_uniform_block(const void *data, size_t size, uint32_t *dynamic_offset);
+bool bind_uniform_block(const void *data, size_t size, command_state *state);
+// goes through the uniform ring when the program's block does not fit the device, see push_constants_in_ring
+bool push_constants(const void *data, size_t size, command_state *state);
+VkDescriptorSetLayout get_image_descriptor_set_layout(render_program_instance instance);
+// binds set 1 of the current program, the images are written by whoever allocated the set
+bool bind_image_descriptor_set(VkDescriptorSet descriptor_set, command_state *state);
 void destroy_ren_pm();
 
 #endif // SHADER_MANAGER_H
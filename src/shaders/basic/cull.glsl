@@ -0,0 +1,135 @@
+// shared by cull.comp and cull_bindless.comp, which only differ in where the depth pyramid comes from
+
+layout (local_size_x = 64) in;
+
+const uint CULL_OCCLUSION = 1;
+const uint CULL_COMPACT = 2;
+
+// offsets are in words from the start of the uniform ring
+layout (set = 0, binding = 0) uniform cull_uniforms {
+    mat4 view_projection;
+    mat4 occlusion_view_projection;
+    vec4 frustum_planes[6];
+    vec2 hiz_size;
+    uint hiz_levels;
+    uint objects;
+    uint objects_size;
+    uint flags;
+    // slot of the pyramid in the bindless table, unused when it is bound as set 1
+    uint hiz_index;
+} cull;
+
+layout (set = 0, binding = 1) buffer ring_words {
+    uint words[];
+} ring;
+
+// farthest depth of the previous frame
+#ifdef BINDLESS
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+#define HIZ textures[cull.hiz_index]
+#else
+layout (set = 1, binding = 0) uniform sampler2D hiz;
+#define HIZ hiz
+#endif
+
+// object: local sphere, model matrix, source command, destination commands, draw count
+const uint OBJECT_WORDS = 8;
+const uint COMMAND_WORDS = 5;
+
+mat4 load_model(uint offset) {
+    mat4 model;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            model[column][row] = uintBitsToFloat(ring.words[offset + column * 4 + row]);
+        }
+    }
+    return model;
+}
+
+bool frustum_visible(vec3 center, float radius) {
+    for (int i = 0; i < 6; i++) {
+        if (dot(cull.frustum_planes[i].xyz, center) + cull.frustum_planes[i].w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool occlusion_visible(vec3 center, float radius) {
+    vec2 uv_min = vec2(1.0);
+    vec2 uv_max = vec2(0.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + radius * vec3(
+            (i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = cull.occlusion_view_projection * vec4(corner, 1.0);
+        // crossing the near plane, nothing can be said about it
+        if (clip.w <= 0.0) {
+            return true;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        vec2 uv = ndc.xy * 0.5 + 0.5;
+        uv_min = min(uv_min, uv);
+        uv_max = max(uv_max, uv);
+        nearest = min(nearest, ndc.z);
+    }
+    uv_min = clamp(uv_min, 0.0, 1.0);
+    uv_max = clamp(uv_max, 0.0, 1.0);
+
+    vec2 extent = (uv_max - uv_min) * cull.hiz_size;
+    float level = ceil(log2(max(max(extent.x, extent.y), 1.0)));
+    level = min(level, float(cull.hiz_levels - 1));
+
+    float farthest = max(
+        max(textureLod(HIZ, uv_min, level).r, textureLod(HIZ, vec2(uv_max.x, uv_min.y), level).r),
+        max(textureLod(HIZ, vec2(uv_min.x, uv_max.y), level).r, textureLod(HIZ, uv_max, level).r));
+
+    return nearest <= farthest;
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= cull.objects_size) {
+        return;
+    }
+
+    uint object = cull.objects + index * OBJECT_WORDS;
+    vec4 sphere = vec4(
+        uintBitsToFloat(ring.words[object]), uintBitsToFloat(ring.words[object + 1]),
+        uintBitsToFloat(ring.words[object + 2]), uintBitsToFloat(ring.words[object + 3]));
+    uint command = ring.words[object + 5];
+    uint commands_out = ring.words[object + 6];
+    uint count = ring.words[object + 7];
+
+    bool visible = true;
+    if (sphere.w >= 0.0) {
+        mat4 model = load_model(ring.words[object + 4]);
+        vec3 center = (model * vec4(sphere.xyz, 1.0)).xyz;
+        float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+        float radius = sphere.w * scale;
+
+        visible = frustum_visible(center, radius);
+        if (visible && (cull.flags & CULL_OCCLUSION) != 0) {
+            visible = occlusion_visible(center, radius);
+        }
+    }
+
+    if ((cull.flags & CULL_COMPACT) != 0) {
+        if (!visible) {
+            return;
+        }
+        uint slot = atomicAdd(ring.words[count], 1);
+        for (uint i = 0; i < COMMAND_WORDS; i++) {
+            ring.words[commands_out + slot * COMMAND_WORDS + i] = ring.words[command + i];
+        }
+    } else {
+        // the slot is fixed by the first instance, culled draws keep their place with no instances
+        uint slot = ring.words[command + 4];
+        for (uint i = 0; i < COMMAND_WORDS; i++) {
+            ring.words[commands_out + slot * COMMAND_WORDS + i] = ring.words[command + i];
+        }
+        if (!visible) {
+            ring.words[commands_out + slot * COMMAND_WORDS + 1] = 0;
+        }
+    }
+}
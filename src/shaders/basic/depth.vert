@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects: enable
+
+// depth-only variant of diffuse.vert for the depth pre-pass, the position has to match it bit for bit
+out gl_PerVertex {
+    invariant vec4 gl_Position;
+};
+
+layout (set = 0, binding = 0) uniform view_uniforms {
+    mat4 view_projection;
+} view;
+
+layout (push_constant) uniform draw_constants {
+    mat4 model;
+} draw;
+
+layout (location = 0) in vec3 position;
+
+void main() {
+    vec4 world_position = draw.model * vec4(position, 1.0);
+
+    gl_Position = view.view_projection * world_position;
+}
@@ -0,0 +1,30 @@
+#version 450
+#extension GL_ARB_separate_shader_objects: enable
+
+// depth-only variant of diffuse_indirect.vert for the depth pre-pass
+out gl_PerVertex {
+    invariant vec4 gl_Position;
+};
+
+layout (set = 0, binding = 0) uniform view_uniforms {
+    mat4 view_projection;
+} view;
+
+struct draw_data {
+    mat4 model;
+    vec4 position_scale;
+};
+
+// one entry per draw of the batch, indexed by the first instance of its indirect command
+layout (set = 0, binding = 1) readonly buffer batch_draw_data {
+    draw_data draws[];
+} batch;
+
+layout (location = 0) in vec3 position;
+
+void main() {
+    draw_data draw = batch.draws[gl_InstanceIndex];
+    vec4 local_position = vec4(position, 1.0) * draw.position_scale;
+
+    gl_Position = view.view_projection * draw.model * local_position;
+}
@@ -0,0 +1,23 @@
+#version 450
+#extension GL_ARB_separate_shader_objects: enable
+
+// depth-only variant of diffuse_instanced.vert for the depth pre-pass
+out gl_PerVertex {
+    invariant vec4 gl_Position;
+};
+
+layout (set = 0, binding = 0) uniform view_uniforms {
+    mat4 view_projection;
+} view;
+
+layout (location = 0) in vec3 position;
+
+// per instance, stepped once for every instance of the draw
+layout (location = 3) in mat4 model;
+layout (location = 7) in vec4 position_scale;
+
+void main() {
+    vec4 local_position = vec4(position, 1.0) * position_scale;
+
+    gl_Position = view.view_projection * model * local_position;
+}
@@ -0,0 +1,40 @@
+#version 450
+#extension GL_ARB_separate_shader_objects: enable
+
+// matched by depth_indirect.vert
+out gl_PerVertex {
+    invariant vec4 gl_Position;
+};
+
+layout (set = 0, binding = 0) uniform view_uniforms {
+    mat4 view_projection;
+} view;
+
+struct draw_data {
+    mat4 model;
+    vec4 position_scale;
+};
+
+// one entry per draw of the batch, indexed by the first instance of its indirect command
+layout (set = 0, binding = 1) readonly buffer batch_draw_data {
+    draw_data draws[];
+} batch;
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 uv;
+
+layout (location = 0) out vec4 interpolated_position;
+layout (location = 1) out vec3 interpolated_normal;
+layout (location = 2) out vec2 interpolated_uv;
+
+void main() {
+    draw_data draw = batch.draws[gl_InstanceIndex];
+    vec4 local_position = vec4(position, 1.0) * draw.position_scale;
+
+    interpolated_position = local_position;
+    interpolated_normal = vec3(normal);
+    interpolated_uv = uv;
+
+    gl_Position = view.view_projection * draw.model * local_position;
+}
@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_separate_shader_objects: enable
+
+// matched by depth_instanced.vert
+out gl_PerVertex {
+    invariant vec4 gl_Position;
+};
+
+layout (set = 0, binding = 0) uniform view_uniforms {
+    mat4 view_projection;
+} view;
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 uv;
+
+// per instance, stepped once for every instance of the draw
+layout (location = 3) in mat4 model;
+layout (location = 7) in vec4 position_scale;
+
+layout (location = 0) out vec4 interpolated_position;
+layout (location = 1) out vec3 interpolated_normal;
+layout (location = 2) out vec2 interpolated_uv;
+
+void main() {
+    vec4 local_position = vec4(position, 1.0) * position_scale;
+
+    interpolated_position = local_position;
+    interpolated_normal = vec3(normal);
+    interpolated_uv = uv;
+
+    gl_Position = view.view_projection * model * local_position;
+}
@@ -0,0 +1,169 @@
+#include "./copy.h"
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include "./heap.h"
+#include "../logger/logger.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define COPY_KERNELS_X86
+    #include <immintrin.h>
+#endif
+
+static void copy_scalar(void *dest, const void *src, size_t length) {
+    mem_copy(dest, src, length);
+}
+
+#ifdef COPY_KERNELS_X86
+
+// streamed stores only combine into a single bus write when they fill a whole line, so the head is copied
+// until the destination sits on a line boundary rather than just the vector width
+static size_t copy_head_to_alignment(unsigned char **dest, const unsigned char **src, size_t length, size_t alignment) {
+    size_t head = (alignment - ((uintptr_t) *dest & (alignment - 1))) & (alignment - 1);
+    if (head > length) {
+        head = length;
+    }
+    if (head > 0) {
+        mem_copy(*dest, *src, head);
+        *dest += head;
+        *src += head;
+    }
+    return length - head;
+}
+
+__attribute__((target("sse2")))
+static void copy_stream_sse2(void *dest, const void *src, size_t length) {
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+
+    length = copy_head_to_alignment(&d, &s, length, STREAM_COPY_LINE_SIZE);
+
+    while (length >= STREAM_COPY_LINE_SIZE) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (s + 0));
+        __m128i b = _mm_loadu_si128((const __m128i*) (s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*) (s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i*) (s + 48));
+        _mm_stream_si128((__m128i*) (d + 0), a);
+        _mm_stream_si128((__m128i*) (d + 16), b);
+        _mm_stream_si128((__m128i*) (d + 32), c);
+        _mm_stream_si128((__m128i*) (d + 48), e);
+        d += STREAM_COPY_LINE_SIZE;
+        s += STREAM_COPY_LINE_SIZE;
+        length -= STREAM_COPY_LINE_SIZE;
+    }
+    while (length >= 16) {
+        _mm_stream_si128((__m128i*) d, _mm_loadu_si128((const __m128i*) s));
+        d += 16;
+        s += 16;
+        length -= 16;
+    }
+
+    _mm_sfence();
+
+    if (length > 0) {
+        mem_copy(d, s, length);
+    }
+}
+
+__attribute__((target("avx2")))
+static void copy_stream_avx2(void *dest, const void *src, size_t length) {
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+
+    length = copy_head_to_alignment(&d, &s, length, STREAM_COPY_LINE_SIZE);
+
+    while (length >= 2 * STREAM_COPY_LINE_SIZE) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (s + 0));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (s + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*) (s + 64));
+        __m256i e = _mm256_loadu_si256((const __m256i*) (s + 96));
+        _mm256_stream_si256((__m256i*) (d + 0), a);
+        _mm256_stream_si256((__m256i*) (d + 32), b);
+        _mm256_stream_si256((__m256i*) (d + 64), c);
+        _mm256_stream_si256((__m256i*) (d + 96), e);
+        d += 2 * STREAM_COPY_LINE_SIZE;
+        s += 2 * STREAM_COPY_LINE_SIZE;
+        length -= 2 * STREAM_COPY_LINE_SIZE;
+    }
+    while (length >= 32) {
+        _mm256_stream_si256((__m256i*) d, _mm256_loadu_si256((const __m256i*) s));
+        d += 32;
+        s += 32;
+        length -= 32;
+    }
+
+    _mm_sfence();
+    _mm256_zeroupper();
+
+    if (length > 0) {
+        mem_copy(d, s, length);
+    }
+}
+
+#endif
+
+static copy_kernel kernels[COPY_KERNEL_TOTAL] = {
+    [COPY_KERNEL_SCALAR] = copy_scalar,
+#ifdef COPY_KERNELS_X86
+    [COPY_KERNEL_SSE2]   = copy_stream_sse2,
+    [COPY_KERNEL_AVX2]   = copy_stream_avx2
+#endif
+};
+
+static const char *kernel_names[COPY_KERNEL_TOTAL] = {
+    [COPY_KERNEL_SCALAR] = "scalar",
+    [COPY_KERNEL_SSE2]   = "sse2 stream",
+    [COPY_KERNEL_AVX2]   = "avx2 stream"
+};
+
+static copy_kernel stream_kernel = copy_scalar;
+
+bool is_copy_kernel_supported(copy_kernel_type type) {
+    switch (type) {
+        case COPY_KERNEL_SCALAR:
+            return true;
+#ifdef COPY_KERNELS_X86
+        case COPY_KERNEL_SSE2:
+            return SDL_HasSSE2();
+        case COPY_KERNEL_AVX2:
+            return SDL_HasAVX2();
+#endif
+        default:
+            return false;
+    }
+}
+
+copy_kernel get_copy_kernel(copy_kernel_type type) {
+    if (type < 0 || type >= COPY_KERNEL_TOTAL || !is_copy_kernel_supported(type)) {
+        return NULL;
+    }
+    return kernels[type];
+}
+
+const char *get_copy_kernel_name(copy_kernel_type type) {
+    if (type < 0 || type >= COPY_KERNEL_TOTAL) {
+        return "unknown";
+    }
+    return kernel_names[type];
+}
+
+void init_copy_kernels() {
+    copy_kernel_type selected = COPY_KERNEL_SCALAR;
+    for (copy_kernel_type type = COPY_KERNEL_TOTAL - 1; type > COPY_KERNEL_SCALAR; type--) {
+        if (is_copy_kernel_supported(type)) {
+            selected = type;
+            break;
+        }
+    }
+
+    stream_kernel = kernels[selected];
+    log_info("Copy kernel: %s", kernel_names[selected]);
+}
+
+void mem_copy_stream(void *dest, const void *src, size_t length) {
+    if (length < STREAM_COPY_MIN_SIZE) {
+        mem_copy(dest, src, length);
+        return;
+    }
+    stream_kernel(dest, src, length);
+}
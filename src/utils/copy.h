@@ -0,0 +1,29 @@
+#ifndef COPY_UTILS_H
+#define COPY_UTILS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// below this size the fence costs more than the streamed lines save, mem_copy is used instead
+#define STREAM_COPY_MIN_SIZE 4096
+#define STREAM_COPY_LINE_SIZE 64
+
+typedef enum copy_kernel_type {
+    COPY_KERNEL_SCALAR,
+    COPY_KERNEL_SSE2,
+    COPY_KERNEL_AVX2,
+    COPY_KERNEL_TOTAL
+} copy_kernel_type;
+
+typedef void (*copy_kernel)(void *dest, const void *src, size_t length);
+
+void init_copy_kernels();
+
+bool is_copy_kernel_supported(copy_kernel_type type);
+copy_kernel get_copy_kernel(copy_kernel_type type);
+const char *get_copy_kernel_name(copy_kernel_type type);
+
+// use for writes into host visible (possibly write-combined) memory, the destination is never read back
+void mem_copy_stream(void *dest, const void *src, size_t length);
+
+#endif // COPY_UTILS_H
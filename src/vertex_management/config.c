@@ -4,5 +4,6 @@ vertex_management_configuration vertex_management_config = {
     .mesh_loader_config = {
         .max_vertex_buffer_size = 10000,
         .max_index_buffer_size = 10000
-    }
+    },
+    .static_buffer_size = 1024 * 1024
 };
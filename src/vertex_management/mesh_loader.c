@@ -1,5 +1,6 @@
 #include "./mesh_loader.h"
 
+#include "./vertex_packing.h"
 #include "../utils/heap.h"
 #include "../geom/plane.h"
 #include "../geom/circle.h"
@@ -35,11 +36,21 @@ static generate_mesh_geometry_function gen_geom_functions[GEOMETRY_TYPE_COUNT] =
     [SPHERE_GEOMETRY] = &generate_sphere_mesh_geometry
 };
 
+static void compact_indices_to_uint16(uint32_t *indices, uint32_t index_count) {
+    // safe in place, the 16 bit slot i never lies past the already read 32 bit element i
+    byte *dest = (byte*) indices;
+    for (uint32_t i = 0; i < index_count; i++) {
+        uint16_t index = (uint16_t) indices[i];
+        mem_copy(dest + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+    }
+}
+
 bool init_mesh_loader_tool(mesh_loader_tool *mesh_tool, uint32_t vertex_buffer_size, uint32_t index_buffer_size) {
     mesh_tool->vertex_buffer_size = 0;
     mesh_tool->index_buffer_size = 0;
     mesh_tool->vertex_buffer = NULL;
     mesh_tool->index_buffer = NULL;
+    mesh_tool->index_type = VK_INDEX_TYPE_UINT32;
 
     mesh_tool->vertex_buffer = mem_alloc(vertex_buffer_size * sizeof(vertex));
     mesh_tool->index_buffer = mem_alloc(index_buffer_size * sizeof(uint32_t));
@@ -67,12 +78,36 @@ uint64_t load_mesh_geometry_mesh_loader_tool(mesh_loader_tool *mesh_tool, const
 
     f(conf, &vertex_count, mesh_tool->vertex_buffer, &index_count, mesh_tool->index_buffer);
 
+    if (vertex_count <= MESH_MAX_UINT16_INDEXED_VERTICES) {
+        compact_indices_to_uint16(mesh_tool->index_buffer, index_count);
+        mesh_tool->index_type = VK_INDEX_TYPE_UINT16;
+    } else {
+        mesh_tool->index_type = VK_INDEX_TYPE_UINT32;
+    }
+
     uint64_t result = ((uint64_t) vertex_count) << UINT64_C(32);
     result |= index_count;
 
     return result;
 }
 
+size_t get_index_data_size_mesh_loader_tool(const mesh_loader_tool *mesh_tool, uint32_t index_count) {
+    return index_count * (mesh_tool->index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+size_t pack_vertices_mesh_loader_tool(mesh_loader_tool *mesh_tool, uint32_t vertex_count, vertex_layout_type layout,
+    void *dest, float *position_scale)
+{
+    if (vertex_count > mesh_tool->vertex_buffer_size) {
+        return 0;
+    }
+
+    *position_scale = layout == VERTEX_LAYOUT_POS16_NOR_UV_PACKED ?
+        compute_position_scale(mesh_tool->vertex_buffer, vertex_count) : 1.0f;
+
+    return pack_vertices(dest, mesh_tool->vertex_buffer, vertex_count, layout, *position_scale);
+}
+
 void destroy_mesh_loader_tool(mesh_loader_tool *mesh_tool) {
     if (mesh_tool->vertex_buffer) {
         mem_free(mesh_tool->vertex_buffer);
@@ -92,6 +127,14 @@ uint64_t load_mesh_geometry_mesh_loader(const mesh_geometry_config *conf) {
     return load_mesh_geometry_mesh_loader_tool(&mesh_loader, conf);
 }
 
+size_t get_index_data_size_mesh_loader(uint32_t index_count) {
+    return get_index_data_size_mesh_loader_tool(&mesh_loader, index_count);
+}
+
+size_t pack_vertices_mesh_loader(uint32_t vertex_count, vertex_layout_type layout, void *dest, float *position_scale) {
+    return pack_vertices_mesh_loader_tool(&mesh_loader, vertex_count, layout, dest, position_scale);
+}
+
 void destroy_mesh_loader() {
     destroy_mesh_loader_tool(&mesh_loader);
 }
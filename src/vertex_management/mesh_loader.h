@@ -6,9 +6,12 @@
 #include "./config.h"
 #include "./vertex_manager.h"
 #include "../geom/geom.h"
+#include "../renderer/shaders/shader_manager.h"
 
 #define MESH_VERTEX_COUNT(x) ((x) >> UINT64_C(32))
-#define MESH_INDEX_COUNT(x)  ((x) & ((1 << 32) - 1))
+#define MESH_INDEX_COUNT(x)  ((x) & UINT64_C(0xFFFFFFFF))
+
+#define MESH_MAX_UINT16_INDEXED_VERTICES (UINT32_C(1) << 16)
 
 typedef enum mesh_geometry_type {
     PLANE_GEOMETRY,
@@ -48,18 +51,24 @@ typedef struct mesh_loader_tool {
 
     uint32_t *index_buffer;
     uint32_t index_buffer_size;
+    VkIndexType index_type;
 } mesh_loader_tool;
 
 typedef void (*generate_mesh_geometry_function)(const mesh_geometry_config*, uint32_t*, vertex*, uint32_t*, uint32_t*);
 
 bool init_mesh_loader_tool(mesh_loader_tool *mesh_tool, uint32_t vertex_buffer_size, uint32_t index_buffer_size);
 uint64_t load_mesh_geometry_mesh_loader_tool(mesh_loader_tool *mesh_tool, const mesh_geometry_config *conf);
+size_t get_index_data_size_mesh_loader_tool(const mesh_loader_tool *mesh_tool, uint32_t index_count);
+size_t pack_vertices_mesh_loader_tool(mesh_loader_tool *mesh_tool, uint32_t vertex_count, vertex_layout_type layout,
+    void *dest, float *position_scale);
 void destroy_mesh_loader_tool(mesh_loader_tool *mesh_tool);
 
 extern mesh_loader_tool mesh_loader;
 
 bool init_mesh_loader(uint32_t vertex_buffer_size, uint32_t index_buffer_size);
 uint64_t load_mesh_geometry_mesh_loader(const mesh_geometry_config *conf);
+size_t get_index_data_size_mesh_loader(uint32_t index_count);
+size_t pack_vertices_mesh_loader(uint32_t vertex_count, vertex_layout_type layout, void *dest, float *position_scale);
 void destroy_mesh_loader();
 
 #endif // MESH_LOADER_H
@@ -1,36 +1,106 @@
 #include "./vertex_manager.h"
 
+#include "./config.h"
 #include "./mesh_loader.h"
+#include "./vertex_packing.h"
 #include "../utils/heap.h"
 #include "../logger/logger.h"
-#include "../geom/circle.h"
 
 vertex_cache_manager vertex_cache;
 
-bool init_vertex_manager(vertex_cache_manager *vc) {
-    vc->static_data = mem_alloc(20000);
-    for (uint32_t i = 0; i < 20000; i++) vc->static_data[i] = 0;
+static bool alloc_static_data(vertex_cache_manager *vc, size_t size, size_t alignment, VkDeviceSize *offset) {
+    // vertex data is aligned to its stride, which need not be a power of two
+    size_t aligned_offset = (vc->static_data_size + alignment - 1) / alignment * alignment;
+    if (aligned_offset + size > vc->static_data_capacity) {
+        log_error("Not enough space in the static vertex cache: %zu + %zu > %zu", aligned_offset, size,
+            vc->static_data_capacity);
+        return false;
+    }
+
+    vc->static_data_size = aligned_offset + size;
+    *offset = aligned_offset;
+
+    return true;
+}
 
-    uint32_t circle_vertex_count = 0;
-    uint32_t circe_index_count = 0;
+int add_static_mesh_vertex_manager(vertex_cache_manager *vc, const mesh_geometry_config *conf,
+    vertex_layout_type layout)
+{
+    if (vc->static_meshes_size >= MAX_STATIC_MESHES) {
+        log_error("Not enough space for another static mesh");
+        return -1;
+    }
 
-    generate_circle_geometry(1.0, 0, GEOM_2PI, 64, GEOM_Y_AXIS_FLIP_BIT, &circle_vertex_count,
-        NULL, &circe_index_count, NULL);
+    uint64_t counts = load_mesh_geometry_mesh_loader(conf);
+    if (counts == 0) {
+        log_error("Unable to load mesh geometry");
+        return -1;
+    }
 
-    vertex circle_vertices[65];
-    uint32_t indices[192];
-    generate_circle_geometry(1.0, 0, GEOM_2PI, 64, GEOM_Y_AXIS_FLIP_BIT, &circle_vertex_count,
-        circle_vertices, &circe_index_count, indices);
+    static_mesh mesh = {
+        .vertex_layout = layout,
+        .position_scale = 1.0f,
+        .vertex_count = MESH_VERTEX_COUNT(counts),
+        .index_count = MESH_INDEX_COUNT(counts),
+        .index_type = mesh_loader.index_type
+    };
 
-    uint32_t offset = ALIGN(sizeof(circle_vertices), 16);
+    size_t stride = get_vertex_layout_stride(layout);
+    size_t vertex_bytes = mesh.vertex_count * stride;
+    size_t index_bytes = get_index_data_size_mesh_loader(mesh.index_count);
+    size_t index_size = mesh.index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    bool success = alloc_static_data(vc, vertex_bytes, stride, &mesh.vertex_offset) &&
+        alloc_static_data(vc, index_bytes, 16, &mesh.index_offset);
+    if (!success) {
+        return -1;
+    }
+    mesh.base_vertex = mesh.vertex_offset / stride;
+    mesh.first_index = mesh.index_offset / index_size;
+
+    compute_bounding_sphere(mesh_loader.vertex_buffer, mesh.vertex_count, mesh.bounds);
+    if (pack_vertices_mesh_loader(mesh.vertex_count, layout, vc->static_data + mesh.vertex_offset,
+        &mesh.position_scale) != vertex_bytes)
+    {
+        log_error("Unable to pack mesh vertices to layout %d", layout);
+        vc->static_data_size = mesh.vertex_offset;
+        return -1;
+    }
+    mem_copy(vc->static_data + mesh.index_offset, mesh_loader.index_buffer, index_bytes);
+
+    vc->static_meshes[vc->static_meshes_size] = mesh;
+
+    return vc->static_meshes_size++;
+}
+
+bool upload_static_meshes_vertex_manager(vertex_cache_manager *vc) {
+    return update_data_vk_buffer(&vc->static_buffer, vc->static_data, vc->static_data_size, 0);
+}
+
+bool init_vertex_manager(vertex_cache_manager *vc) {
+    vc->static_meshes_size = 0;
+    vc->static_data_size = 0;
+    vc->static_data_capacity = vertex_management_config.static_buffer_size;
+    vc->static_data = mem_alloc(vc->static_data_capacity);
+    CHECK_ALLOC(vc->static_data, "Allocation fail");
+
+    mesh_geometry_config circle = {
+        .type = CIRCLE_GEOMETRY,
+        .geom_config_flag_bits = GEOM_Y_AXIS_FLIP_BIT,
+        .radius = 1.0,
+        .theta_start = 0,
+        .theta_length = GEOM_2PI,
+        .segments = 64
+    };
+
+    if (add_static_mesh_vertex_manager(vc, &circle, VERTEX_LAYOUT_POS16_NOR_UV_PACKED) < 0) {
+        return false;
+    }
 
-    mem_copy(vc->static_data, circle_vertices, sizeof(circle_vertices));
-    mem_copy(vc->static_data + offset, indices, sizeof(indices));
     init_vk_buffer(&vc->static_buffer, VERTEX_INDEX_BUFFER);
-    alloc_vk_buffer(&vc->static_buffer, vc->static_data, 20000, BU_STATIC);
-    // update_data_vk_buffer(&vc->static_buffer, vc->static_data, sizeof(vertex_data) + sizeof(indices), 0);
 
-    return true;
+    return alloc_vk_buffer(&vc->static_buffer, NULL, vc->static_data_capacity, BU_STATIC) &&
+        upload_static_meshes_vertex_manager(vc);
 }
 
 void destroy_vertex_manager(vertex_cache_manager *vc) {
@@ -43,6 +113,10 @@ bool init_vertex_cache() {
     return init_vertex_manager(&vertex_cache);
 }
 
+bool upload_vertex_cache() {
+    return upload_static_meshes_vertex_manager(&vertex_cache);
+}
+
 void destroy_vertex_cache() {
     destroy_vertex_manager(&vertex_cache);
 }
@@ -7,16 +7,46 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include "../vulkan/buffers/buffers.h"
+#include "../renderer/shaders/shader_manager.h"
+
+#define MAX_STATIC_MESHES 64
+
+typedef struct static_mesh {
+    vertex_layout_type vertex_layout;
+    float position_scale;
+    // local space center and radius
+    float bounds[4];
+    VkDeviceSize vertex_offset;
+    VkDeviceSize index_offset;
+    // the same offsets in vertices and indices, for drawing with the whole static buffer bound
+    int32_t base_vertex;
+    uint32_t first_index;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    VkIndexType index_type;
+} static_mesh;
 
 typedef struct vertex_cache_manager {
     vk_buffer static_buffer;
     byte *static_data;
+    size_t static_data_size;
+    size_t static_data_capacity;
+
+    static_mesh static_meshes[MAX_STATIC_MESHES];
+    size_t static_meshes_size;
 } vertex_cache_manager;
 
+typedef struct mesh_geometry_config mesh_geometry_config;
+
 bool init_vertex_manager(vertex_cache_manager *vc);
+int add_static_mesh_vertex_manager(vertex_cache_manager *vc, const mesh_geometry_config *conf,
+    vertex_layout_type layout);
+// meshes added after init are drawable once uploaded, before any frame reads them
+bool upload_static_meshes_vertex_manager(vertex_cache_manager *vc);
 void destroy_vertex_manager(vertex_cache_manager *vc);
 
 bool init_vertex_cache();
+bool upload_vertex_cache();
 void destroy_vertex_cache();
 
 extern vertex_cache_manager vertex_cache;
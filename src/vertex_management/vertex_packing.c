@@ -0,0 +1,206 @@
+#include "./vertex_packing.h"
+
+#include <math.h>
+#include <string.h>
+#include "../vulkan/functions/functions.h"
+#include "../vulkan/context.h"
+#include "../vulkan/gpu_info.h"
+#include "../utils/heap.h"
+#include "../logger/logger.h"
+
+vertex_packing_formats vertex_packing = {
+    .position16 = VK_FORMAT_R16G16B16A16_SNORM,
+    .normal     = VK_FORMAT_A2B10G10R10_SNORM_PACK32,
+    .uv         = VK_FORMAT_R16G16_SFLOAT
+};
+
+static bool is_vertex_format_supported(const gpu_info *gpu, VkFormat format) {
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(gpu->device, format, &props);
+    return (props.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT) != 0;
+}
+
+bool init_vertex_packing() {
+    const gpu_info *gpu = &context.gpus[context.selected_gpu];
+
+    // 10:10:10:2 snorm is optional as a vertex format, 8:8:8:8 snorm is required by the spec
+    if (!is_vertex_format_supported(gpu, vertex_packing.normal)) {
+        log_warning("A2B10G10R10_SNORM vertex format is not supported, packed normals fall back to R8G8B8A8_SNORM");
+        vertex_packing.normal = VK_FORMAT_R8G8B8A8_SNORM;
+    }
+    if (!is_vertex_format_supported(gpu, vertex_packing.uv)) {
+        log_error("R16G16_SFLOAT vertex format is not supported");
+        return false;
+    }
+    if (!is_vertex_format_supported(gpu, vertex_packing.position16)) {
+        log_error("R16G16B16A16_SNORM vertex format is not supported");
+        return false;
+    }
+
+    return true;
+}
+
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // inf / nan
+    if (exponent == 0xff) {
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+
+    int32_t half_exponent = (int32_t) exponent - 127 + 15;
+    if (half_exponent >= 0x1f) {
+        return sign | 0x7c00;
+    }
+    if (half_exponent <= 0) {
+        if (half_exponent < -10) {
+            return sign;
+        }
+        // subnormal half, round to nearest even
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - half_exponent;
+        uint32_t half_mantissa = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) {
+            half_mantissa++;
+        }
+        return sign | half_mantissa;
+    }
+
+    uint32_t half = sign | ((uint32_t) half_exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        // carry may overflow into the exponent which correctly rounds up to the next power of two / inf
+        half++;
+    }
+
+    return half;
+}
+
+static int32_t float_to_snorm(float value, int32_t max_value) {
+    if (value > 1.0f) {
+        value = 1.0f;
+    } else if (value < -1.0f) {
+        value = -1.0f;
+    }
+    return (int32_t) lroundf(value * (float) max_value);
+}
+
+uint32_t pack_snorm_a2b10g10r10(const float v[3]) {
+    uint32_t x = (uint32_t) float_to_snorm(v[0], 511) & 0x3ff;
+    uint32_t y = (uint32_t) float_to_snorm(v[1], 511) & 0x3ff;
+    uint32_t z = (uint32_t) float_to_snorm(v[2], 511) & 0x3ff;
+    return x | (y << 10) | (z << 20);
+}
+
+uint32_t pack_snorm_r8g8b8a8(const float v[3]) {
+    uint32_t x = (uint32_t) float_to_snorm(v[0], 127) & 0xff;
+    uint32_t y = (uint32_t) float_to_snorm(v[1], 127) & 0xff;
+    uint32_t z = (uint32_t) float_to_snorm(v[2], 127) & 0xff;
+    return x | (y << 8) | (z << 16);
+}
+
+int16_t pack_snorm16(float value) {
+    return (int16_t) float_to_snorm(value, 32767);
+}
+
+static uint32_t pack_normal(const vertex_float normal[3]) {
+    float n[3] = { normal[0], normal[1], normal[2] };
+    return vertex_packing.normal == VK_FORMAT_A2B10G10R10_SNORM_PACK32 ?
+        pack_snorm_a2b10g10r10(n) : pack_snorm_r8g8b8a8(n);
+}
+
+size_t get_vertex_layout_stride(vertex_layout_type layout) {
+    switch (layout) {
+        case VERTEX_LAYOUT_POS_NOR_3:
+            return 6 * sizeof(float);
+        case VERTEX_LAYOUT_POS_NOR_UV_3:
+            return sizeof(vertex);
+        case VERTEX_LAYOUT_POS16_NOR_UV_PACKED:
+            return sizeof(packed_vertex_pos16);
+        default:
+            return 0;
+    }
+}
+
+float compute_position_scale(const vertex *vertices, uint32_t vertex_count) {
+    float scale = 0.0f;
+    for (uint32_t i = 0; i < vertex_count; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            float a = fabsf(vertices[i].position[j]);
+            if (a > scale) {
+                scale = a;
+            }
+        }
+    }
+    return scale > 0.0f ? scale : 1.0f;
+}
+
+// centered on the bounding box, looser than the minimal sphere but a single pass
+void compute_bounding_sphere(const vertex *vertices, uint32_t vertex_count, float sphere[4]) {
+    float min[3] = { 0.0f, 0.0f, 0.0f };
+    float max[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < vertex_count; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            float p = vertices[i].position[j];
+            if (i == 0 || p < min[j]) {
+                min[j] = p;
+            }
+            if (i == 0 || p > max[j]) {
+                max[j] = p;
+            }
+        }
+    }
+
+    float radius_squared = 0.0f;
+    for (uint32_t j = 0; j < 3; j++) {
+        sphere[j] = 0.5f * (min[j] + max[j]);
+    }
+    for (uint32_t i = 0; i < vertex_count; i++) {
+        float d[3];
+        for (uint32_t j = 0; j < 3; j++) {
+            d[j] = vertices[i].position[j] - sphere[j];
+        }
+        float distance_squared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        if (distance_squared > radius_squared) {
+            radius_squared = distance_squared;
+        }
+    }
+    sphere[3] = sqrtf(radius_squared);
+}
+
+size_t pack_vertices(void *dest, const vertex *vertices, uint32_t vertex_count, vertex_layout_type layout,
+    float position_scale)
+{
+    switch (layout) {
+        case VERTEX_LAYOUT_POS_NOR_UV_3:
+            mem_copy(dest, vertices, vertex_count * sizeof(vertex));
+            break;
+        case VERTEX_LAYOUT_POS16_NOR_UV_PACKED: {
+            packed_vertex_pos16 *packed = dest;
+            float inv_scale = 1.0f / position_scale;
+            for (uint32_t i = 0; i < vertex_count; i++) {
+                const vertex *v = &vertices[i];
+                packed[i].position[0] = pack_snorm16(v->position[0] * inv_scale);
+                packed[i].position[1] = pack_snorm16(v->position[1] * inv_scale);
+                packed[i].position[2] = pack_snorm16(v->position[2] * inv_scale);
+                packed[i].position[3] = INT16_MAX;
+                packed[i].normal = pack_normal(v->normal);
+                packed[i].uv[0] = float_to_half(v->uv[0]);
+                packed[i].uv[1] = float_to_half(v->uv[1]);
+            }
+            break;
+        }
+        default:
+            log_error("Vertex layout %d cannot be packed", layout);
+            return 0;
+    }
+
+    return vertex_count * get_vertex_layout_stride(layout);
+}
@@ -0,0 +1,40 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <vulkan/vulkan.h>
+#include "../geom/geom.h"
+#include "../renderer/shaders/shader_manager.h"
+
+// snorm16 position (scaled by the mesh position scale), 10:10:10:2 (or 8:8:8:8 fallback) snorm normal and
+// half float uv - 16 bytes against 32 for the float layout
+typedef struct packed_vertex_pos16 {
+    int16_t position[4];
+    uint32_t normal;
+    uint16_t uv[2];
+} packed_vertex_pos16;
+
+typedef struct vertex_packing_formats {
+    VkFormat position16;
+    VkFormat normal;
+    VkFormat uv;
+} vertex_packing_formats;
+
+extern vertex_packing_formats vertex_packing;
+
+bool init_vertex_packing();
+
+uint16_t float_to_half(float value);
+uint32_t pack_snorm_a2b10g10r10(const float v[3]);
+uint32_t pack_snorm_r8g8b8a8(const float v[3]);
+int16_t pack_snorm16(float value);
+
+size_t get_vertex_layout_stride(vertex_layout_type layout);
+float compute_position_scale(const vertex *vertices, uint32_t vertex_count);
+void compute_bounding_sphere(const vertex *vertices, uint32_t vertex_count, float sphere[4]);
+size_t pack_vertices(void *dest, const vertex *vertices, uint32_t vertex_count, vertex_layout_type layout,
+    float position_scale);
+
+#endif // VERTEX_PACKING_H
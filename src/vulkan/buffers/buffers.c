@@ -5,10 +5,11 @@
 #include "../context.h"
 #include "../memory/staging.h"
 #include "../../utils/heap.h"
+#include "../../utils/copy.h"
 #include "../../logger/logger.h"
 
 bool copy_buffer_data(buffer_type type, byte *dest, const byte *src, VkDeviceSize num_bytes) {
-    mem_copy(dest, src, num_bytes);
+    mem_copy_stream(dest, src, num_bytes);
     return true;
 }
 
@@ -39,6 +40,9 @@ static VkBufferUsageFlags buffer_type_to_vulkan_buffer_usage(buffer_type type) {
             return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
         case VERTEX_INDEX_BUFFER:
             return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+        case RING_BUFFER:
+            return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
         default:
             return 0;
     }
@@ -59,15 +63,19 @@ bool alloc_vk_buffer(vk_buffer *buffer, void *data, VkDeviceSize alloc_size, buf
 
     VkDeviceSize num_bytes = get_allocated_buffer_size(buffer);
 
+    // the ring also holds what the async compute queue writes for the graphics queue
+    uint32_t families[] = { context.graphics_family_index, context.compute_family_index };
+    bool shared = buffer->type == RING_BUFFER && context.async_compute;
+
     VkBufferCreateInfo buffer_info = {
         .sType                 = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext                 = NULL,
         .flags                 = 0,
         .size                  = num_bytes,
         .usage                 = buffer_type_to_vulkan_buffer_usage(buffer->type),
-        .sharingMode           = VK_SHARING_MODE_EXCLUSIVE,
-        .queueFamilyIndexCount = 0,
-        .pQueueFamilyIndices   = NULL
+        .sharingMode           = shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = shared ? 2 : 0,
+        .pQueueFamilyIndices   = shared ? families : NULL
     };
 
     if (buffer->usage == BU_STATIC) {
@@ -199,7 +207,7 @@ bool update_data_vk_buffer(vk_buffer *buffer, void *data, VkDeviceSize size, VkD
         return false;
     }
 
-    mem_copy(stage_data, data, size);
+    mem_copy_stream(stage_data, data, size);
 
     VkBufferCopy buffer_copy = {
         .srcOffset = stage_offset,
@@ -23,7 +23,8 @@ typedef enum buffer_type {
     VERTEX_BUFFER,
     INDEX_BUFFER,
     UNIFORM_BUFFER,
-    VERTEX_INDEX_BUFFER
+    VERTEX_INDEX_BUFFER,
+    RING_BUFFER
 } buffer_type;
 
 typedef struct vk_buffer {
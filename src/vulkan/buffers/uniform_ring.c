@@ -0,0 +1,83 @@
+#include "./uniform_ring.h"
+
+#include "../context.h"
+#include "../gpu_info.h"
+#include "../memory/config.h"
+#include "../../utils/heap.h"
+#include "../../logger/logger.h"
+
+vk_uniform_ring uniform_ring;
+
+void init_vk_uniform_ring(vk_uniform_ring *ring) {
+    init_vk_buffer(&ring->buffer, RING_BUFFER);
+    ring->frame_size = 0;
+    ring->alignment = 1;
+    ring->offset = 0;
+    ring->current_frame = 0;
+}
+
+bool alloc_vk_uniform_ring(vk_uniform_ring *ring, VkDeviceSize frame_size) {
+    const gpu_info *gpu = &context.gpus[context.selected_gpu];
+    // the ring also holds per-draw storage blocks and indirect commands
+    VkDeviceSize alignment = gpu->props.limits.minUniformBufferOffsetAlignment;
+    VkDeviceSize storage_alignment = gpu->props.limits.minStorageBufferOffsetAlignment;
+    alignment = storage_alignment > alignment ? storage_alignment : alignment;
+    ring->alignment = alignment > 16 ? alignment : 16;
+    ring->frame_size = ALIGN(frame_size, ring->alignment);
+
+    VkDeviceSize buffer_size = ring->frame_size * context.frames_in_flight + UNIFORM_RING_TAIL_SIZE;
+    if (!alloc_vk_buffer(&ring->buffer, NULL, buffer_size, BU_DYNAMIC)) {
+        log_error("Unable to allocate uniform ring buffer");
+        return false;
+    }
+    if (!ring->buffer.allocation.data) {
+        log_error("Uniform ring buffer is not host visible");
+        return false;
+    }
+
+    return true;
+}
+
+void start_frame_vk_uniform_ring(vk_uniform_ring *ring, uint32_t frame) {
+    ring->current_frame = frame % context.frames_in_flight;
+    ring->offset = 0;
+}
+
+byte* alloc_block_vk_uniform_ring(vk_uniform_ring *ring, VkDeviceSize size, uint32_t *dynamic_offset) {
+    VkDeviceSize offset = ALIGN(ring->offset, ring->alignment);
+    if (offset + size > ring->frame_size) {
+        log_error("Uniform ring is full, %llu bytes requested, %llu / %llu used", (unsigned long long) size,
+            (unsigned long long) offset, (unsigned long long) ring->frame_size);
+        return NULL;
+    }
+
+    ring->offset = offset + size;
+
+    VkDeviceSize buffer_offset = ring->current_frame * ring->frame_size + offset;
+    *dynamic_offset = (uint32_t) buffer_offset;
+
+    return ring->buffer.allocation.data + get_buffer_offset(&ring->buffer) + buffer_offset;
+}
+
+void destroy_vk_uniform_ring(vk_uniform_ring *ring) {
+    free_vk_buffer(&ring->buffer);
+    ring->frame_size = 0;
+    ring->offset = 0;
+}
+
+bool vk_init_uniform_ring() {
+    init_vk_uniform_ring(&uniform_ring);
+    return alloc_vk_uniform_ring(&uniform_ring, vk_mem_config.uniform_ring_size_KB * 1024);
+}
+
+void vk_start_frame_uniform_ring(uint32_t frame) {
+    start_frame_vk_uniform_ring(&uniform_ring, frame);
+}
+
+byte* vk_alloc_uniform(VkDeviceSize size, uint32_t *dynamic_offset) {
+    return alloc_block_vk_uniform_ring(&uniform_ring, size, dynamic_offset);
+}
+
+void vk_destroy_uniform_ring() {
+    destroy_vk_uniform_ring(&uniform_ring);
+}
@@ -0,0 +1,35 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "./buffers.h"
+#include "../config.h"
+
+// descriptors with a fixed range may start anywhere in the ring, the padding keeps them inside the buffer
+#define UNIFORM_RING_TAIL_SIZE (64 * 1024)
+
+typedef struct vk_uniform_ring {
+    vk_buffer buffer;
+    VkDeviceSize frame_size;
+    VkDeviceSize alignment;
+    VkDeviceSize offset;
+    uint32_t current_frame;
+} vk_uniform_ring;
+
+void init_vk_uniform_ring(vk_uniform_ring *ring);
+bool alloc_vk_uniform_ring(vk_uniform_ring *ring, VkDeviceSize frame_size);
+void start_frame_vk_uniform_ring(vk_uniform_ring *ring, uint32_t frame);
+byte* alloc_block_vk_uniform_ring(vk_uniform_ring *ring, VkDeviceSize size, uint32_t *dynamic_offset);
+void destroy_vk_uniform_ring(vk_uniform_ring *ring);
+
+extern vk_uniform_ring uniform_ring;
+
+bool vk_init_uniform_ring();
+void vk_start_frame_uniform_ring(uint32_t frame);
+byte* vk_alloc_uniform(VkDeviceSize size, uint32_t *dynamic_offset);
+void vk_destroy_uniform_ring();
+
+#endif // UNIFORM_RING_H
@@ -2,7 +2,11 @@
 #define VULKAN_CONFIG_H
 
 #define MAX_PHYSICAL_DEVICES 32
-#define NUM_FRAME_DATA 2
+// frames recorded ahead of the GPU, the count in use is context.frames_in_flight
+#define MAX_FRAMES_IN_FLIGHT 4
+#define MAX_SWAPCHAIN_IMAGES 8
+#define NUM_STAGING_BUFFERS 2
+// initial timestamp queries per frame, the profiler grows its pools when a frame needs more
 #define NUM_TIMESTAMP_QUERIES 16
 
 #endif // VULKAN_CONFIG_H
@@ -6,6 +6,9 @@
 #include "./functions/function_loader.h"
 #include "./memory/memory.h"
 #include "./memory/staging.h"
+#include "./buffers/uniform_ring.h"
+#include "./descriptors/descriptor_allocator.h"
+#include "./descriptors/bindless.h"
 #include "./tools/tools.h"
 #include "../utils/heap.h"
 #include "../logger/logger.h"
@@ -13,6 +16,7 @@
 #include "../renderer/config.h"
 #include "../renderer/shaders/shader_manager.h"
 #include "../vertex_management/vertex_manager.h"
+#include "../vertex_management/vertex_packing.h"
 
 #ifdef DEBUG
     #include "./debug.h"
@@ -21,30 +25,57 @@
 vk_context context;
 
 void init_vk_context(vk_context *ctx) {
+    ctx->headless = render_config.headless;
+    ctx->vulkan_library = NULL;
     ctx->instance = VK_NULL_HANDLE;
     ctx->surface = VK_NULL_HANDLE;
     ctx->device = VK_NULL_HANDLE;
     ctx->graphics_queue = VK_NULL_HANDLE;
     ctx->present_queue = VK_NULL_HANDLE;
     ctx->command_pool = VK_NULL_HANDLE;
+    ctx->async_compute = false;
+    ctx->compute_family_index = 0;
+    ctx->compute_queue = VK_NULL_HANDLE;
+    ctx->compute_command_pool = VK_NULL_HANDLE;
+    ctx->graphics_timeline = VK_NULL_HANDLE;
+    ctx->compute_timeline = VK_NULL_HANDLE;
+    ctx->graphics_timeline_value = 0;
+    ctx->compute_timeline_value = 0;
     ctx->swapchain = VK_NULL_HANDLE;
     ctx->extent.width = ctx->extent.height = 0;
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+
+    int frames_in_flight = render_config.frames_in_flight;
+    if (frames_in_flight < 1) {
+        frames_in_flight = 1;
+    } else if (frames_in_flight > MAX_FRAMES_IN_FLIGHT) {
+        frames_in_flight = MAX_FRAMES_IN_FLIGHT;
+    }
+    ctx->frames_in_flight = frames_in_flight;
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         ctx->acquire_semaphores[i] = VK_NULL_HANDLE;
-        ctx->render_complete_semaphores[i] = VK_NULL_HANDLE;
         ctx->command_buffers[i] = VK_NULL_HANDLE;
+        ctx->compute_command_buffers[i] = VK_NULL_HANDLE;
         ctx->command_buffer_fences[i] = VK_NULL_HANDLE;
+    }
+    ctx->swapchain_images_size = 0;
+    for (size_t i = 0; i < MAX_SWAPCHAIN_IMAGES; i++) {
         ctx->swapchain_images[i] = VK_NULL_HANDLE;
         ctx->swapchain_views[i] = VK_NULL_HANDLE;
+        ctx->render_complete_semaphores[i] = VK_NULL_HANDLE;
         ctx->framebuffers[i] = VK_NULL_HANDLE;
-        ctx->query_pools[i] = VK_NULL_HANDLE;
+        init_image(&ctx->offscreen_images[i]);
     }
     ctx->render_pass = VK_NULL_HANDLE;
     ctx->gpus = NULL;
     ctx->gpus_size = 0;
     ctx->supersampling = false;
     ctx->sample_count = VK_SAMPLE_COUNT_1_BIT;
+    ctx->depth_sampled = false;
     ctx->pipeline_cache = VK_NULL_HANDLE;
+    ctx->retired_size = 0;
+    ctx->current_frame = 0;
+    ctx->draw_indirect_count = false;
+    ctx->bindless = false;
     #ifdef DEBUG
         ctx->debug_callback = VK_NULL_HANDLE;
     #endif
@@ -54,7 +85,8 @@ static bool create_instance(vk_context *ctx, SDL_Window *window) {
     const char **extensions = NULL;
     unsigned extension_count = 0;
 
-     if(!SDL_Vulkan_GetInstanceExtensions(window, &extension_count, NULL)) {
+    // a headless instance needs no surface extensions
+    if (window && !SDL_Vulkan_GetInstanceExtensions(window, &extension_count, NULL)) {
         log_error("SDL_Vulkan_GetInstanceExtensions(): %s", SDL_GetError());
         return false;
     }
@@ -67,7 +99,7 @@ static bool create_instance(vk_context *ctx, SDL_Window *window) {
     extensions = mem_alloc(sizeof(const char*) * (extension_count + debug_extension_count));
     CHECK_ALLOC(extensions, "Allocation fail");
 
-    if (!SDL_Vulkan_GetInstanceExtensions(window, &extension_count, extensions)) {
+    if (window && !SDL_Vulkan_GetInstanceExtensions(window, &extension_count, extensions)) {
         mem_free(extensions);
         log_error("SDL_Vulkan_GetInstanceExtensions(): %s", SDL_GetError());
         return false;
@@ -140,6 +172,9 @@ static bool create_instance(vk_context *ctx, SDL_Window *window) {
 #endif
 
 static bool create_surface(vk_context *ctx, SDL_Window *window) {
+    if (ctx->headless) {
+        return true;
+    }
     if (!SDL_Vulkan_CreateSurface(window, ctx->instance, &ctx->surface)) {
         log_error("SDL_Vulkan_CreateSurface(): %s", SDL_GetError());
         return false;
@@ -147,10 +182,29 @@ static bool create_surface(vk_context *ctx, SDL_Window *window) {
     return true;
 }
 
-static bool init_vulkan_function_loader() {
-    PFN_vkGetInstanceProcAddr vk_get_proc = SDL_Vulkan_GetVkGetInstanceProcAddr();
+#if defined(_WIN32)
+    #define VULKAN_LIBRARY_NAME "vulkan-1.dll"
+#elif defined(__APPLE__)
+    #define VULKAN_LIBRARY_NAME "libvulkan.1.dylib"
+#else
+    #define VULKAN_LIBRARY_NAME "libvulkan.so.1"
+#endif
+
+// SDL only loads Vulkan through its video subsystem, without a display the library is opened directly
+static bool init_vulkan_function_loader(vk_context *ctx) {
+    PFN_vkGetInstanceProcAddr vk_get_proc = NULL;
+    if (ctx->headless) {
+        ctx->vulkan_library = SDL_LoadObject(VULKAN_LIBRARY_NAME);
+        if (!ctx->vulkan_library) {
+            log_error("Unable to load %s: %s", VULKAN_LIBRARY_NAME, SDL_GetError());
+            return false;
+        }
+        vk_get_proc = (PFN_vkGetInstanceProcAddr) SDL_LoadFunction(ctx->vulkan_library, "vkGetInstanceProcAddr");
+    } else {
+        vk_get_proc = SDL_Vulkan_GetVkGetInstanceProcAddr();
+    }
     if(!vk_get_proc) {
-        log_error("SDL_Vulkan_GetVkGetInstanceProcAddr error: %s", SDL_GetError());
+        log_error("Unable to get vkGetInstanceProcAddr: %s", SDL_GetError());
         return false;
     }
     return load_external_function(vk_get_proc);
@@ -204,10 +258,25 @@ static bool choose_suitable_graphics_gpu(vk_context *ctx) {
 }
 
 static bool create_device(vk_context *ctx) {
-    uint32_t indices[] = { ctx->graphics_family_index, ctx->present_family_index };
+    gpu_info *gpu = &ctx->gpus[ctx->selected_gpu];
+
+    ctx->async_compute = render_config.async_compute && gpu->timeline_features.timelineSemaphore &&
+        find_async_compute_family(gpu, &ctx->compute_family_index);
+    if (render_config.async_compute && !ctx->async_compute) {
+        log_info("No compute-only queue family with timeline semaphores, compute stays on the graphics queue");
+    }
 
-    VkDeviceQueueCreateInfo devq_info[2];
-    uint32_t queue_count = indices[0] == indices[1] ? 1 : 2;
+    uint32_t indices[3] = { ctx->graphics_family_index };
+    uint32_t queue_count = 1;
+    if (ctx->present_family_index != ctx->graphics_family_index) {
+        indices[queue_count++] = ctx->present_family_index;
+    }
+    // a compute-only family is never the graphics one, it could present though
+    if (ctx->async_compute && ctx->compute_family_index != ctx->present_family_index) {
+        indices[queue_count++] = ctx->compute_family_index;
+    }
+
+    VkDeviceQueueCreateInfo devq_info[3];
     const float priority = 1.0f;
     for (uint32_t i = 0; i < queue_count; i++) {
         VkDeviceQueueCreateInfo qinfo = {
@@ -220,8 +289,6 @@ static bool create_device(vk_context *ctx) {
         devq_info[i] = qinfo;
     }
 
-    gpu_info *gpu = &ctx->gpus[ctx->selected_gpu];
-
     VkPhysicalDeviceFeatures device_features = {};
     device_features.textureCompressionBC = VK_TRUE;
     device_features.imageCubeArray       = VK_TRUE;
@@ -229,17 +296,60 @@ static bool create_device(vk_context *ctx) {
     device_features.depthBiasClamp       = VK_TRUE;
     device_features.depthBounds          = gpu->features.depthBounds;
     device_features.fillModeNonSolid     = VK_TRUE;
+    device_features.multiDrawIndirect         = gpu->features.multiDrawIndirect;
+    device_features.drawIndirectFirstInstance = gpu->features.drawIndirectFirstInstance;
+    device_features.pipelineStatisticsQuery   = gpu->features.pipelineStatisticsQuery;
+    device_features.inheritedQueries          = gpu->features.inheritedQueries;
+    ctx->enabled_features = device_features;
+
+    const char *extensions[GRAPHICS_DEVICE_EXTENSIONS_SIZE + OPTIONAL_DEVICE_EXTENSIONS_SIZE];
+    uint32_t extensions_size = 0;
+    for (size_t i = 0; i < (ctx->headless ? 0 : GRAPHICS_DEVICE_EXTENSIONS_SIZE); i++) {
+        extensions[extensions_size++] = GRAPHICS_DEVICE_EXTENSIONS[i];
+    }
+    for (size_t i = 0; i < OPTIONAL_DEVICE_EXTENSIONS_SIZE; i++) {
+        if (has_extension(gpu, OPTIONAL_DEVICE_EXTENSIONS[i])) {
+            extensions[extensions_size++] = OPTIONAL_DEVICE_EXTENSIONS[i];
+        }
+    }
+    ctx->draw_indirect_count = has_extension(gpu, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    // only what the bindless table uses is enabled
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+        .pNext = NULL,
+        .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+        .shaderStorageBufferArrayNonUniformIndexing = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+        .descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE
+    };
+    ctx->bindless = render_config.bindless && supports_bindless(gpu);
+    if (render_config.bindless && !ctx->bindless) {
+        log_warning("Descriptor indexing is not supported, bindless mode disabled");
+    }
+    void *features_chain = ctx->bindless ? &indexing_features : NULL;
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+        .pNext = features_chain,
+        .timelineSemaphore = VK_TRUE
+    };
+    if (ctx->async_compute) {
+        features_chain = &timeline_features;
+    }
 
     VkDeviceCreateInfo info = {
         .sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .pNext                   = NULL,
+        .pNext                   = features_chain,
         .flags                   = 0,
         .queueCreateInfoCount    = queue_count,
         .pQueueCreateInfos       = devq_info,
         .enabledLayerCount       = 0,
         .ppEnabledLayerNames     = NULL,
-        .enabledExtensionCount   = GRAPHICS_DEVICE_EXTENSIONS_SIZE,
-        .ppEnabledExtensionNames = GRAPHICS_DEVICE_EXTENSIONS,
+        .enabledExtensionCount   = extensions_size,
+        .ppEnabledExtensionNames = extensions,
         .pEnabledFeatures        = &device_features
     };
 
@@ -255,6 +365,9 @@ static bool init_queues(vk_context *ctx) {
     } else {
         vkGetDeviceQueue(ctx->device, ctx->present_family_index, 0, &ctx->present_queue);
     }
+    if (ctx->async_compute) {
+        vkGetDeviceQueue(ctx->device, ctx->compute_family_index, 0, &ctx->compute_queue);
+    }
 
     return true;
 }
@@ -265,26 +378,26 @@ static bool create_semaphores(vk_context *ctx) {
         .pNext = NULL,
         .flags = 0
     };
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < ctx->frames_in_flight; i++) {
         CHECK_VK(vkCreateSemaphore(ctx->device, &sempahore_info, NULL, &ctx->acquire_semaphores[i]));
-        CHECK_VK(vkCreateSemaphore(ctx->device, &sempahore_info, NULL, &ctx->render_complete_semaphores[i]));
     }
-    return true;
-}
+    if (!ctx->async_compute) {
+        return true;
+    }
 
-static bool create_query_pools(vk_context *ctx) {
-    VkQueryPoolCreateInfo query_pool_info = {
-        .sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
-        .pNext              = NULL,
-        .flags              = 0,
-        .queryType          = VK_QUERY_TYPE_TIMESTAMP,
-        .queryCount         = NUM_TIMESTAMP_QUERIES,
-        .pipelineStatistics = 0
+    VkSemaphoreTypeCreateInfoKHR type_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+        .pNext = NULL,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+        .initialValue = 0
     };
-
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
-        CHECK_VK(vkCreateQueryPool(ctx->device, &query_pool_info, NULL, &ctx->query_pools[i]));
-    }
+    VkSemaphoreCreateInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+        .flags = 0
+    };
+    CHECK_VK(vkCreateSemaphore(ctx->device, &timeline_info, NULL, &ctx->graphics_timeline));
+    CHECK_VK(vkCreateSemaphore(ctx->device, &timeline_info, NULL, &ctx->compute_timeline));
 
     return true;
 }
@@ -299,6 +412,11 @@ static bool create_command_pool(vk_context *ctx) {
 
     CHECK_VK(vkCreateCommandPool(ctx->device, &pool_info, NULL, &ctx->command_pool));
 
+    if (ctx->async_compute) {
+        pool_info.queueFamilyIndex = ctx->compute_family_index;
+        CHECK_VK(vkCreateCommandPool(ctx->device, &pool_info, NULL, &ctx->compute_command_pool));
+    }
+
     return true;
 }
 
@@ -308,10 +426,15 @@ static bool create_command_buffers(vk_context *ctx) {
         .pNext = NULL,
         .commandPool = ctx->command_pool,
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = NUM_FRAME_DATA
+        .commandBufferCount = ctx->frames_in_flight
     };
 
     CHECK_VK(vkAllocateCommandBuffers(ctx->device, &allocate_info, ctx->command_buffers));
+    // reused once the graphics fence of their frame slot was waited on, graphics waits for compute
+    if (ctx->async_compute) {
+        allocate_info.commandPool = ctx->compute_command_pool;
+        CHECK_VK(vkAllocateCommandBuffers(ctx->device, &allocate_info, ctx->compute_command_buffers));
+    }
 
     VkFenceCreateInfo fence_info = {
         .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
@@ -319,7 +442,7 @@ static bool create_command_buffers(vk_context *ctx) {
         .flags = 0
     };
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < ctx->frames_in_flight; i++) {
         CHECK_VK(vkCreateFence(ctx->device, &fence_info, NULL, &ctx->command_buffer_fences[i]));
     }
 
@@ -327,6 +450,18 @@ static bool create_command_buffers(vk_context *ctx) {
 }
 
 static bool create_swapchain(vk_context *ctx) {
+    if (ctx->headless) {
+        VkSurfaceFormatKHR surface_format = {
+            .format     = VK_FORMAT_R8G8B8A8_UNORM,
+            .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
+        };
+        ctx->surface_format = surface_format;
+        ctx->present_mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        ctx->extent.width = render_config.width;
+        ctx->extent.height = render_config.height;
+        return true;
+    }
+
     gpu_info *gpu = &ctx->gpus[ctx->selected_gpu];
 
     VkSurfaceFormatKHR surface_format;
@@ -343,6 +478,16 @@ static bool create_swapchain(vk_context *ctx) {
         return false;
     }
 
+    // one image more than the frames in flight so acquiring does not wait on the oldest frame's present
+    const VkSurfaceCapabilitiesKHR *caps = &gpu->surface_caps;
+    uint32_t min_image_count = ctx->frames_in_flight + 1;
+    if (min_image_count < caps->minImageCount) {
+        min_image_count = caps->minImageCount;
+    }
+    if (caps->maxImageCount > 0 && min_image_count > caps->maxImageCount) {
+        min_image_count = caps->maxImageCount;
+    }
+
     VkSharingMode sharing_mode = ctx->graphics_family_index == ctx->present_family_index ?
         VK_SHARING_MODE_EXCLUSIVE : VK_SHARING_MODE_CONCURRENT;
     uint32_t indices[] = { ctx->graphics_family_index, ctx->present_family_index };
@@ -353,12 +498,14 @@ static bool create_swapchain(vk_context *ctx) {
         .pNext                 = NULL,
         .flags                 = 0,
         .surface               = ctx->surface,
-        .minImageCount         = NUM_FRAME_DATA,
+        .minImageCount         = min_image_count,
         .imageFormat           = surface_format.format,
         .imageColorSpace       = surface_format.colorSpace,
         .imageExtent           = extent,
         .imageArrayLayers      = 1,
-        .imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        // a scaled scene is blitted into it when the surface allows
+        .imageUsage            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+            (caps->supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT),
         .imageSharingMode      = sharing_mode,
         .queueFamilyIndexCount = queue_count,
         .pQueueFamilyIndices   = ctx->graphics_family_index == ctx->present_family_index ? NULL : indices,
@@ -396,15 +543,40 @@ static bool get_depth_format(vk_context *ctx) {
     return true;
 }
 
-static bool create_render_targets(vk_context *ctx) {
+// one offscreen color image per frame in flight, so a frame never overwrites one that is still read back
+static bool create_offscreen_images(vk_context *ctx) {
+    for (size_t i = 0; i < ctx->frames_in_flight; i++) {
+        vk_image *image = &ctx->offscreen_images[i];
+        init_image(image);
+        image->props.format = FMT_RGBA8;
+        image->props.width = ctx->extent.width;
+        image->props.height = ctx->extent.height;
+        image->props.num_levels = 1;
+        image->props.repeat = TR_CLAMP;
+        image->props.render_target = true;
+        if (!alloc_image(image)) {
+            log_error("Unable to allocate offscreen image");
+            return false;
+        }
+        ctx->swapchain_images[i] = image->image;
+        ctx->swapchain_views[i] = image->view;
+    }
+    ctx->swapchain_images_size = ctx->frames_in_flight;
+
+    return true;
+}
+
+static bool get_swapchain_images(vk_context *ctx) {
     uint32_t num_images = 0;
     CHECK_VK(vkGetSwapchainImagesKHR(ctx->device, ctx->swapchain, &num_images, NULL));
     CHECK_VK_VAL(num_images > 0, "No swapchain images");
+    CHECK_VK_VAL(num_images <= MAX_SWAPCHAIN_IMAGES, "Too many swapchain images");
 
     CHECK_VK(vkGetSwapchainImagesKHR(ctx->device, ctx->swapchain, &num_images, ctx->swapchain_images));
     CHECK_VK_VAL(num_images > 0, "No swapchain images");
+    ctx->swapchain_images_size = num_images;
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < ctx->swapchain_images_size; i++) {
         VkImageViewCreateInfo image_view_info = {
             .sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
             .pNext      = NULL,
@@ -430,6 +602,38 @@ static bool create_render_targets(vk_context *ctx) {
         CHECK_VK(vkCreateImageView(ctx->device, &image_view_info, NULL, &ctx->swapchain_views[i]));
     }
 
+    // headless frames are not presented, nothing waits for them to complete
+    VkSemaphoreCreateInfo sempahore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0
+    };
+    for (size_t i = 0; i < ctx->swapchain_images_size; i++) {
+        CHECK_VK(vkCreateSemaphore(ctx->device, &sempahore_info, NULL, &ctx->render_complete_semaphores[i]));
+    }
+
+    return true;
+}
+
+static bool create_depth_image(vk_context *ctx) {
+    init_image(&ctx->depth_image);
+    ctx->depth_image.props.format = FMT_DEPTH;
+    ctx->depth_image.props.width = ctx->extent.width;
+    ctx->depth_image.props.height = ctx->extent.height;
+    ctx->depth_image.props.num_levels = 1;
+    ctx->depth_image.props.samples = (texture_samples) ctx->sample_count;
+    ctx->depth_image.props.repeat = TR_CLAMP;
+    ctx->depth_image.props.transient = !ctx->depth_sampled;
+
+    return alloc_image(&ctx->depth_image);
+}
+
+static bool create_render_targets(vk_context *ctx) {
+    bool success = ctx->headless ? create_offscreen_images(ctx) : get_swapchain_images(ctx);
+    if (!success) {
+        return false;
+    }
+
     gpu_info *gpu = &ctx->gpus[ctx->selected_gpu];
     VkImageFormatProperties fmt_props = {};
     vkGetPhysicalDeviceImageFormatProperties(gpu->device, ctx->surface_format.format,
@@ -444,38 +648,32 @@ static bool create_render_targets(vk_context *ctx) {
     } else if (render_config.desired_sample_count >= 2 && (fmt_props.sampleCounts & VK_SAMPLE_COUNT_2_BIT)) {
         ctx->sample_count = VK_SAMPLE_COUNT_2_BIT;
     }
+    // multisampled depth can not be reduced into the pyramid, the culling then tests the frustum only
+    ctx->depth_sampled = render_config.gpu_culling && ctx->sample_count == VK_SAMPLE_COUNT_1_BIT;
 
-    init_image(&ctx->depth_image);
-    ctx->depth_image.props.format = FMT_DEPTH;
-    ctx->depth_image.props.width = render_config.width;
-    ctx->depth_image.props.height = render_config.height;
-    ctx->depth_image.props.num_levels = 1;
-    ctx->depth_image.props.samples = (texture_samples) ctx->sample_count;
-    ctx->depth_image.props.repeat = TR_CLAMP;
-
-    return alloc_image(&ctx->depth_image);
+    return create_depth_image(ctx);
 }
 
-static bool create_render_pass(vk_context *ctx) {
+bool create_render_pass_vulkan(vk_context *ctx, VkImageLayout color_final_layout, VkRenderPass *render_pass) {
     VkAttachmentDescription color_attachment = {
         .flags          = 0,
         .format         = ctx->surface_format.format,
         .samples        = VK_SAMPLE_COUNT_1_BIT,
-        .loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
         .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
         .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+        .finalLayout    = color_final_layout
     };
 
     VkAttachmentDescription depth_attachment = {
         .flags          = 0,
         .format         = ctx->depth_format,
         .samples        = VK_SAMPLE_COUNT_1_BIT,
-        .loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-        .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
-        .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp        = ctx->depth_sampled ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_CLEAR,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
         .finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
@@ -510,10 +708,12 @@ static bool create_render_pass(vk_context *ctx) {
         {
             .srcSubpass      = VK_SUBPASS_EXTERNAL,
             .dstSubpass      = 0,
-            .srcStageMask    = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-            .dstStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .srcAccessMask   = VK_ACCESS_MEMORY_READ_BIT,
-            .dstAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            // the clears of the load ops write the attachments before any draw, the depth one in the tests
+            .srcStageMask    = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+            .srcAccessMask   = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
             .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT
         },
         {
@@ -539,13 +739,19 @@ static bool create_render_pass(vk_context *ctx) {
         .pDependencies   = subpass_dependencies
     };
 
-    CHECK_VK(vkCreateRenderPass(ctx->device, &render_pass_info, NULL, &ctx->render_pass));
+    CHECK_VK(vkCreateRenderPass(ctx->device, &render_pass_info, NULL, render_pass));
 
     return true;
 }
 
+// offscreen images are left ready to be copied out
+static bool create_render_pass(vk_context *ctx) {
+    return create_render_pass_vulkan(ctx, ctx->headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL :
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, &ctx->render_pass);
+}
+
 static bool create_framebuffers(vk_context *ctx) {
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < ctx->swapchain_images_size; i++) {
         VkImageView attachments[] = { ctx->swapchain_views[i], ctx->depth_image.view };
         VkFramebufferCreateInfo framebuffer_info = {
             .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
@@ -554,8 +760,8 @@ static bool create_framebuffers(vk_context *ctx) {
             .renderPass      = ctx->render_pass,
             .attachmentCount = 2,
             .pAttachments    = attachments,
-            .width           = render_config.width,
-            .height          = render_config.height,
+            .width           = ctx->extent.width,
+            .height          = ctx->extent.height,
             .layers          = 1
         };
         CHECK_VK(vkCreateFramebuffer(ctx->device, &framebuffer_info, NULL, &ctx->framebuffers[i]));
@@ -580,10 +786,10 @@ static bool create_pipeline_cache(vk_context *ctx) {
 
 bool init_vulkan(vk_context *ctx, SDL_Window *window) {
     init_vk_context(ctx);
-    return init_vulkan_function_loader() &&
+    return init_vulkan_function_loader(ctx) &&
         load_global_functions() &&
         create_instance(ctx, window) &&
-        load_instance_vulkan_functions(ctx->instance) &&
+        load_instance_vulkan_functions(ctx->instance, !ctx->headless) &&
 
         #ifdef DEBUG
             setup_debug_callback(ctx) &&
@@ -593,31 +799,68 @@ bool init_vulkan(vk_context *ctx, SDL_Window *window) {
         enumerate_physical_devices(ctx) &&
         choose_suitable_graphics_gpu(ctx) &&
         create_device(ctx) &&
-        load_device_level_functions(ctx->device) &&
+        load_device_level_functions(ctx->device, !ctx->headless) &&
         init_queues(ctx) &&
         create_semaphores(ctx) &&
-        create_query_pools(ctx) &&
         create_command_pool(ctx) &&
         create_command_buffers(ctx) &&
         vk_init_allocator() &&
         vk_init_stage_manager() &&
+        vk_init_uniform_ring() &&
+        vk_init_descriptor_allocator() &&
+        vk_init_bindless() &&
         create_swapchain(ctx) &&
         get_depth_format(ctx) &&
         create_render_targets(ctx) &&
         create_render_pass(ctx) &&
         create_pipeline_cache(ctx) &&
         create_framebuffers(ctx) &&
+        init_vertex_packing() &&
         init_ren_pm() &&
         init_vertex_cache();
 }
 
+static void destroy_retired(vk_context *ctx, const vk_retired_handles *h) {
+    if (h->framebuffer) {
+        vkDestroyFramebuffer(ctx->device, h->framebuffer, NULL);
+    }
+    if (h->view) {
+        vkDestroyImageView(ctx->device, h->view, NULL);
+    }
+    if (h->image) {
+        vkDestroyImage(ctx->device, h->image, NULL);
+    }
+    if (h->sampler) {
+        vkDestroySampler(ctx->device, h->sampler, NULL);
+    }
+    if (h->swapchain) {
+        vkDestroySwapchainKHR(ctx->device, h->swapchain, NULL);
+    }
+    if (h->semaphore) {
+        vkDestroySemaphore(ctx->device, h->semaphore, NULL);
+    }
+}
+
+static void destroy_all_retired(vk_context *ctx) {
+    for (uint32_t i = 0; i < ctx->retired_size; i++) {
+        destroy_retired(ctx, &ctx->retired[i]);
+    }
+    ctx->retired_size = 0;
+}
+
 void shutdown_vulkan(vk_context *ctx) {
     destroy_vertex_cache();
     destroy_ren_pm();
+    if (ctx->device) {
+        destroy_all_retired(ctx);
+    }
+    vk_destroy_bindless();
+    vk_destroy_descriptor_allocator();
+    vk_destroy_uniform_ring();
     vk_destroy_stage_manager();
     vk_destroy_allocator();
     if (vkDestroyFramebuffer) {
-        for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+        for (size_t i = 0; i < MAX_SWAPCHAIN_IMAGES; i++) {
             if (ctx->framebuffers[i]) {
                 vkDestroyFramebuffer(ctx->device, ctx->framebuffers[i], NULL);
             }
@@ -630,8 +873,11 @@ void shutdown_vulkan(vk_context *ctx) {
         vkDestroyRenderPass(ctx->device, ctx->render_pass, NULL);
     }
     destroy_image(&ctx->depth_image);
-    if (vkDestroyImageView) {
-        for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < MAX_SWAPCHAIN_IMAGES; i++) {
+        destroy_image(&ctx->offscreen_images[i]);
+    }
+    if (vkDestroyImageView && !ctx->headless) {
+        for (size_t i = 0; i < MAX_SWAPCHAIN_IMAGES; i++) {
             if (ctx->swapchain_views[i]) {
                 vkDestroyImageView(ctx->device, ctx->swapchain_views[i], NULL);
             }
@@ -641,34 +887,42 @@ void shutdown_vulkan(vk_context *ctx) {
         vkDestroySwapchainKHR(ctx->device, ctx->swapchain, NULL);
     }
     if (vkDestroyFence) {
-        for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             if (ctx->command_buffer_fences[i]) {
                 vkDestroyFence(ctx->device, ctx->command_buffer_fences[i], NULL);
             }
         }
     }
     if (vkFreeCommandBuffers && ctx->command_buffers[0]) {
-        vkFreeCommandBuffers(ctx->device, ctx->command_pool, NUM_FRAME_DATA, ctx->command_buffers);
+        vkFreeCommandBuffers(ctx->device, ctx->command_pool, ctx->frames_in_flight, ctx->command_buffers);
     }
     if (vkDestroyCommandPool && ctx->command_pool) {
         vkDestroyCommandPool(ctx->device, ctx->command_pool, NULL);
     }
-    if (vkDestroyQueryPool) {
-        for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
-            if (ctx->query_pools[i]) {
-                vkDestroyQueryPool(ctx->device, ctx->query_pools[i], NULL);
-            }
-        }
+    if (vkFreeCommandBuffers && ctx->compute_command_buffers[0]) {
+        vkFreeCommandBuffers(ctx->device, ctx->compute_command_pool, ctx->frames_in_flight,
+            ctx->compute_command_buffers);
+    }
+    if (vkDestroyCommandPool && ctx->compute_command_pool) {
+        vkDestroyCommandPool(ctx->device, ctx->compute_command_pool, NULL);
     }
     if (vkDestroySemaphore) {
-        for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             if (ctx->acquire_semaphores[i]) {
                 vkDestroySemaphore(ctx->device, ctx->acquire_semaphores[i], NULL);
             }
+        }
+        for (size_t i = 0; i < MAX_SWAPCHAIN_IMAGES; i++) {
             if (ctx->render_complete_semaphores[i]) {
                 vkDestroySemaphore(ctx->device, ctx->render_complete_semaphores[i], NULL);
             }
         }
+        if (ctx->graphics_timeline) {
+            vkDestroySemaphore(ctx->device, ctx->graphics_timeline, NULL);
+        }
+        if (ctx->compute_timeline) {
+            vkDestroySemaphore(ctx->device, ctx->compute_timeline, NULL);
+        }
     }
     if (ctx->gpus_size > 0) {
         for (size_t i = 0; i < ctx->gpus_size; i++) {
@@ -692,6 +946,126 @@ void shutdown_vulkan(vk_context *ctx) {
     if (ctx->instance && vkDestroyInstance) {
         vkDestroyInstance(ctx->instance, NULL);
     }
+    void *vulkan_library = ctx->vulkan_library;
     init_vk_context(ctx);
-    SDL_Vulkan_UnloadLibrary();
+    if (vulkan_library) {
+        SDL_UnloadObject(vulkan_library);
+    } else {
+        SDL_Vulkan_UnloadLibrary();
+    }
+}
+
+void retire_handles_vulkan(vk_context *ctx, const vk_retired_handles *handles) {
+    if (ctx->retired_size == MAX_RETIRED_HANDLES) {
+        log_warning("Too many retired handles, waiting for the device");
+        vkDeviceWaitIdle(ctx->device);
+        destroy_all_retired(ctx);
+    }
+    vk_retired_handles *h = &ctx->retired[ctx->retired_size++];
+    *h = *handles;
+    h->frame = ctx->current_frame;
+}
+
+void retire_image_vulkan(vk_context *ctx, vk_image *image) {
+    if (image->is_swapchain_image) {
+        return;
+    }
+    vk_remove_bindless(BINDLESS_SAMPLED_IMAGES, image->bindless_index);
+    if (image->image) {
+        vk_free_allocation(&image->allocation);
+    }
+    vk_retired_handles handles = {
+        .image = image->image,
+        .view = image->view,
+        .sampler = image->sampler
+    };
+    retire_handles_vulkan(ctx, &handles);
+    init_image(image);
+}
+
+void release_retired_vulkan(vk_context *ctx, uint32_t frame) {
+    ctx->current_frame = frame % ctx->frames_in_flight;
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < ctx->retired_size; i++) {
+        if (ctx->retired[i].frame == ctx->current_frame) {
+            destroy_retired(ctx, &ctx->retired[i]);
+        } else {
+            ctx->retired[kept++] = ctx->retired[i];
+        }
+    }
+    ctx->retired_size = kept;
+}
+
+bool submit_compute_vulkan(vk_context *ctx, VkCommandBuffer command_buffer, uint64_t wait_value) {
+    uint64_t signal_value = ctx->compute_timeline_value + 1;
+    VkTimelineSemaphoreSubmitInfoKHR timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = wait_value > 0 ? 1 : 0,
+        .pWaitSemaphoreValues = &wait_value,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signal_value
+    };
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = wait_value > 0 ? 1 : 0,
+        .pWaitSemaphores = &ctx->graphics_timeline,
+        .pWaitDstStageMask = &wait_stage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &command_buffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &ctx->compute_timeline
+    };
+    CHECK_VK(vkQueueSubmit(ctx->compute_queue, 1, &submit_info, VK_NULL_HANDLE));
+    ctx->compute_timeline_value = signal_value;
+
+    return true;
+}
+
+bool recreate_swapchain_vulkan(vk_context *ctx, bool *recreated) {
+    *recreated = false;
+    if (ctx->headless) {
+        return true;
+    }
+
+    gpu_info *gpu = &ctx->gpus[ctx->selected_gpu];
+    CHECK_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(gpu->device, ctx->surface, &gpu->surface_caps));
+    // a minimized window, the old swapchain stays until there is something to present to again
+    if (gpu->surface_caps.currentExtent.width == 0 || gpu->surface_caps.currentExtent.height == 0) {
+        return true;
+    }
+
+    // the frames in flight still render to these, nothing is waited on
+    for (uint32_t i = 0; i < ctx->swapchain_images_size; i++) {
+        vk_retired_handles handles = {
+            .framebuffer = ctx->framebuffers[i],
+            .view = ctx->swapchain_views[i],
+            .semaphore = ctx->render_complete_semaphores[i]
+        };
+        retire_handles_vulkan(ctx, &handles);
+        ctx->framebuffers[i] = VK_NULL_HANDLE;
+        ctx->swapchain_views[i] = VK_NULL_HANDLE;
+        ctx->render_complete_semaphores[i] = VK_NULL_HANDLE;
+        ctx->swapchain_images[i] = VK_NULL_HANDLE;
+    }
+    ctx->swapchain_images_size = 0;
+    retire_image_vulkan(ctx, &ctx->depth_image);
+
+    vk_retired_handles old_swapchain = {
+        .swapchain = ctx->swapchain
+    };
+    if (!create_swapchain(ctx)) {
+        return false;
+    }
+    retire_handles_vulkan(ctx, &old_swapchain);
+
+    *recreated = get_swapchain_images(ctx) &&
+        create_depth_image(ctx) &&
+        create_framebuffers(ctx);
+
+    return *recreated;
 }
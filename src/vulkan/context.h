@@ -8,7 +8,26 @@
 #include "./config.h"
 #include "./image.h"
 
+// enough for a few swapchain recreations in a row, past that the device is waited on instead
+#define MAX_RETIRED_HANDLES 256
+
+// replaced while frames in flight may still use them, any handle left null is skipped
+typedef struct vk_retired_handles {
+    VkSwapchainKHR swapchain;
+    VkFramebuffer framebuffer;
+    VkImage image;
+    VkImageView view;
+    VkSampler sampler;
+    VkSemaphore semaphore;
+    // the frame slot they were retired in, they are destroyed when it comes around again
+    uint32_t frame;
+} vk_retired_handles;
+
 typedef struct vk_context {
+    // renders into offscreen color images instead of a window surface and swapchain
+    bool headless;
+    void *vulkan_library;
+
     VkInstance instance;
     VkSurfaceKHR surface;
     VkDevice device;
@@ -23,23 +42,42 @@ typedef struct vk_context {
     VkQueue graphics_queue;
     VkQueue present_queue;
 
-    VkSemaphore acquire_semaphores[NUM_FRAME_DATA];
-    VkSemaphore render_complete_semaphores[NUM_FRAME_DATA];
-
-    VkQueryPool query_pools[NUM_FRAME_DATA];
+    // a compute-only queue ordered against graphics by two timeline semaphores, each holding the value of the
+    // last submit to its queue
+    bool async_compute;
+    uint32_t compute_family_index;
+    VkQueue compute_queue;
+    VkCommandPool compute_command_pool;
+    VkCommandBuffer compute_command_buffers[MAX_FRAMES_IN_FLIGHT];
+    VkSemaphore graphics_timeline;
+    VkSemaphore compute_timeline;
+    uint64_t graphics_timeline_value;
+    uint64_t compute_timeline_value;
+
+    // per frame resources are only created for the frames in flight, independent of the swapchain
+    uint32_t frames_in_flight;
+
+    VkSemaphore acquire_semaphores[MAX_FRAMES_IN_FLIGHT];
+    // per swapchain image, the presentation waiting on one is only known to be done once its image is acquired again
+    VkSemaphore render_complete_semaphores[MAX_SWAPCHAIN_IMAGES];
 
     VkCommandPool command_pool;
-    VkCommandBuffer command_buffers[NUM_FRAME_DATA];
-    VkFence command_buffer_fences[NUM_FRAME_DATA];
+    VkCommandBuffer command_buffers[MAX_FRAMES_IN_FLIGHT];
+    VkFence command_buffer_fences[MAX_FRAMES_IN_FLIGHT];
 
     VkSwapchainKHR swapchain;
-    VkImage swapchain_images[NUM_FRAME_DATA];
-    VkImageView swapchain_views[NUM_FRAME_DATA];
+    uint32_t swapchain_images_size;
+    VkImage swapchain_images[MAX_SWAPCHAIN_IMAGES];
+    VkImageView swapchain_views[MAX_SWAPCHAIN_IMAGES];
+    // backing the swapchain images and views of a headless context, one per frame in flight
+    vk_image offscreen_images[MAX_SWAPCHAIN_IMAGES];
 
     bool supersampling;
     VkSampleCountFlagBits sample_count;
 
     vk_image depth_image;
+    // the occlusion culling builds its pyramid from the depth, otherwise it is transient and never stored
+    bool depth_sampled;
 
     VkSurfaceFormatKHR surface_format;
     VkPresentModeKHR present_mode;
@@ -48,10 +86,20 @@ typedef struct vk_context {
     VkFormat depth_format;
     VkRenderPass render_pass;
 
-    VkFramebuffer framebuffers[NUM_FRAME_DATA];
+    VkFramebuffer framebuffers[MAX_SWAPCHAIN_IMAGES];
 
     VkPipelineCache pipeline_cache;
 
+    vk_retired_handles retired[MAX_RETIRED_HANDLES];
+    uint32_t retired_size;
+    uint32_t current_frame;
+
+    // optional features, only what the device supports is enabled
+    VkPhysicalDeviceFeatures enabled_features;
+    bool draw_indirect_count;
+    // requested by the renderer config and supported by the device
+    bool bindless;
+
     #ifdef DEBUG
         VkDebugReportCallbackEXT debug_callback;
     #endif
@@ -60,7 +108,21 @@ typedef struct vk_context {
 extern vk_context context;
 
 void init_vk_context(vk_context *ctx);
+// window is NULL for a headless context
 bool init_vulkan(vk_context *ctx, SDL_Window *window);
 void shutdown_vulkan(vk_context *ctx);
 
+void retire_handles_vulkan(vk_context *ctx, const vk_retired_handles *handles);
+// the image, view and sampler of a vk_image, its memory goes to the allocator garbage
+void retire_image_vulkan(vk_context *ctx, vk_image *image);
+// after the fence of the frame slot, destroys what was retired the last time it was current
+void release_retired_vulkan(vk_context *ctx, uint32_t frame);
+// compatible with ctx->render_pass, both attachments are cleared as they are loaded so a tiler never reads back
+// what the last frame left
+bool create_render_pass_vulkan(vk_context *ctx, VkImageLayout color_final_layout, VkRenderPass *render_pass);
+// signals the next compute timeline value, after the graphics timeline reached wait_value unless it is 0
+bool submit_compute_vulkan(vk_context *ctx, VkCommandBuffer command_buffer, uint64_t wait_value);
+// in place with the old swapchain handed over, recreated is false while the surface has no area
+bool recreate_swapchain_vulkan(vk_context *ctx, bool *recreated);
+
 #endif // VULKAN_CONTEXT_H
@@ -0,0 +1,287 @@
+#include "./bindless.h"
+
+#include "../functions/functions.h"
+#include "../tools/tools.h"
+#include "../context.h"
+#include "../../utils/heap.h"
+#include "../../logger/logger.h"
+
+bindless_table bindless_descriptors;
+
+static const VkDescriptorType binding_types[BINDLESS_BINDINGS_SIZE] = {
+    VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+};
+
+static void init_bindless_slots(bindless_slots *s) {
+    s->capacity = 0;
+    s->next = 0;
+    s->free = NULL;
+    s->free_size = 0;
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        s->retired[i] = NULL;
+        s->retired_size[i] = 0;
+    }
+}
+
+static bool alloc_bindless_slots(bindless_slots *s, uint32_t capacity, uint32_t frames_size) {
+    s->capacity = capacity;
+    s->free = mem_alloc(sizeof(uint32_t) * capacity);
+    CHECK_ALLOC(s->free, "Unable to allocate the free bindless indices");
+    for (uint32_t i = 0; i < frames_size; i++) {
+        s->retired[i] = mem_alloc(sizeof(uint32_t) * capacity);
+        CHECK_ALLOC(s->retired[i], "Unable to allocate the retired bindless indices");
+    }
+
+    return true;
+}
+
+static uint32_t take_slot(bindless_slots *s) {
+    if (s->free_size > 0) {
+        return s->free[--s->free_size];
+    }
+    if (s->next < s->capacity) {
+        return s->next++;
+    }
+    return BINDLESS_NONE;
+}
+
+static void free_bindless_slots(bindless_slots *s) {
+    if (s->free) {
+        mem_free(s->free);
+    }
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (s->retired[i]) {
+            mem_free(s->retired[i]);
+        }
+    }
+    init_bindless_slots(s);
+}
+
+void init_bindless_table(bindless_table *t) {
+    t->pool = VK_NULL_HANDLE;
+    t->layout = VK_NULL_HANDLE;
+    t->set = VK_NULL_HANDLE;
+    for (size_t i = 0; i < BINDLESS_BINDINGS_SIZE; i++) {
+        init_bindless_slots(&t->slots[i]);
+    }
+    t->frames_size = 0;
+    t->current_frame = 0;
+}
+
+static uint32_t min_limit(uint32_t a, uint32_t b) {
+    return a < b ? a : b;
+}
+
+static uint32_t clamp_capacity(uint32_t desired, uint32_t per_stage, uint32_t per_set) {
+    uint32_t limit = min_limit(per_stage, per_set);
+    limit = limit > BINDLESS_RESERVED_DESCRIPTORS ? limit - BINDLESS_RESERVED_DESCRIPTORS : 0;
+    return desired < limit ? desired : limit;
+}
+
+static bool create_layout(bindless_table *t) {
+    VkDescriptorSetLayoutBinding layout_bindings[BINDLESS_BINDINGS_SIZE];
+    VkDescriptorBindingFlagsEXT binding_flags[BINDLESS_BINDINGS_SIZE];
+    for (uint32_t i = 0; i < BINDLESS_BINDINGS_SIZE; i++) {
+        VkDescriptorSetLayoutBinding binding = {
+            .binding = i,
+            .descriptorType = binding_types[i],
+            .descriptorCount = t->slots[i].capacity,
+            .stageFlags = VK_SHADER_STAGE_ALL,
+            .pImmutableSamplers = NULL
+        };
+        layout_bindings[i] = binding;
+        binding_flags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flags_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
+        .pNext = NULL,
+        .bindingCount = BINDLESS_BINDINGS_SIZE,
+        .pBindingFlags = binding_flags
+    };
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &flags_info,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT,
+        .bindingCount = BINDLESS_BINDINGS_SIZE,
+        .pBindings = layout_bindings
+    };
+    CHECK_VK(vkCreateDescriptorSetLayout(context.device, &layout_info, NULL, &t->layout));
+
+    return true;
+}
+
+static bool create_set(bindless_table *t) {
+    VkDescriptorPoolSize pool_sizes[BINDLESS_BINDINGS_SIZE];
+    for (uint32_t i = 0; i < BINDLESS_BINDINGS_SIZE; i++) {
+        pool_sizes[i].type = binding_types[i];
+        pool_sizes[i].descriptorCount = t->slots[i].capacity;
+    }
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT,
+        .maxSets = 1,
+        .poolSizeCount = BINDLESS_BINDINGS_SIZE,
+        .pPoolSizes = pool_sizes
+    };
+    CHECK_VK(vkCreateDescriptorPool(context.device, &pool_info, NULL, &t->pool));
+
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = NULL,
+        .descriptorPool = t->pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &t->layout
+    };
+    CHECK_VK(vkAllocateDescriptorSets(context.device, &alloc_info, &t->set));
+
+    return true;
+}
+
+bool create_bindless_table(bindless_table *t, uint32_t frames_size) {
+    init_bindless_table(t);
+    t->frames_size = frames_size;
+
+    // the layout is update-after-bind, its own limits apply, combined image samplers count as samplers too
+    const VkPhysicalDeviceDescriptorIndexingPropertiesEXT *limits = &context.gpus[context.selected_gpu].indexing_props;
+    uint32_t images = clamp_capacity(BINDLESS_MAX_SAMPLED_IMAGES,
+        min_limit(limits->maxPerStageDescriptorUpdateAfterBindSampledImages,
+            limits->maxPerStageDescriptorUpdateAfterBindSamplers),
+        min_limit(limits->maxDescriptorSetUpdateAfterBindSampledImages,
+            limits->maxDescriptorSetUpdateAfterBindSamplers));
+    uint32_t buffers = clamp_capacity(BINDLESS_MAX_STORAGE_BUFFERS,
+        limits->maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+        limits->maxDescriptorSetUpdateAfterBindStorageBuffers);
+    if (images == 0 || buffers == 0) {
+        log_error("The descriptor limits of the device leave no room for a bindless table");
+        return false;
+    }
+
+    bool success = alloc_bindless_slots(&t->slots[BINDLESS_SAMPLED_IMAGES], images, frames_size) &&
+        alloc_bindless_slots(&t->slots[BINDLESS_STORAGE_BUFFERS], buffers, frames_size) &&
+        create_layout(t) &&
+        create_set(t);
+    if (success) {
+        log_info("Bindless table of %u images and %u storage buffers", images, buffers);
+    }
+
+    return success;
+}
+
+void start_frame_bindless_table(bindless_table *t, uint32_t frame) {
+    t->current_frame = frame % t->frames_size;
+    for (size_t i = 0; i < BINDLESS_BINDINGS_SIZE; i++) {
+        bindless_slots *s = &t->slots[i];
+        uint32_t *retired = s->retired[t->current_frame];
+        for (uint32_t j = 0; j < s->retired_size[t->current_frame]; j++) {
+            s->free[s->free_size++] = retired[j];
+        }
+        s->retired_size[t->current_frame] = 0;
+    }
+}
+
+static void write_descriptor(bindless_table *t, bindless_binding binding, uint32_t index,
+    const VkDescriptorImageInfo *image_info, const VkDescriptorBufferInfo *buffer_info)
+{
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = NULL,
+        .dstSet = t->set,
+        .dstBinding = binding,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = binding_types[binding],
+        .pImageInfo = image_info,
+        .pBufferInfo = buffer_info,
+        .pTexelBufferView = NULL
+    };
+    vkUpdateDescriptorSets(context.device, 1, &write, 0, NULL);
+}
+
+uint32_t add_image_bindless_table(bindless_table *t, VkSampler sampler, VkImageView view, VkImageLayout layout) {
+    uint32_t index = take_slot(&t->slots[BINDLESS_SAMPLED_IMAGES]);
+    if (index == BINDLESS_NONE) {
+        log_error("Out of bindless image slots, %u in use", t->slots[BINDLESS_SAMPLED_IMAGES].capacity);
+        return BINDLESS_NONE;
+    }
+
+    VkDescriptorImageInfo image_info = {
+        .sampler = sampler,
+        .imageView = view,
+        .imageLayout = layout
+    };
+    write_descriptor(t, BINDLESS_SAMPLED_IMAGES, index, &image_info, NULL);
+
+    return index;
+}
+
+uint32_t add_buffer_bindless_table(bindless_table *t, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    uint32_t index = take_slot(&t->slots[BINDLESS_STORAGE_BUFFERS]);
+    if (index == BINDLESS_NONE) {
+        log_error("Out of bindless buffer slots, %u in use", t->slots[BINDLESS_STORAGE_BUFFERS].capacity);
+        return BINDLESS_NONE;
+    }
+
+    VkDescriptorBufferInfo buffer_info = {
+        .buffer = buffer,
+        .offset = offset,
+        .range = range
+    };
+    write_descriptor(t, BINDLESS_STORAGE_BUFFERS, index, NULL, &buffer_info);
+
+    return index;
+}
+
+void remove_bindless_table(bindless_table *t, bindless_binding binding, uint32_t index) {
+    bindless_slots *s = &t->slots[binding];
+    if (index == BINDLESS_NONE || index >= s->next) {
+        return;
+    }
+    s->retired[t->current_frame][s->retired_size[t->current_frame]++] = index;
+}
+
+void destroy_bindless_table(bindless_table *t) {
+    if (t->pool) {
+        vkDestroyDescriptorPool(context.device, t->pool, NULL);
+    }
+    if (t->layout) {
+        vkDestroyDescriptorSetLayout(context.device, t->layout, NULL);
+    }
+    for (size_t i = 0; i < BINDLESS_BINDINGS_SIZE; i++) {
+        free_bindless_slots(&t->slots[i]);
+    }
+    init_bindless_table(t);
+}
+
+bool vk_init_bindless() {
+    init_bindless_table(&bindless_descriptors);
+    return !context.bindless || create_bindless_table(&bindless_descriptors, context.frames_in_flight);
+}
+
+void vk_start_frame_bindless(uint32_t frame) {
+    if (context.bindless) {
+        start_frame_bindless_table(&bindless_descriptors, frame);
+    }
+}
+
+uint32_t vk_add_bindless_image(VkSampler sampler, VkImageView view, VkImageLayout layout) {
+    return context.bindless ? add_image_bindless_table(&bindless_descriptors, sampler, view, layout) : BINDLESS_NONE;
+}
+
+uint32_t vk_add_bindless_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+    return context.bindless ? add_buffer_bindless_table(&bindless_descriptors, buffer, offset, range) : BINDLESS_NONE;
+}
+
+void vk_remove_bindless(bindless_binding binding, uint32_t index) {
+    if (context.bindless) {
+        remove_bindless_table(&bindless_descriptors, binding, index);
+    }
+}
+
+void vk_destroy_bindless() {
+    destroy_bindless_table(&bindless_descriptors);
+}
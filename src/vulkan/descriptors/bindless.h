@@ -0,0 +1,67 @@
+#ifndef BINDLESS_H
+#define BINDLESS_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../config.h"
+
+// upper bounds, both are also clamped to the update-after-bind limits of the device
+#define BINDLESS_MAX_SAMPLED_IMAGES  4096
+#define BINDLESS_MAX_STORAGE_BUFFERS 1024
+// left to the other sets of a pipeline layout, the per-stage limits count every set
+#define BINDLESS_RESERVED_DESCRIPTORS 8
+
+#define BINDLESS_NONE UINT32_MAX
+
+typedef enum bindless_binding {
+    BINDLESS_SAMPLED_IMAGES,
+    BINDLESS_STORAGE_BUFFERS,
+    BINDLESS_BINDINGS_SIZE
+} bindless_binding;
+
+// indices of one binding, a removed index is reused once no frame in flight can still read it
+typedef struct bindless_slots {
+    uint32_t capacity;
+    // never handed out at or past this
+    uint32_t next;
+    uint32_t *free;
+    uint32_t free_size;
+    uint32_t *retired[MAX_FRAMES_IN_FLIGHT];
+    uint32_t retired_size[MAX_FRAMES_IN_FLIGHT];
+} bindless_slots;
+
+// a single set bound as set 1 of bindless programs, shaders index its arrays with what the draw gives them
+// the culling pass reads the depth pyramids through it, sampled images register themselves when allocated
+typedef struct bindless_table {
+    VkDescriptorPool pool;
+    VkDescriptorSetLayout layout;
+    VkDescriptorSet set;
+    bindless_slots slots[BINDLESS_BINDINGS_SIZE];
+    uint32_t frames_size;
+    uint32_t current_frame;
+} bindless_table;
+
+void init_bindless_table(bindless_table *t);
+bool create_bindless_table(bindless_table *t, uint32_t frames_size);
+// after the fence of the frame slot, the indices it removed can be handed out again
+void start_frame_bindless_table(bindless_table *t, uint32_t frame);
+// written with update-after-bind, the index is valid for the draws recorded from now on
+uint32_t add_image_bindless_table(bindless_table *t, VkSampler sampler, VkImageView view, VkImageLayout layout);
+uint32_t add_buffer_bindless_table(bindless_table *t, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+// the descriptor is left as it is, partially bound arrays allow stale entries nothing reads
+void remove_bindless_table(bindless_table *t, bindless_binding binding, uint32_t index);
+void destroy_bindless_table(bindless_table *t);
+
+extern bindless_table bindless_descriptors;
+
+// all of these do nothing unless context.bindless is set
+bool vk_init_bindless();
+void vk_start_frame_bindless(uint32_t frame);
+uint32_t vk_add_bindless_image(VkSampler sampler, VkImageView view, VkImageLayout layout);
+uint32_t vk_add_bindless_buffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+void vk_remove_bindless(bindless_binding binding, uint32_t index);
+void vk_destroy_bindless();
+
+#endif // BINDLESS_H
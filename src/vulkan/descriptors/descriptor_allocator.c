@@ -0,0 +1,338 @@
+#include "./descriptor_allocator.h"
+
+#include "../functions/functions.h"
+#include "../tools/tools.h"
+#include "../context.h"
+#include "../../utils/heap.h"
+#include "../../logger/logger.h"
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME        1099511628211ULL
+
+descriptor_allocator descriptor_alloc;
+
+// the descriptors of DESCRIPTOR_POOL_SETS typical sets, a set of the renderer has at most a few of each
+static const VkDescriptorPoolSize pool_sizes[] = {
+    {
+        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorCount = DESCRIPTOR_POOL_SETS
+    },
+    {
+        .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .descriptorCount = DESCRIPTOR_POOL_SETS
+    },
+    {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = DESCRIPTOR_POOL_SETS
+    },
+    {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+        .descriptorCount = DESCRIPTOR_POOL_SETS
+    },
+    {
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = DESCRIPTOR_POOL_SETS * 4
+    },
+    {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+        .descriptorCount = DESCRIPTOR_POOL_SETS * 2
+    }
+};
+
+void init_descriptor_set_desc(descriptor_set_desc *d, VkDescriptorSetLayout layout) {
+    d->layout = layout;
+    d->bindings_size = 0;
+}
+
+static descriptor_binding *add_binding(descriptor_set_desc *d, VkDescriptorType type) {
+    if (d->bindings_size >= MAX_DESCRIPTOR_SET_BINDINGS) {
+        log_error("No room for another descriptor binding");
+        return NULL;
+    }
+    descriptor_binding *b = &d->bindings[d->bindings_size++];
+    b->type = type;
+    b->buffer = VK_NULL_HANDLE;
+    b->offset = 0;
+    b->range = 0;
+    b->sampler = VK_NULL_HANDLE;
+    b->view = VK_NULL_HANDLE;
+    b->layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    return b;
+}
+
+bool add_buffer_descriptor_set_desc(descriptor_set_desc *d, VkDescriptorType type, VkBuffer buffer,
+    VkDeviceSize offset, VkDeviceSize range)
+{
+    descriptor_binding *b = add_binding(d, type);
+    if (!b) {
+        return false;
+    }
+    b->buffer = buffer;
+    b->offset = offset;
+    b->range = range;
+
+    return true;
+}
+
+bool add_image_descriptor_set_desc(descriptor_set_desc *d, VkDescriptorType type, VkSampler sampler,
+    VkImageView view, VkImageLayout layout)
+{
+    descriptor_binding *b = add_binding(d, type);
+    if (!b) {
+        return false;
+    }
+    b->sampler = sampler;
+    b->view = view;
+    b->layout = layout;
+
+    return true;
+}
+
+static uint64_t hash_value(uint64_t hash, uint64_t value) {
+    for (uint32_t i = 0; i < 8; i++) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// field by field, the padding of the desc is never initialized
+static uint64_t hash_desc(const descriptor_set_desc *d) {
+    uint64_t hash = hash_value(FNV_OFFSET_BASIS, (uint64_t) (uintptr_t) d->layout);
+    for (uint32_t i = 0; i < d->bindings_size; i++) {
+        const descriptor_binding *b = &d->bindings[i];
+        hash = hash_value(hash, b->type);
+        hash = hash_value(hash, (uint64_t) (uintptr_t) b->buffer);
+        hash = hash_value(hash, b->offset);
+        hash = hash_value(hash, b->range);
+        hash = hash_value(hash, (uint64_t) (uintptr_t) b->sampler);
+        hash = hash_value(hash, (uint64_t) (uintptr_t) b->view);
+        hash = hash_value(hash, b->layout);
+    }
+    return hash;
+}
+
+static bool equal_desc(const descriptor_set_desc *a, const descriptor_set_desc *b) {
+    if (a->layout != b->layout || a->bindings_size != b->bindings_size) {
+        return false;
+    }
+    for (uint32_t i = 0; i < a->bindings_size; i++) {
+        const descriptor_binding *x = &a->bindings[i], *y = &b->bindings[i];
+        bool same = x->type == y->type && x->buffer == y->buffer && x->offset == y->offset &&
+            x->range == y->range && x->sampler == y->sampler && x->view == y->view && x->layout == y->layout;
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void init_descriptor_allocator_frame(descriptor_allocator_frame *f) {
+    for (size_t i = 0; i < MAX_DESCRIPTOR_POOLS; i++) {
+        f->pools[i] = VK_NULL_HANDLE;
+    }
+    f->pools_size = 0;
+    f->current_pool = 0;
+    f->cache = NULL;
+    f->cache_size = 0;
+}
+
+static void clear_cache(descriptor_allocator_frame *f) {
+    for (uint32_t i = 0; i < DESCRIPTOR_CACHE_SIZE; i++) {
+        f->cache[i].set = VK_NULL_HANDLE;
+    }
+    f->cache_size = 0;
+}
+
+void init_descriptor_allocator(descriptor_allocator *a) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        init_descriptor_allocator_frame(&a->frames[i]);
+    }
+    a->frames_size = 0;
+    a->current_frame = 0;
+    a->counters.allocated = 0;
+    a->counters.reused = 0;
+    a->counters.pools = 0;
+}
+
+static bool create_pool(descriptor_allocator_frame *f) {
+    if (f->pools_size >= MAX_DESCRIPTOR_POOLS) {
+        log_error("Out of descriptor pools, %u sets each", DESCRIPTOR_POOL_SETS);
+        return false;
+    }
+
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .maxSets = DESCRIPTOR_POOL_SETS,
+        .poolSizeCount = sizeof(pool_sizes) / sizeof(VkDescriptorPoolSize),
+        .pPoolSizes = pool_sizes
+    };
+    CHECK_VK(vkCreateDescriptorPool(context.device, &pool_info, NULL, &f->pools[f->pools_size]));
+    f->pools_size++;
+
+    return true;
+}
+
+bool create_descriptor_allocator(descriptor_allocator *a, uint32_t frames_size) {
+    init_descriptor_allocator(a);
+    a->frames_size = frames_size;
+
+    for (uint32_t i = 0; i < frames_size; i++) {
+        descriptor_allocator_frame *f = &a->frames[i];
+        f->cache = mem_alloc(sizeof(descriptor_cache_entry) * DESCRIPTOR_CACHE_SIZE);
+        CHECK_ALLOC(f->cache, "Unable to allocate the descriptor set cache");
+        clear_cache(f);
+        if (!create_pool(f)) {
+            return false;
+        }
+    }
+    a->counters.pools = frames_size;
+
+    return true;
+}
+
+bool start_frame_descriptor_allocator(descriptor_allocator *a, uint32_t frame) {
+    a->current_frame = frame % a->frames_size;
+    descriptor_allocator_frame *f = &a->frames[a->current_frame];
+
+    // the chain stays as long as the heaviest frame needed it
+    for (uint32_t i = 0; i < f->pools_size; i++) {
+        CHECK_VK(vkResetDescriptorPool(context.device, f->pools[i], 0));
+    }
+    f->current_pool = 0;
+    clear_cache(f);
+
+    a->counters.allocated = 0;
+    a->counters.reused = 0;
+
+    return true;
+}
+
+static bool allocate_set(descriptor_allocator *a, descriptor_allocator_frame *f, VkDescriptorSetLayout layout,
+    VkDescriptorSet *set)
+{
+    for (;;) {
+        if (f->current_pool == f->pools_size) {
+            if (!create_pool(f)) {
+                return false;
+            }
+            a->counters.pools++;
+            log_debug("Descriptor pools of frame slot %u grown to %u", a->current_frame, f->pools_size);
+        }
+
+        VkDescriptorSetAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = NULL,
+            .descriptorPool = f->pools[f->current_pool],
+            .descriptorSetCount = 1,
+            .pSetLayouts = &layout
+        };
+        VkResult result = vkAllocateDescriptorSets(context.device, &alloc_info, set);
+        if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+            f->current_pool++;
+            continue;
+        }
+        CHECK_VK(result);
+        a->counters.allocated++;
+
+        return true;
+    }
+}
+
+static void write_set(VkDescriptorSet set, const descriptor_set_desc *desc) {
+    VkDescriptorBufferInfo buffer_infos[MAX_DESCRIPTOR_SET_BINDINGS];
+    VkDescriptorImageInfo image_infos[MAX_DESCRIPTOR_SET_BINDINGS];
+    VkWriteDescriptorSet writes[MAX_DESCRIPTOR_SET_BINDINGS];
+
+    for (uint32_t i = 0; i < desc->bindings_size; i++) {
+        const descriptor_binding *b = &desc->bindings[i];
+        bool image = b->view != VK_NULL_HANDLE || b->sampler != VK_NULL_HANDLE;
+
+        buffer_infos[i].buffer = b->buffer;
+        buffer_infos[i].offset = b->offset;
+        buffer_infos[i].range = b->range;
+        image_infos[i].sampler = b->sampler;
+        image_infos[i].imageView = b->view;
+        image_infos[i].imageLayout = b->layout;
+
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = NULL,
+            .dstSet = set,
+            .dstBinding = i,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = b->type,
+            .pImageInfo = image ? &image_infos[i] : NULL,
+            .pBufferInfo = image ? NULL : &buffer_infos[i],
+            .pTexelBufferView = NULL
+        };
+        writes[i] = write;
+    }
+
+    vkUpdateDescriptorSets(context.device, desc->bindings_size, writes, 0, NULL);
+}
+
+bool get_descriptor_set_allocator(descriptor_allocator *a, const descriptor_set_desc *desc, VkDescriptorSet *set) {
+    descriptor_allocator_frame *f = &a->frames[a->current_frame];
+    uint64_t hash = hash_desc(desc);
+    uint32_t index = (uint32_t) hash & (DESCRIPTOR_CACHE_SIZE - 1);
+
+    for (; f->cache[index].set; index = (index + 1) & (DESCRIPTOR_CACHE_SIZE - 1)) {
+        const descriptor_cache_entry *entry = &f->cache[index];
+        if (entry->hash == hash && equal_desc(&entry->desc, desc)) {
+            *set = entry->set;
+            a->counters.reused++;
+            return true;
+        }
+    }
+
+    if (!allocate_set(a, f, desc->layout, set)) {
+        return false;
+    }
+    write_set(*set, desc);
+
+    // past three quarters probing gets long, the remaining sets of the frame are just not shared
+    if (f->cache_size < DESCRIPTOR_CACHE_SIZE / 4 * 3) {
+        descriptor_cache_entry *entry = &f->cache[index];
+        entry->hash = hash;
+        entry->desc = *desc;
+        entry->set = *set;
+        f->cache_size++;
+    }
+
+    return true;
+}
+
+void destroy_descriptor_allocator(descriptor_allocator *a) {
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        descriptor_allocator_frame *f = &a->frames[i];
+        for (uint32_t j = 0; j < f->pools_size; j++) {
+            vkDestroyDescriptorPool(context.device, f->pools[j], NULL);
+        }
+        if (f->cache) {
+            mem_free(f->cache);
+        }
+        init_descriptor_allocator_frame(f);
+    }
+    a->frames_size = 0;
+}
+
+bool vk_init_descriptor_allocator() {
+    return create_descriptor_allocator(&descriptor_alloc, context.frames_in_flight);
+}
+
+bool vk_start_frame_descriptor_allocator(uint32_t frame) {
+    return start_frame_descriptor_allocator(&descriptor_alloc, frame);
+}
+
+bool vk_get_descriptor_set(const descriptor_set_desc *desc, VkDescriptorSet *set) {
+    return get_descriptor_set_allocator(&descriptor_alloc, desc, set);
+}
+
+void vk_destroy_descriptor_allocator() {
+    destroy_descriptor_allocator(&descriptor_alloc);
+}
@@ -0,0 +1,85 @@
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../config.h"
+
+#define DESCRIPTOR_POOL_SETS        64
+#define MAX_DESCRIPTOR_POOLS        16
+#define MAX_DESCRIPTOR_SET_BINDINGS 8
+// per frame slot, a power of two
+#define DESCRIPTOR_CACHE_SIZE       256
+
+// one descriptor per binding, bound in order from binding 0
+typedef struct descriptor_binding {
+    VkDescriptorType type;
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    VkDeviceSize range;
+    VkSampler sampler;
+    VkImageView view;
+    VkImageLayout layout;
+} descriptor_binding;
+
+typedef struct descriptor_set_desc {
+    VkDescriptorSetLayout layout;
+    descriptor_binding bindings[MAX_DESCRIPTOR_SET_BINDINGS];
+    uint32_t bindings_size;
+} descriptor_set_desc;
+
+typedef struct descriptor_cache_entry {
+    uint64_t hash;
+    descriptor_set_desc desc;
+    VkDescriptorSet set;
+} descriptor_cache_entry;
+
+// the pools of a frame slot grow by chaining another one whenever the last is exhausted
+typedef struct descriptor_allocator_frame {
+    VkDescriptorPool pools[MAX_DESCRIPTOR_POOLS];
+    uint32_t pools_size;
+    uint32_t current_pool;
+
+    descriptor_cache_entry *cache;
+    uint32_t cache_size;
+} descriptor_allocator_frame;
+
+// sets of the current frame, pools of all frame slots
+typedef struct descriptor_allocator_counters {
+    uint32_t allocated;
+    uint32_t reused;
+    uint32_t pools;
+} descriptor_allocator_counters;
+
+// sets live until their frame slot comes around again, the same writes within a frame share a set
+typedef struct descriptor_allocator {
+    descriptor_allocator_frame frames[MAX_FRAMES_IN_FLIGHT];
+    uint32_t frames_size;
+    uint32_t current_frame;
+    descriptor_allocator_counters counters;
+} descriptor_allocator;
+
+void init_descriptor_set_desc(descriptor_set_desc *d, VkDescriptorSetLayout layout);
+bool add_buffer_descriptor_set_desc(descriptor_set_desc *d, VkDescriptorType type, VkBuffer buffer,
+    VkDeviceSize offset, VkDeviceSize range);
+bool add_image_descriptor_set_desc(descriptor_set_desc *d, VkDescriptorType type, VkSampler sampler,
+    VkImageView view, VkImageLayout layout);
+
+void init_descriptor_allocator(descriptor_allocator *a);
+bool create_descriptor_allocator(descriptor_allocator *a, uint32_t frames_size);
+// after the fence of the frame slot, resets its pools and forgets its sets
+bool start_frame_descriptor_allocator(descriptor_allocator *a, uint32_t frame);
+// main thread only, fails once the pools of the frame slot can not grow any further
+bool get_descriptor_set_allocator(descriptor_allocator *a, const descriptor_set_desc *desc, VkDescriptorSet *set);
+void destroy_descriptor_allocator(descriptor_allocator *a);
+
+extern descriptor_allocator descriptor_alloc;
+
+bool vk_init_descriptor_allocator();
+bool vk_start_frame_descriptor_allocator(uint32_t frame);
+bool vk_get_descriptor_set(const descriptor_set_desc *desc, VkDescriptorSet *set);
+void vk_destroy_descriptor_allocator();
+
+#endif // DESCRIPTOR_ALLOCATOR_H
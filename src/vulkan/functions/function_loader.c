@@ -11,6 +11,7 @@
 #define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name) PFN_##name name = NULL;
 #define DEVICE_LEVEL_VULKAN_FUNCTION(name) PFN_##name name = NULL;
 #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension) PFN_##name name = NULL;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_OPTIONAL_EXTENSION(name, extension) PFN_##name name = NULL;
 
 #include "list.inl"
 
@@ -37,7 +38,7 @@ bool load_global_functions() {
     return true;
 }
 
-bool load_instance_vulkan_functions(VkInstance instance)
+bool load_instance_vulkan_functions(VkInstance instance, bool presentation)
 {
     #define INSTANCE_LEVEL_VULKAN_FUNCTION(name)                              \
         name = (PFN_##name) vkGetInstanceProcAddr(instance, #name);           \
@@ -50,9 +51,11 @@ bool load_instance_vulkan_functions(VkInstance instance)
 
     #define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name)               \
         name = (PFN_##name) vkGetInstanceProcAddr(instance, #name);           \
-        if (name == NULL) {                                                   \
+        if (name == NULL && presentation) {                                   \
             log_error("Could not load instance level function: " #name);      \
             return false;                                                     \
+        } else if (name == NULL) {                                            \
+            log_debug("Instance level function not loaded: " #name);          \
         } else {                                                              \
             log_debug("Successfully loaded instance level function: " #name); \
         }
@@ -62,7 +65,7 @@ bool load_instance_vulkan_functions(VkInstance instance)
     return true;
 }
 
-bool load_device_level_functions(VkDevice device) {
+bool load_device_level_functions(VkDevice device, bool presentation) {
     #define DEVICE_LEVEL_VULKAN_FUNCTION(name)                                \
         name = (PFN_##name) vkGetDeviceProcAddr(device, #name);               \
         if (name == NULL) {                                                   \
@@ -74,13 +77,24 @@ bool load_device_level_functions(VkDevice device) {
 
     #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension)      \
         name = (PFN_##name) vkGetDeviceProcAddr(device, #name);               \
-        if (name == NULL) {                                                   \
+        if (name == NULL && presentation) {                                   \
             log_error("Could not load device level function: " #name);        \
             return false;                                                     \
+        } else if (name == NULL) {                                            \
+            log_debug("Device level function not loaded: " #name);            \
         } else {                                                              \
             log_debug("Successfully loaded device level function: " #name);   \
         }                                                                     \
 
+    // NULL when the extension is not supported or not enabled, callers check before use
+    #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_OPTIONAL_EXTENSION(name, extension) \
+        name = (PFN_##name) vkGetDeviceProcAddr(device, #name);               \
+        if (name == NULL) {                                                   \
+            log_info("Optional device level function not available: " #name); \
+        } else {                                                              \
+            log_debug("Successfully loaded device level function: " #name);   \
+        }
+
     #include "list.inl"
 
     return true;
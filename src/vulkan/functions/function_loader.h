@@ -7,8 +7,9 @@
 
 bool load_external_function(PFN_vkGetInstanceProcAddr vk_get_proc);
 bool load_global_functions();
-bool load_instance_vulkan_functions(VkInstance instance);
-bool load_device_level_functions(VkDevice device);
+// without presentation the surface and swapchain functions may stay NULL
+bool load_instance_vulkan_functions(VkInstance instance, bool presentation);
+bool load_device_level_functions(VkDevice device, bool presentation);
 
 #endif // VULKAN_FUNCTION_LOADER_H
 
@@ -9,6 +9,7 @@
 #define INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name) extern PFN_##name name;
 #define DEVICE_LEVEL_VULKAN_FUNCTION(name) extern PFN_##name name;
 #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(name, extension) extern PFN_##name name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_OPTIONAL_EXTENSION(name, extension) extern PFN_##name name;
 
 #include "list.inl"
 
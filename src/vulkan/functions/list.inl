@@ -23,7 +23,9 @@ GLOBAL_LEVEL_VULKAN_FUNCTION(vkCreateInstance)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkEnumeratePhysicalDevices)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkEnumerateDeviceExtensionProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceFeatures)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceFeatures2)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceProperties)
+INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceProperties2)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceQueueFamilyProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceMemoryProperties)
 INSTANCE_LEVEL_VULKAN_FUNCTION(vkGetPhysicalDeviceFormatProperties)
@@ -143,10 +145,15 @@ DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindIndexBuffer)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetLineWidth)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetDepthBias)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetBlendConstants)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetStencilReference)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdExecuteCommands)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdClearAttachments)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdResetQueryPool)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdWriteTimestamp)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBeginQuery)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdEndQuery)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexedIndirect)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBlitImage)
 
 #undef DEVICE_LEVEL_VULKAN_FUNCTION
 //
@@ -161,4 +168,11 @@ DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkQueuePresentKHR, VK_KHR_SWAPCHAIN_
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroySwapchainKHR, VK_KHR_SWAPCHAIN_EXTENSION_NAME)
 
 #undef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION
+//
+#ifndef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_OPTIONAL_EXTENSION
+    #define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_OPTIONAL_EXTENSION(function, extension)
+#endif
+
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_OPTIONAL_EXTENSION(vkCmdDrawIndexedIndirectCountKHR, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)
 
+#undef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_OPTIONAL_EXTENSION
@@ -21,6 +21,39 @@ void init_gpu_info(gpu_info *gpu) {
     gpu->present_modes_size = 0;	
 }
 
+static bool init_gpu_surface_props(gpu_info *gpu, VkSurfaceKHR surface) {
+    // Surface formats
+    uint32_t num_formats = 0;
+    CHECK_VK(vkGetPhysicalDeviceSurfaceFormatsKHR(gpu->device, surface,
+        &num_formats, NULL));
+    CHECK_VK_VAL(num_formats > 0, "No surface formats");
+
+    gpu->surface_formats = mem_alloc(num_formats * sizeof(VkSurfaceFormatKHR));
+    CHECK_ALLOC(gpu->surface_formats, "Allocation fail");
+
+    CHECK_VK(vkGetPhysicalDeviceSurfaceFormatsKHR(gpu->device, surface,
+        &num_formats, gpu->surface_formats));
+    CHECK_VK_VAL(num_formats > 0, "No surface formats");
+    gpu->surface_formats_size = num_formats;
+    
+    uint32_t num_present_modes = 0;
+    CHECK_VK(vkGetPhysicalDeviceSurfacePresentModesKHR(gpu->device, surface, 
+        &num_present_modes, NULL));
+    CHECK_VK_VAL(num_present_modes > 0, "No surface present modes");
+
+    gpu->present_modes = mem_alloc(num_present_modes * sizeof(VkPresentModeKHR));
+    CHECK_ALLOC(gpu->present_modes, "Allocation fail");
+    
+    CHECK_VK(vkGetPhysicalDeviceSurfacePresentModesKHR(gpu->device, surface, 
+        &num_present_modes, gpu->present_modes));
+    CHECK_VK_VAL(num_present_modes > 0, "No surface present modes");
+    gpu->present_modes_size = num_present_modes;
+
+    CHECK_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(gpu->device, surface, &gpu->surface_caps));
+
+    return true;
+}
+
 bool init_gpu_info_props(gpu_info *gpu, VkPhysicalDevice device, VkSurfaceKHR surface) {
     gpu->device = device;
     
@@ -50,38 +83,59 @@ bool init_gpu_info_props(gpu_info *gpu, VkPhysicalDevice device, VkSurfaceKHR su
     CHECK_VK_VAL(num_extensions > 0, "No device extensions");
     gpu->extension_props_size = num_extensions;
 
-    // Surface formats
-    uint32_t num_formats = 0;
-    CHECK_VK(vkGetPhysicalDeviceSurfaceFormatsKHR(gpu->device, surface,
-        &num_formats, NULL));
-    CHECK_VK_VAL(num_formats > 0, "No surface formats");
-
-    gpu->surface_formats = mem_alloc(num_formats * sizeof(VkSurfaceFormatKHR));
-    CHECK_ALLOC(gpu->surface_formats, "Allocation fail");
-
-    CHECK_VK(vkGetPhysicalDeviceSurfaceFormatsKHR(gpu->device, surface,
-        &num_formats, gpu->surface_formats));
-    CHECK_VK_VAL(num_formats > 0, "No surface formats");
-    gpu->surface_formats_size = num_formats;
-    
-    uint32_t num_present_modes = 0;
-    CHECK_VK(vkGetPhysicalDeviceSurfacePresentModesKHR(gpu->device, surface, 
-        &num_present_modes, NULL));
-    CHECK_VK_VAL(num_present_modes > 0, "No surface present modes");
-
-    gpu->present_modes = mem_alloc(num_present_modes * sizeof(VkPresentModeKHR));
-    CHECK_ALLOC(gpu->present_modes, "Allocation fail");
-    
-    CHECK_VK(vkGetPhysicalDeviceSurfacePresentModesKHR(gpu->device, surface, 
-        &num_present_modes, gpu->present_modes));
-    CHECK_VK_VAL(num_present_modes > 0, "No surface present modes");
-    gpu->present_modes_size = num_present_modes;
+    // headless contexts have no surface, they only render offscreen
+    if (surface != VK_NULL_HANDLE && !init_gpu_surface_props(gpu, surface)) {
+        return false;
+    }
 
-    CHECK_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(gpu->device, surface, &gpu->surface_caps));
     vkGetPhysicalDeviceMemoryProperties(gpu->device, &gpu->mem_props);
     vkGetPhysicalDeviceProperties(gpu->device, &gpu->props);
     vkGetPhysicalDeviceFeatures(gpu->device, &gpu->features);
-    
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+        .pNext = NULL
+    };
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+        .pNext = NULL
+    };
+    gpu->indexing_features = indexing_features;
+    gpu->timeline_features = timeline_features;
+
+    // only the structures of extensions the device has may be chained
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = NULL
+    };
+    if (has_extension(gpu, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        gpu->indexing_features.pNext = features.pNext;
+        features.pNext = &gpu->indexing_features;
+    }
+    if (has_extension(gpu, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+        gpu->timeline_features.pNext = features.pNext;
+        features.pNext = &gpu->timeline_features;
+    }
+    if (features.pNext) {
+        vkGetPhysicalDeviceFeatures2(gpu->device, &features);
+        gpu->indexing_features.pNext = NULL;
+        gpu->timeline_features.pNext = NULL;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT,
+        .pNext = NULL
+    };
+    gpu->indexing_props = indexing_props;
+    if (has_extension(gpu, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        VkPhysicalDeviceProperties2 props = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &gpu->indexing_props
+        };
+        vkGetPhysicalDeviceProperties2(gpu->device, &props);
+        gpu->indexing_props.pNext = NULL;
+    }
+
     return true;
 }
 
@@ -101,6 +155,21 @@ bool check_desired_extensions(gpu_info *gpu, const char *const desired_extension
     return available == required;
 }
 
+bool has_extension(gpu_info *gpu, const char *extension) {
+    return check_desired_extensions(gpu, &extension, 1);
+}
+
+bool supports_bindless(const gpu_info *gpu) {
+    const VkPhysicalDeviceDescriptorIndexingFeaturesEXT *f = &gpu->indexing_features;
+    return f->runtimeDescriptorArray &&
+        f->descriptorBindingPartiallyBound &&
+        f->descriptorBindingUpdateUnusedWhilePending &&
+        f->descriptorBindingSampledImageUpdateAfterBind &&
+        f->descriptorBindingStorageBufferUpdateAfterBind &&
+        f->shaderSampledImageArrayNonUniformIndexing &&
+        f->shaderStorageBufferArrayNonUniformIndexing;
+}
+
 bool choose_surface_format(gpu_info *gpu, VkSurfaceFormatKHR *result) {
     if (gpu->surface_formats_size == 0) {
         return false;
@@ -192,11 +261,13 @@ bool is_gpu_suitable_for_graphics(gpu_info *gpu, VkSurfaceKHR surface,
     bool graphics_index_found = false;
     bool present_index_found = false;
 
-    if (gpu->surface_formats_size == 0) {
+    bool presentation = surface != VK_NULL_HANDLE;
+
+    if (presentation && gpu->surface_formats_size == 0) {
         return false;
     }
 
-    if (gpu->present_modes_size == 0) {
+    if (presentation && gpu->present_modes_size == 0) {
         return false;
     }
 
@@ -204,11 +275,11 @@ bool is_gpu_suitable_for_graphics(gpu_info *gpu, VkSurfaceKHR surface,
         return false;
     }
 
-    if (!(gpu->surface_caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+    if (presentation && !(gpu->surface_caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
         return false;
     }
 
-    if (!check_desired_extensions(gpu, GRAPHICS_DEVICE_EXTENSIONS, GRAPHICS_DEVICE_EXTENSIONS_SIZE)) {
+    if (presentation && !check_desired_extensions(gpu, GRAPHICS_DEVICE_EXTENSIONS, GRAPHICS_DEVICE_EXTENSIONS_SIZE)) {
         return false;
     }
 
@@ -223,6 +294,9 @@ bool is_gpu_suitable_for_graphics(gpu_info *gpu, VkSurfaceKHR surface,
             graphics_index_found = true;
         }
 
+        if (!presentation) {
+            continue;
+        }
         VkBool32 support_present = VK_FALSE;
         CHECK_VK(vkGetPhysicalDeviceSurfaceSupportKHR(gpu->device, i, surface, &support_present));
         if (support_present) {
@@ -231,9 +305,28 @@ bool is_gpu_suitable_for_graphics(gpu_info *gpu, VkSurfaceKHR surface,
         }
     }
 
+    // without a surface nothing is presented, the graphics queue stands in for the present queue
+    if (!presentation && graphics_index_found) {
+        *present_index = *graphics_index;
+        present_index_found = true;
+    }
+
     return graphics_index_found && present_index_found;
 }
 
+bool find_async_compute_family(const gpu_info *gpu, uint32_t *compute_index) {
+    for (uint32_t i = 0; i < gpu->queue_family_props_size; i++) {
+        const VkQueueFamilyProperties *props = &gpu->queue_family_props[i];
+        if (props->queueCount > 0 && (props->queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+            !(props->queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            *compute_index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
 int rate_gpu(gpu_info *gpu) {
     int score = 0;
 
@@ -11,10 +11,24 @@ static const char *const GRAPHICS_DEVICE_EXTENSIONS[] = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 };
 
+// enabled when the device supports them
+#define OPTIONAL_DEVICE_EXTENSIONS_SIZE 3
+static const char *const OPTIONAL_DEVICE_EXTENSIONS[] = {
+    VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME,
+    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+};
+
 typedef struct gpu_info {
     VkPhysicalDevice device;
     VkPhysicalDeviceFeatures features;
+    // all false unless the device has VK_EXT_descriptor_indexing
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features;
+    // all false unless the device has VK_KHR_timeline_semaphore
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features;
     VkPhysicalDeviceProperties props;
+    // the update-after-bind limits, all zero unless the device has VK_EXT_descriptor_indexing
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexing_props;
     VkPhysicalDeviceMemoryProperties mem_props;
     VkSurfaceCapabilitiesKHR surface_caps;
     
@@ -34,6 +48,11 @@ typedef struct gpu_info {
 void init_gpu_info(gpu_info *gpu);
 bool init_gpu_info_props(gpu_info *gpu, VkPhysicalDevice device, VkSurfaceKHR surface);
 bool check_desired_extensions(gpu_info *gpu, const char *const desired_extensions[], size_t desired_extensions_size);
+bool has_extension(gpu_info *gpu, const char *extension);
+// update-after-bind arrays of sampled images and storage buffers, indexed non-uniformly
+bool supports_bindless(const gpu_info *gpu);
+// a compute family without graphics, its queue runs next to the graphics one
+bool find_async_compute_family(const gpu_info *gpu, uint32_t *compute_index);
 bool is_gpu_suitable_for_graphics(gpu_info *gpu, VkSurfaceKHR surface,
     uint32_t *graphics_index, uint32_t *present_index);
 
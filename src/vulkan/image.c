@@ -5,7 +5,9 @@
 #include "./tools/tools.h"
 #include "./context.h"
 #include "./memory/staging.h"
+#include "./descriptors/bindless.h"
 #include "../utils/heap.h"
+#include "../utils/copy.h"
 
 static inline VkFormat texture_format_to_vk_format(texture_format format) {
     switch (format) {
@@ -91,6 +93,8 @@ void init_image_props(vk_image_props *props) {
     props->num_levels = 0;
     props->type = TT_2D;
     props->gamma_mips = false;
+    props->render_target = false;
+    props->transient = false;
     props->filter = TF_DEFAULT;
     props->repeat = TR_REPEAT;
 }
@@ -102,6 +106,7 @@ void init_image(vk_image *image) {
     image->view = VK_NULL_HANDLE;
     image->layout = VK_IMAGE_LAYOUT_UNDEFINED;
     image->sampler = VK_NULL_HANDLE;
+    image->bindless_index = BINDLESS_NONE;
     init_image_props(&image->props);
 }
 
@@ -192,8 +197,14 @@ bool alloc_image(vk_image *image) {
     }
 
     VkImageUsageFlags usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT;
-    if (image->props.format == FMT_DEPTH) {
+    if (image->props.transient) {
+        usage_flags = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | (image->props.format == FMT_DEPTH ?
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+    } else if (image->props.format == FMT_DEPTH) {
         usage_flags |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    } else if (image->props.render_target) {
+        usage_flags |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     } else {
         usage_flags |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
     }
@@ -226,7 +237,8 @@ bool alloc_image(vk_image *image) {
     vkGetImageMemoryRequirements(context.device, image->image, &memory_requirements);
 
     bool success = vk_allocate(&image->allocation, memory_requirements.size, memory_requirements.alignment,
-        memory_requirements.memoryTypeBits, VULKAN_MEMORY_USAGE_GPU_ONLY, VULKAN_ALLOCATION_TYPE_IMAGE_OPTIMAL);
+        memory_requirements.memoryTypeBits, image->props.transient ? VULKAN_MEMORY_USAGE_GPU_LAZILY_ALLOCATED :
+        VULKAN_MEMORY_USAGE_GPU_ONLY, VULKAN_ALLOCATION_TYPE_IMAGE_OPTIMAL);
     if (!success) {
         log_error("Unable to allocate image");
         return false;
@@ -255,6 +267,11 @@ bool alloc_image(vk_image *image) {
 
     CHECK_VK(vkCreateImageView(context.device, &view_info, NULL, &image->view));
 
+    if (image->props.format != FMT_DEPTH && !image->props.render_target && !image->props.transient) {
+        image->bindless_index = vk_add_bindless_image(image->sampler, image->view,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
     return true;
 }
 
@@ -279,7 +296,7 @@ bool sub_image_upload(vk_image *image, size_t mip_level, size_t x, size_t y, siz
             data[i + 1] = img_data[i];
         }
     } else {
-        mem_copy(data, picture, size);
+        mem_copy_stream(data, picture, size);
     }
 
     VkBufferImageCopy img_copy = {
@@ -343,6 +360,8 @@ void destroy_image(vk_image *image) {
     if (image->is_swapchain_image) {
         return;
     }
+    vk_remove_bindless(BINDLESS_SAMPLED_IMAGES, image->bindless_index);
+    image->bindless_index = BINDLESS_NONE;
     if (image->image) {
         vkDestroyImage(context.device, image->image, NULL);
     }
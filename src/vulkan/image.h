@@ -17,6 +17,10 @@ typedef struct vk_image_props {
     size_t height;
     size_t num_levels;
     bool gamma_mips;
+    // color attachment that can also be copied from and to, e.g. the offscreen targets of a headless context
+    bool render_target;
+    // attachment whose contents never outlive its render pass, it can not be sampled or copied
+    bool transient;
 } vk_image_props;
 
 typedef struct vk_image {
@@ -28,6 +32,8 @@ typedef struct vk_image {
     VkImageView view;
     VkImageLayout layout;
     VkSampler sampler;
+    // index of sampled textures in the bindless table, BINDLESS_NONE without one
+    uint32_t bindless_index;
 
     vk_allocation allocation;
 } vk_image;
@@ -5,5 +5,6 @@ vulkan_memory_configuration vk_mem_config = {
     .host_visible_memory_MB = 64,
     .max_block_count_per_memory_type = 20,
     .max_garbage_allocations_size = 400,
-    .upload_buffer_size_MB = 64
+    .upload_buffer_size_MB = 64,
+    .uniform_ring_size_KB = 16 * 1024
 };
@@ -10,6 +10,7 @@ typedef struct renderer_configuration {
     size_t max_block_count_per_memory_type;
     size_t max_garbage_allocations_size;
     size_t upload_buffer_size_MB;
+    size_t uniform_ring_size_KB;
 } vulkan_memory_configuration;
 
 extern vulkan_memory_configuration vk_mem_config;
@@ -27,6 +27,7 @@ static const char* memory_usage_strings[VULKAN_MEMORY_USAGES_SIZE] = {
     "VULKAN_MEMORY_USAGE_CPU_ONLY",
     "VULKAN_MEMORY_USAGE_CPU_TO_GPU",
     "VULKAN_MEMORY_USAGE_GPU_TO_CPU",
+    "VULKAN_MEMORY_USAGE_GPU_LAZILY_ALLOCATED",
 };
 
 static const char* allocation_type_strings[VULKAN_ALLOCATION_TYPES_SIZE] = {
@@ -340,7 +341,11 @@ vk_mem_allocator vk_allocator = {
     .garbage_index = 0,
     .device_local_memory_bytes = 0,
     .host_visible_memory_bytes = 0,
-    .buffer_image_granularity  = 0
+    .buffer_image_granularity  = 0,
+    .allocated_bytes = 0,
+    .peak_allocated_bytes = 0,
+    .block_bytes = 0,
+    .peak_block_bytes = 0
 };
 
 bool init_vk_allocator(vk_mem_allocator *allocator) {
@@ -349,6 +354,10 @@ bool init_vk_allocator(vk_mem_allocator *allocator) {
     allocator->device_local_memory_bytes = vk_mem_config.device_local_memory_MB * 1024 * 1024;
     allocator->host_visible_memory_bytes = vk_mem_config.host_visible_memory_MB * 1024 * 1024;
     allocator->buffer_image_granularity = gpu->props.limits.bufferImageGranularity;
+    allocator->allocated_bytes = 0;
+    allocator->peak_allocated_bytes = 0;
+    allocator->block_bytes = 0;
+    allocator->peak_block_bytes = 0;
 
     for (size_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
         allocator->blocks[i].elements = NULL;
@@ -356,7 +365,7 @@ bool init_vk_allocator(vk_mem_allocator *allocator) {
         allocator->blocks[i].size = 0;
     }
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         allocator->garbage[i].elements = NULL;
         allocator->garbage[i].max_size = 0;
         allocator->garbage[i].size = 0;
@@ -368,7 +377,7 @@ bool init_vk_allocator(vk_mem_allocator *allocator) {
         }
     }
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         if (!init_vk_alloc_list(&allocator->garbage[i], vk_mem_config.max_garbage_allocations_size)) {
             return false;
         }
@@ -377,6 +386,13 @@ bool init_vk_allocator(vk_mem_allocator *allocator) {
     return true;
 }
 
+static void track_allocation(vk_mem_allocator *allocator, const vk_allocation *allocation) {
+    allocator->allocated_bytes += allocation->size;
+    if (allocator->allocated_bytes > allocator->peak_allocated_bytes) {
+        allocator->peak_allocated_bytes = allocator->allocated_bytes;
+    }
+}
+
 int count_set_bits(uint32_t n) {
     int count = 0;
     while (n) {
@@ -408,6 +424,9 @@ uint32_t find_memory_type_index(uint32_t memory_type_bits, vk_memory_usage_type
             required |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
             preferred |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
             break;
+        case VULKAN_MEMORY_USAGE_GPU_LAZILY_ALLOCATED:
+            preferred |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+            break;
         default:
             log_error("Unknown memory type");
             return UINT32_MAX;
@@ -460,11 +479,12 @@ bool allocate_vk_allocator(vk_mem_allocator *allocator, vk_allocation *result,
         }
 
         if (allocate_vk_block(block, size, align, allocator->buffer_image_granularity, alloc_type, result)) {
+            track_allocation(allocator, result);
             return true;
         }
     }
 
-    VkDeviceSize block_size = usage == VULKAN_MEMORY_USAGE_GPU_ONLY ?
+    VkDeviceSize block_size = !is_host_visible(usage) ?
         allocator->device_local_memory_bytes : allocator->host_visible_memory_bytes;
 
     vk_block *block = mem_alloc(sizeof(vk_block));
@@ -473,13 +493,19 @@ bool allocate_vk_allocator(vk_mem_allocator *allocator, vk_allocation *result,
 
     if (init_vk_block_memory(block)) {
         add_vk_block_list(blocks, block);
+        allocator->block_bytes += block->size;
+        if (allocator->block_bytes > allocator->peak_block_bytes) {
+            allocator->peak_block_bytes = allocator->block_bytes;
+        }
     } else {
         log_error("Could not allocate memory for new memory block");
         return false;
     }
 
     bool success = allocate_vk_block(block, size, align, allocator->buffer_image_granularity, alloc_type, result);
-    if (!success) {
+    if (success) {
+        track_allocation(allocator, result);
+    } else {
         log_error("Unable to allocate");
     }
 
@@ -487,7 +513,7 @@ bool allocate_vk_allocator(vk_mem_allocator *allocator, vk_allocation *result,
 }
 
 void empty_garbage_vk_allocator(vk_mem_allocator *allocator) {
-    allocator->garbage_index = (allocator->garbage_index + 1) % NUM_FRAME_DATA;
+    allocator->garbage_index = (allocator->garbage_index + 1) % context.frames_in_flight;
 
     vk_alloc_list *garbage = &allocator->garbage[allocator->garbage_index];
 
@@ -496,6 +522,7 @@ void empty_garbage_vk_allocator(vk_mem_allocator *allocator) {
         vk_allocation allocation;
         get_vk_alloc_list(garbage, i, &allocation);
         free_allocation_vk_block(allocation.block, &allocation);
+        allocator->allocated_bytes -= allocation.size;
 
         if (allocation.block->allocated == 0) {
             bool successful_removal = remove_element_vk_block_list(
@@ -505,6 +532,7 @@ void empty_garbage_vk_allocator(vk_mem_allocator *allocator) {
                 log_warning("Could not remove block %p from block list no. %u",
                     (void*) allocation.block, allocation.block->memory_type_index);
             }
+            allocator->block_bytes -= allocation.block->size;
             destroy_vk_block(allocation.block);
             allocation.block = NULL;
         }
@@ -513,6 +541,11 @@ void empty_garbage_vk_allocator(vk_mem_allocator *allocator) {
     clear_vk_alloc_list(garbage);
 }
 
+void reset_peak_vk_allocator(vk_mem_allocator *allocator) {
+    allocator->peak_allocated_bytes = allocator->allocated_bytes;
+    allocator->peak_block_bytes = allocator->block_bytes;
+}
+
 bool free_allocation_vk_allocator(vk_mem_allocator *allocator, vk_allocation *allocation) {
     bool result = add_vk_alloc_list(&allocator->garbage[allocator->garbage_index], *allocation);
     if (!result) {
@@ -533,7 +566,7 @@ void destroy_vk_allocator(vk_mem_allocator *allocator) {
         destroy_vk_block_list(blocks);
     }
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         destroy_vk_alloc_list(&allocator->garbage[i]);
     }
 }
@@ -566,6 +599,10 @@ void vk_empty_garbage() {
     empty_garbage_vk_allocator(&vk_allocator);
 }
 
+void vk_reset_memory_peak() {
+    reset_peak_vk_allocator(&vk_allocator);
+}
+
 bool vk_free_allocation(vk_allocation *allocation) {
     return free_allocation_vk_allocator(&vk_allocator, allocation);
 }
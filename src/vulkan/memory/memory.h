@@ -15,6 +15,8 @@ typedef enum vk_memory_usage_type {
     VULKAN_MEMORY_USAGE_CPU_ONLY,
     VULKAN_MEMORY_USAGE_CPU_TO_GPU,
     VULKAN_MEMORY_USAGE_GPU_TO_CPU,
+    // transient attachments, backed only as far as a tile needs it where the device has such memory
+    VULKAN_MEMORY_USAGE_GPU_LAZILY_ALLOCATED,
     VULKAN_MEMORY_USAGES_SIZE
 } vk_memory_usage_type;
 
@@ -65,11 +67,17 @@ typedef struct vk_mem_allocator {
     int host_visible_memory_bytes;
     VkDeviceSize buffer_image_granularity;
     vk_block_list blocks[VK_MAX_MEMORY_TYPES];
-    vk_alloc_list garbage[NUM_FRAME_DATA];
+    vk_alloc_list garbage[MAX_FRAMES_IN_FLIGHT];
+
+    // live allocations and the device memory blocks holding them, with their high-water marks
+    VkDeviceSize allocated_bytes;
+    VkDeviceSize peak_allocated_bytes;
+    VkDeviceSize block_bytes;
+    VkDeviceSize peak_block_bytes;
 } vk_mem_allocator;
 
 static inline bool is_host_visible(vk_memory_usage_type t) {
-    return t != VULKAN_MEMORY_USAGE_GPU_ONLY;
+    return t != VULKAN_MEMORY_USAGE_GPU_ONLY && t != VULKAN_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
 }
 
 // ALLOCATION
@@ -95,6 +103,8 @@ bool allocate_vk_allocator(vk_mem_allocator *allocator, vk_allocation *result,
     uint32_t size, uint32_t align, uint32_t memory_type_bits,
     vk_memory_usage_type usage, vk_allocation_type alloc_type);
 void empty_garbage_vk_allocator(vk_mem_allocator *allocator);
+// lowers the high-water marks to the current usage
+void reset_peak_vk_allocator(vk_mem_allocator *allocator);
 bool free_allocation_vk_allocator(vk_mem_allocator *allocator, vk_allocation *allocation);
 void destroy_vk_allocator(vk_mem_allocator *allocator);
 void print_vk_allocator(vk_mem_allocator *allocator);
@@ -105,6 +115,7 @@ bool vk_init_allocator();
 bool vk_allocate(vk_allocation *result, uint32_t size, uint32_t align, uint32_t memory_type_bits,
     vk_memory_usage_type usage, vk_allocation_type alloc_type);
 void vk_empty_garbage();
+void vk_reset_memory_peak();
 bool vk_free_allocation(vk_allocation *allocation);
 void vk_destroy_allocator();
 
@@ -23,7 +23,7 @@ void init_vk_staging_manager(vk_staging_manager *manager) {
     manager->mapped_data = NULL;
     manager->memory = VK_NULL_HANDLE;
     manager->command_pool = VK_NULL_HANDLE;
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < NUM_STAGING_BUFFERS; i++) {
         init_vk_staging_buffer(&manager->buffers[i]);
     }
 }
@@ -42,7 +42,7 @@ bool init_buffers_vk_staging_manager(vk_staging_manager *manager) {
         .pQueueFamilyIndices = NULL
     };
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < NUM_STAGING_BUFFERS; i++) {
         manager->buffers[i].offset = 0;
         CHECK_VK(vkCreateBuffer(context.device, &buffer_info, NULL, &manager->buffers[i].buffer));
     }
@@ -59,13 +59,13 @@ bool init_buffers_vk_staging_manager(vk_staging_manager *manager) {
     VkMemoryAllocateInfo mem_info = {
         .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
         .pNext = NULL,
-        .allocationSize = aligned_size * NUM_FRAME_DATA,
+        .allocationSize = aligned_size * NUM_STAGING_BUFFERS,
         .memoryTypeIndex = memory_type_index
     };
 
     CHECK_VK(vkAllocateMemory(context.device, &mem_info, NULL, &manager->memory));
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < NUM_STAGING_BUFFERS; i++) {
         VkMemoryRequirements current_mem_requirements;
         vkGetBufferMemoryRequirements(context.device, manager->buffers[i].buffer, &current_mem_requirements);
         if (current_mem_requirements.size != mem_requirements.size ||
@@ -78,7 +78,7 @@ bool init_buffers_vk_staging_manager(vk_staging_manager *manager) {
         CHECK_VK(vkBindBufferMemory(context.device, manager->buffers[i].buffer, manager->memory, i * aligned_size));
     }
 
-    CHECK_VK(vkMapMemory(context.device, manager->memory, 0, aligned_size * NUM_FRAME_DATA, 0,
+    CHECK_VK(vkMapMemory(context.device, manager->memory, 0, aligned_size * NUM_STAGING_BUFFERS, 0,
         (void**) &manager->mapped_data));
 
     VkCommandPoolCreateInfo pool_info = {
@@ -111,7 +111,7 @@ bool init_buffers_vk_staging_manager(vk_staging_manager *manager) {
         .pInheritanceInfo = NULL
     };
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < NUM_STAGING_BUFFERS; i++) {
         CHECK_VK(vkAllocateCommandBuffers(context.device, &command_buffer_alloc_info,
             &manager->buffers[i].command_buffer));
         CHECK_VK(vkCreateFence(context.device, &fence_info, NULL, &manager->buffers[i].fence));
@@ -221,7 +221,7 @@ void flush_vk_staging_manager(vk_staging_manager *manager) {
     vkQueueSubmit(context.graphics_queue, 1, &submit_info, stage->fence);
     stage->submitted = true;
 
-    manager->current_buffer = (manager->current_buffer + 1) % NUM_FRAME_DATA;
+    manager->current_buffer = (manager->current_buffer + 1) % NUM_STAGING_BUFFERS;
 }
 
 void destroy_vk_staging_manager(vk_staging_manager *manager) {
@@ -232,7 +232,7 @@ void destroy_vk_staging_manager(vk_staging_manager *manager) {
         manager->mapped_data = NULL;
     }
 
-    for (size_t i = 0; i < NUM_FRAME_DATA; i++) {
+    for (size_t i = 0; i < NUM_STAGING_BUFFERS; i++) {
         if (manager->buffers[i].fence)
             vkDestroyFence(context.device, manager->buffers[i].fence, NULL);
         if (manager->buffers[i].buffer)
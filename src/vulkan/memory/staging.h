@@ -23,7 +23,7 @@ typedef struct vk_staging_manager {
     byte *mapped_data;
     VkDeviceMemory memory;
     VkCommandPool command_pool;
-    vk_staging_buffer buffers[NUM_FRAME_DATA];
+    vk_staging_buffer buffers[NUM_STAGING_BUFFERS];
 } vk_staging_manager;
 
 void init_vk_staging_buffer(vk_staging_buffer *buffer);